@@ -0,0 +1,160 @@
+#include "Audio.hpp"
+#include <iostream>
+#include <cstdio>
+#include <cstring>
+
+// Phase increment per sample of a 32-bit phase accumulator, one full turn of the accumulator is one period of the tone
+const uint32_t TONE_PHASE_STEP = (uint32_t)(((uint64_t)TONE_FREQUENCY << 32) / AUDIO_SAMPLE_RATE);
+
+
+Beeper::Beeper() {
+    device = 0;
+    tone_on = false;
+    phase = 0;
+    last_pattern = AudioPattern{};
+
+    // Start with the square wave, so the audio thread never reads a buffer that was not filled in
+    patterns.writeBuffer() = last_pattern;
+    patterns.publish();
+}
+
+
+Beeper::~Beeper() {
+    close();
+}
+
+
+// Open the default audio device with a small buffer and start the callback running
+bool Beeper::open() {
+    SDL_AudioSpec want, have;
+    SDL_zero(want);
+    want.freq = AUDIO_SAMPLE_RATE;
+    want.format = AUDIO_S16SYS;
+    want.channels = 1;
+    want.samples = AUDIO_BUFFER_SAMPLES;
+    want.callback = Beeper::callback;
+    want.userdata = this;
+
+    // The sample format is fixed so generate() can be shared with the WAV writer, SDL converts if the device needs something else
+    device = SDL_OpenAudioDevice(NULL, 0, &want, &have, 0);
+    if (!device) {
+        std::cout << "ERROR: Failed to open audio device\nSDL Error: " << SDL_GetError() << std::endl;
+        return false;
+    }
+
+    SDL_PauseAudioDevice(device, 0);
+    return true;
+}
+
+
+void Beeper::close() {
+    if (device) {
+        SDL_CloseAudioDevice(device);
+        device = 0;
+    }
+}
+
+
+// Only a single atomic store, so the emulator never waits on the audio thread
+void Beeper::setTone(bool on) {
+    tone_on.store(on, std::memory_order_relaxed);
+}
+
+
+// Only publishes when the pattern or its rate actually changes, so calling this every frame is cheap
+void Beeper::setPattern(const uint8_t *bits, double rate) {
+    AudioPattern pattern{};
+    if (bits) {
+        pattern.enabled = true;
+        memcpy(pattern.bits, bits, PATTERN_BYTES);
+        pattern.step = (uint32_t)(rate * (double)(1ull << 32) / (PATTERN_BYTES * 8) / AUDIO_SAMPLE_RATE);
+    }
+
+    if (!memcmp(&pattern, &last_pattern, sizeof(AudioPattern)))
+        return;
+
+    last_pattern = pattern;
+    patterns.writeBuffer() = pattern;
+    patterns.publish();
+}
+
+
+// Square wave (or the audio pattern) while the tone is on, silence otherwise
+// The phase keeps running while silent so the wave always restarts cleanly
+void Beeper::generate(int16_t *out, int samples) {
+    bool on = tone_on.load(std::memory_order_relaxed);
+    patterns.update();
+    const AudioPattern &pattern = patterns.readBuffer();
+
+    for (int i = 0; i < samples; i++) {
+        if (!on) {
+            out[i] = 0;
+            phase += TONE_PHASE_STEP;
+        } else if (pattern.enabled) {
+            unsigned int bit = phase >> 25;                 // Top 7 bits of the phase pick one of the 128 samples
+            out[i] = (pattern.bits[bit >> 3] & (0x80 >> (bit & 7))) ? TONE_VOLUME : -TONE_VOLUME;
+            phase += pattern.step;
+        } else {
+            out[i] = (phase & 0x80000000) ? TONE_VOLUME : -TONE_VOLUME;
+            phase += TONE_PHASE_STEP;
+        }
+    }
+}
+
+
+void Beeper::callback(void *userdata, Uint8 *stream, int len) {
+    Beeper *beeper = (Beeper *)userdata;
+
+    beeper->generate((int16_t *)stream, len / sizeof(int16_t));
+}
+
+
+
+
+// Writes a little-endian value of the given size in bytes
+static void writeLE(FILE *fp, uint32_t value, int bytes) {
+    for (int i = 0; i < bytes; i++) {
+        fputc((value >> (8 * i)) & 0xFF, fp);
+    }
+}
+
+
+// Write samples out as a 16-bit mono PCM .wav file
+bool writeWAV(const char *filename, const std::vector<int16_t> &samples) {
+    FILE *fp = fopen(filename, "wb");
+    if (fp == NULL) {
+        std::cout << "ERROR: Could not open " << filename << " for writing" << std::endl;
+        return false;
+    }
+
+    uint32_t dataSize = samples.size() * sizeof(int16_t);
+
+    // RIFF header
+    fputs("RIFF", fp);
+    writeLE(fp, 36 + dataSize, 4);
+    fputs("WAVE", fp);
+
+    // Format chunk
+    fputs("fmt ", fp);
+    writeLE(fp, 16, 4);                                     // Chunk size
+    writeLE(fp, 1, 2);                                      // PCM
+    writeLE(fp, 1, 2);                                      // Mono
+    writeLE(fp, AUDIO_SAMPLE_RATE, 4);                      // Sample rate
+    writeLE(fp, AUDIO_SAMPLE_RATE * sizeof(int16_t), 4);    // Byte rate
+    writeLE(fp, sizeof(int16_t), 2);                        // Block align
+    writeLE(fp, 16, 2);                                     // Bits per sample
+
+    // Data chunk
+    fputs("data", fp);
+    writeLE(fp, dataSize, 4);
+    for (size_t i = 0; i < samples.size(); i++) {
+        writeLE(fp, (uint16_t)samples[i], 2);
+    }
+
+    bool ok = !ferror(fp);
+    fclose(fp);
+
+    if (!ok)
+        std::cout << "ERROR: Failed writing " << filename << std::endl;
+    return ok;
+}
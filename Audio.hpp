@@ -0,0 +1,52 @@
+#pragma once
+
+#include <SDL2/SDL.h>
+#include <atomic>
+#include <cstdint>
+#include <vector>
+#include "TripleBuffer.hpp"
+
+const int AUDIO_SAMPLE_RATE = 44100;
+const int AUDIO_BUFFER_SAMPLES = 512;                       // Small buffer (~12ms) so the tone starts and stops close to the sound timer
+const int AUDIO_SAMPLES_PER_FRAME = AUDIO_SAMPLE_RATE / 60; // Samples generated for each emulated frame in headless mode
+const unsigned int TONE_FREQUENCY = 440;                    // Pitch of the square wave in hz
+const int16_t TONE_VOLUME = 3000;                           // Amplitude of the square wave
+const unsigned int PATTERN_BYTES = 16;                      // XO-CHIP audio pattern, 128 one-bit samples played in a loop
+
+
+// An XO-CHIP audio pattern and the rate it is played at
+struct AudioPattern {
+    bool enabled;                                           // False plays the plain square wave
+    uint8_t bits[PATTERN_BYTES];                            // Most significant bit of the first byte is played first
+    uint32_t step;                                          // Phase increment per output sample, one full turn of the phase plays the whole pattern
+};
+
+
+// Generates the square wave (or XO-CHIP audio pattern) played while the sound timer is non-zero
+// The emulator thread only ever calls setTone() and setPattern(), the samples are generated on SDL's audio thread
+class Beeper {
+    public:
+        Beeper();
+        ~Beeper();
+
+        bool open();                                        // Opens the default audio device and starts playback
+        void close();                                       // Stops playback and closes the audio device
+
+        void setTone(bool on);                              // Turns the tone on or off, safe to call from any thread
+        void setPattern(const uint8_t *bits, double rate);  // Plays an XO-CHIP audio pattern at rate samples per second instead of the square wave
+                                                            // Call from one thread only, NULL goes back to the square wave
+        void generate(int16_t *out, int samples);           // Fills out with the next samples of the tone (or silence)
+
+    private:
+        static void callback(void *userdata, Uint8 *stream, int len);  // Called by SDL on the audio thread whenever it needs more samples
+
+        SDL_AudioDeviceID device;                           // 0 when no device is open
+
+        std::atomic<bool> tone_on;                          // Set by the emulator, read by the audio thread
+        TripleBuffer<AudioPattern> patterns;                // Emulator -> audio thread, so a pattern change never blocks either side
+        AudioPattern last_pattern;                          // Last pattern published, only touched by the thread calling setPattern()
+        uint32_t phase;                                     // Position within the square wave, only touched by the thread generating samples
+};
+
+
+bool writeWAV(const char *filename, const std::vector<int16_t> &samples);   // Writes 16-bit mono PCM samples to a .wav file
@@ -3,12 +3,17 @@
 #include <iomanip> 
 #include <cstdio> 
 #include <cstdlib> 
+#include <cstring>
+#include <cmath>
+#include <algorithm>
 #include <time.h>
 //https://lazyfoo.net/tutorials/SDL/21_sound_effects_and_music/index.php
 
 const unsigned int PROGRAM_START_ADDRES = 0x200;
 const unsigned int FONTSET_SIZE = 80;
 const unsigned int FONTSET_START_ADDRESS = 0x050;
+const unsigned int BIG_FONTSET_SIZE = 160;
+const unsigned int BIG_FONTSET_START_ADDRESS = 0x0A0;
 
 // Represents the sprites 0-F
 unsigned char chip8_fontset[FONTSET_SIZE] =
@@ -31,218 +36,1495 @@ unsigned char chip8_fontset[FONTSET_SIZE] =
   0xF0, 0x80, 0xF0, 0x80, 0x80  // F
 };
 
+// Represents the SUPER-CHIP 8x10 sprites 0-F used by Fx30
+unsigned char chip8_big_fontset[BIG_FONTSET_SIZE] =
+{
+  0xFF, 0xFF, 0xC3, 0xC3, 0xC3, 0xC3, 0xC3, 0xC3, 0xFF, 0xFF, // 0
+  0x18, 0x78, 0x78, 0x18, 0x18, 0x18, 0x18, 0x18, 0xFF, 0xFF, // 1
+  0xFF, 0xFF, 0x03, 0x03, 0xFF, 0xFF, 0xC0, 0xC0, 0xFF, 0xFF, // 2
+  0xFF, 0xFF, 0x03, 0x03, 0xFF, 0xFF, 0x03, 0x03, 0xFF, 0xFF, // 3
+  0xC3, 0xC3, 0xC3, 0xC3, 0xFF, 0xFF, 0x03, 0x03, 0x03, 0x03, // 4
+  0xFF, 0xFF, 0xC0, 0xC0, 0xFF, 0xFF, 0x03, 0x03, 0xFF, 0xFF, // 5
+  0xFF, 0xFF, 0xC0, 0xC0, 0xFF, 0xFF, 0xC3, 0xC3, 0xFF, 0xFF, // 6
+  0xFF, 0xFF, 0x03, 0x03, 0x06, 0x0C, 0x18, 0x18, 0x18, 0x18, // 7
+  0xFF, 0xFF, 0xC3, 0xC3, 0xFF, 0xFF, 0xC3, 0xC3, 0xFF, 0xFF, // 8
+  0xFF, 0xFF, 0xC3, 0xC3, 0xFF, 0xFF, 0x03, 0x03, 0xFF, 0xFF, // 9
+  0x7E, 0xFF, 0xC3, 0xC3, 0xC3, 0xFF, 0xFF, 0xC3, 0xC3, 0xC3, // A
+  0xFC, 0xFC, 0xC3, 0xC3, 0xFC, 0xFC, 0xC3, 0xC3, 0xFC, 0xFC, // B
+  0x3C, 0xFF, 0xC3, 0xC0, 0xC0, 0xC0, 0xC0, 0xC3, 0xFF, 0x3C, // C
+  0xFC, 0xFE, 0xC3, 0xC3, 0xC3, 0xC3, 0xC3, 0xC3, 0xFE, 0xFC, // D
+  0xFF, 0xFF, 0xC0, 0xC0, 0xFF, 0xFF, 0xC0, 0xC0, 0xFF, 0xFF, // E
+  0xFF, 0xFF, 0xC0, 0xC0, 0xFF, 0xFF, 0xC0, 0xC0, 0xC0, 0xC0  // F
+};
+
+// The leftmost 64 pixels of a display row, the part that is visible in low resolution
+const VideoRow LORES_ROW_MASK = ~(VideoRow)0 << 64;
+
+
+Chip8::Chip8() {
+    instructions_per_second = 700;      // Reasonable default for most ROMs, can be changed with setSpeed()
+    rng_seed = time(NULL);              // Seeded from the clock unless seed() is called
+    compiled = NULL;                    // Interpreted until setCompiledROM() is called
+    tier_threshold = 0;                 // Every instruction is interpreted until setTiering() is called
+    coverage_on = false;
+    tier_generation = 0;
+    setPlatform(PLATFORM_CHIP8);
+
+    initialize();
+}
+
+
+// Every member copies cheaply (see Chip8.hpp), so a clone is a plain copy
+Chip8 Chip8::clone() {
+    return *this;
+}
+
+
+// Assigning into an existing machine reuses its page table, so nothing is allocated once the pool is warm
+void Chip8::cloneInto(Chip8 &target) {
+    target = *this;
+}
+
+
+// Initializes the registers and memory
+void Chip8::initialize() {
+    drawFlag = true;
+
+    pc = PROGRAM_START_ADDRES;          // 0x200 is where Chip8 programs start
+                                        // 0x000 to 0x1FF are where the original interpreter was located and should not be used
+
+    sp = 0;                             // Reset stack pointer
+    I = 0;                              // Reset index register 
+    opcode = 0;                         // Reset current opcode 
+
+    delay_timer = 0;                    // Reset delay timer
+    sound_timer = 0;                    // Reset sound timer
+
+    frame_remainder = 0;                // Start counting frames from scratch
+
+    key_presses = 0;                    // Forget any key presses
+    wait_key = -1;                      // Not waiting on a key
+
+    hires = false;                      // Start in low resolution
+    planes = 0x1;                       // Draw to the first bitplane only
+    halted = false;
+    fault = NULL;
+    compiled_active = false;            // The ROM is gone, loadROM() checks the generated code against the new one
+    memset(code_written, 0, sizeof(code_written));
+    block_entry = true;
+    tier_stats = {};
+
+    audio_pattern_loaded = false;       // Play the plain tone until an XO-CHIP program loads a pattern
+    pitch = 64;                         // XO-CHIP default pitch, plays the pattern at 4000 samples per second
+
+    // Clear registers and keypad
+    for (int i = 0; i < REGISTER_COUNT; i++) {
+        keypad[i] = V[i] = 0;
+    }
+
+    // Clear video display
+    for (int p = 0; p < PLANE_COUNT; p++) {
+        for (int i = 0; i < VIDEO_HEIGHT; i++) {       
+            video[p][i] = 0;
+        }
+    }
+
+    // Clear memory -- every page starts out as the shared page of zeroes
+    std::fill(pages.begin(), pages.end(), zeroPage());
+
+    // Load fonts (sprites 0-F) into memory from address 0x050 to 0x0A0
+    for (int i = 0; i < FONTSET_SIZE; i++) {
+        writableMem(FONTSET_START_ADDRESS + i) = chip8_fontset[i];
+    }
+
+    // Load big fonts (SUPER-CHIP sprites 0-F) into memory from address 0x0A0 to 0x140
+    for (int i = 0; i < BIG_FONTSET_SIZE; i++) {
+        writableMem(BIG_FONTSET_START_ADDRESS + i) = chip8_big_fontset[i];
+    }
+
+    // Clear stack and RPL flags
+    for (int i = 0; i < STACK_SIZE; i++) {
+        stack[i] = 0;
+    }
+    for (int i = 0; i < RPL_COUNT; i++) {
+        rpl[i] = 0;
+    }
+
+    // Clear the audio pattern
+    for (int i = 0; i < AUDIO_PATTERN_SIZE; i++) {
+        audio_pattern[i] = 0;
+    }
+
+    // The opcode tables only depend on the platform, so they are picked by setPlatform() rather than on every reset
+
+    // Reset the random number generator back to its seed so every run of a ROM with the same seed is identical
+    rng_state = rng_seed ? rng_seed : 0x2545F491;       // xorshift state must never be zero
+
+    rehashMemory();
+    resetBlocks();
+
+    // The display is blank, and blank rows hash to 0
+    video_hash = 0;
+    memset(row_hashes, 0, sizeof(row_hashes));
+    memset(dirty_rows, 0, sizeof(dirty_rows));
+}
+
+
+// Fills a set of opcode tables with the instructions of a platform
+void Chip8::setupOpcodeTables(OpcodeTables &tables, Platform platform) {
+    // Set up function pointer table for opcodes
+        tables.OpcodeTable[0x0] = &Chip8::getTable0;
+        tables.OpcodeTable[0x1] = &Chip8::OP_1nnn;
+        tables.OpcodeTable[0x2] = &Chip8::OP_2nnn;
+        tables.OpcodeTable[0x3] = &Chip8::OP_3xkk;
+        tables.OpcodeTable[0x4] = &Chip8::OP_4xkk;
+        tables.OpcodeTable[0x5] = &Chip8::getTable5;
+        tables.OpcodeTable[0x6] = &Chip8::OP_6xkk;
+        tables.OpcodeTable[0x7] = &Chip8::OP_7xkk;
+        tables.OpcodeTable[0x8] = &Chip8::getTable8;
+        tables.OpcodeTable[0x9] = &Chip8::OP_9xy0;
+        tables.OpcodeTable[0xA] = &Chip8::OP_Annn;
+        tables.OpcodeTable[0xB] = &Chip8::OP_Bnnn;
+        tables.OpcodeTable[0xC] = &Chip8::OP_Cxkk;
+        tables.OpcodeTable[0xD] = &Chip8::OP_Dxyn;
+        tables.OpcodeTable[0xE] = &Chip8::getTableE;
+        tables.OpcodeTable[0xF] = &Chip8::getTableF;
+
+
+    // Initialize opcode tables 0, 5, 8, and E with all NULL values
+    for (int i = 0; i < 0xFF + 1; i++) {
+        tables.OpcodeTable_0[i] = &Chip8::OP_NULL;
+    }
+    for (int i = 0; i < 0xF + 1; i++) {
+        tables.OpcodeTable_5[i] = &Chip8::OP_NULL;
+        tables.OpcodeTable_8[i] = &Chip8::OP_NULL;
+        tables.OpcodeTable_E[i] = &Chip8::OP_NULL;
+    }
+
+    // Fill the proper indices with their opcodes
+    tables.OpcodeTable_0[0xE0] = &Chip8::OP_00E0;
+    tables.OpcodeTable_0[0xEE] = &Chip8::OP_00EE;
+
+    tables.OpcodeTable_5[0x0] = &Chip8::OP_5xy0;
+
+    tables.OpcodeTable_8[0x0] = &Chip8::OP_8xy0;
+    tables.OpcodeTable_8[0x1] = &Chip8::OP_8xy1;
+    tables.OpcodeTable_8[0x2] = &Chip8::OP_8xy2;
+    tables.OpcodeTable_8[0x3] = &Chip8::OP_8xy3;
+    tables.OpcodeTable_8[0x4] = &Chip8::OP_8xy4;
+    tables.OpcodeTable_8[0x5] = &Chip8::OP_8xy5;
+    tables.OpcodeTable_8[0x6] = &Chip8::OP_8xy6;
+    tables.OpcodeTable_8[0x7] = &Chip8::OP_8xy7;
+    tables.OpcodeTable_8[0xE] = &Chip8::OP_8xyE;
+
+    tables.OpcodeTable_E[0xE] = &Chip8::OP_Ex9E;
+    tables.OpcodeTable_E[0x1] = &Chip8::OP_ExA1;
+
+
+    // Initialize opcode table F with all NULL values
+    for (int i = 0; i < 0xFF + 1; i++) {
+        tables.OpcodeTable_F[i] = &Chip8::OP_NULL;
+    }
+
+    // Fill the proper indices with their opcodes
+    tables.OpcodeTable_F[0x07] = &Chip8::OP_Fx07;
+    tables.OpcodeTable_F[0x0A] = &Chip8::OP_Fx0A;
+    tables.OpcodeTable_F[0x15] = &Chip8::OP_Fx15;
+    tables.OpcodeTable_F[0x18] = &Chip8::OP_Fx18;
+    tables.OpcodeTable_F[0x1E] = &Chip8::OP_Fx1E;
+    tables.OpcodeTable_F[0x29] = &Chip8::OP_Fx29;
+    tables.OpcodeTable_F[0x33] = &Chip8::OP_Fx33;
+    tables.OpcodeTable_F[0x55] = &Chip8::OP_Fx55;
+    tables.OpcodeTable_F[0x65] = &Chip8::OP_Fx65;
+
+
+    // SUPER-CHIP instructions, which XO-CHIP also has
+    if (platform == PLATFORM_SCHIP || platform == PLATFORM_XOCHIP) {
+        for (int i = 0; i < 0xF + 1; i++) {
+            tables.OpcodeTable_0[0xC0 + i] = &Chip8::OP_00Cn;
+        }
+        tables.OpcodeTable_0[0xFB] = &Chip8::OP_00FB;
+        tables.OpcodeTable_0[0xFC] = &Chip8::OP_00FC;
+        tables.OpcodeTable_0[0xFD] = &Chip8::OP_00FD;
+        tables.OpcodeTable_0[0xFE] = &Chip8::OP_00FE;
+        tables.OpcodeTable_0[0xFF] = &Chip8::OP_00FF;
+
+        tables.OpcodeTable_F[0x30] = &Chip8::OP_Fx30;
+        tables.OpcodeTable_F[0x75] = &Chip8::OP_Fx75;
+        tables.OpcodeTable_F[0x85] = &Chip8::OP_Fx85;
+    }
+
+    // XO-CHIP instructions
+    if (platform == PLATFORM_XOCHIP) {
+        for (int i = 0; i < 0xF + 1; i++) {
+            tables.OpcodeTable_0[0xD0 + i] = &Chip8::OP_00Dn;
+        }
+
+        tables.OpcodeTable_5[0x2] = &Chip8::OP_5xy2;
+        tables.OpcodeTable_5[0x3] = &Chip8::OP_5xy3;
+
+        tables.OpcodeTable_F[0x00] = &Chip8::OP_F000;
+        tables.OpcodeTable_F[0x01] = &Chip8::OP_Fn01;
+        tables.OpcodeTable_F[0x02] = &Chip8::OP_F002;
+        tables.OpcodeTable_F[0x3A] = &Chip8::OP_Fx3A;
+    }
+}
+
+
+// The tables only depend on the platform, so every instance of a platform shares one set
+// They are built the first time an instance of the platform is made, which is thread safe
+const Chip8::OpcodeTables *Chip8::opcodeTablesFor(Platform platform) {
+    static const std::vector<OpcodeTables> all = []() {
+        std::vector<OpcodeTables> all(PLATFORM_XOCHIP + 1);
+        for (int p = 0; p <= PLATFORM_XOCHIP; p++) {
+            setupOpcodeTables(all[p], (Platform)p);
+        }
+        return all;
+    }();
+
+    return &all[platform];
+}
+
+
+// Selects the platform to emulate along with its quirks
+// Only XO-CHIP instances get 64KB of memory, everything else keeps 4KB
+void Chip8::setPlatform(Platform p) {
+    platform = p;
+    quirks = platformQuirks(platform);
+
+    // A different memory size keeps whatever was already in the pages that are still there
+    memory_mask = (platform == PLATFORM_XOCHIP ? XO_MEMORY_SIZE : MEMORY_SIZE) - 1;
+    pages.resize((memory_mask + 1) / MEMORY_PAGE_SIZE, zeroPage());
+    pages.shrink_to_fit();
+    rehashMemory();
+    checkCompiled();
+
+    tables = opcodeTablesFor(platform);
+    resetBlocks();
+}
+
+
+Quirks Chip8::platformQuirks(Platform p) {
+    Quirks q;
+    switch (p) {
+        case PLATFORM_SCHIP :
+            q.vf_reset = false;
+            q.memory_increment = false;
+            q.shift_vy = false;
+            q.jump_vx = true;
+            q.wrap = false;
+            break;
+
+        case PLATFORM_XOCHIP :
+            q.vf_reset = false;
+            q.memory_increment = true;
+            q.shift_vy = true;
+            q.jump_vx = false;
+            q.wrap = true;
+            break;
+
+        default :
+            q.vf_reset = true;
+            q.memory_increment = true;
+            q.shift_vy = false;         // This emulator has always shifted Vx in place
+            q.jump_vx = false;
+            q.wrap = false;
+            break;
+    }
+    return q;
+}
+
+
+bool Chip8::parsePlatform(const std::string &name, Platform &p) {
+    if (name == "chip8") {
+        p = PLATFORM_CHIP8;
+    } else if (name == "schip") {
+        p = PLATFORM_SCHIP;
+    } else if (name == "xochip") {
+        p = PLATFORM_XOCHIP;
+    } else {
+        return false;
+    }
+    return true;
+}
+
+
+const char *Chip8::platformName(Platform p) {
+    switch (p) {
+        case PLATFORM_SCHIP : return "schip";
+        case PLATFORM_XOCHIP : return "xochip";
+        default : return "chip8";
+    }
+}
+
+
+Platform Chip8::platformFor(const std::string &rom) {
+    size_t dot = rom.find_last_of("./\\");
+    std::string extension = dot != std::string::npos && rom[dot] == '.' ? rom.substr(dot) : "";
+    if (extension == ".sc8")
+        return PLATFORM_SCHIP;
+    if (extension == ".xo8")
+        return PLATFORM_XOCHIP;
+    return PLATFORM_CHIP8;
+}
+
+
+// Predecoded blocks chose their VF handling with the old quirks, and generated code has the platform's quirks built in
+void Chip8::setQuirks(const Quirks &q) {
+    quirks = q;
+    checkCompiled();
+    resetBlocks();
+}
+
+
+Quirks Chip8::getQuirks() {
+    return quirks;
+}
+
+
+bool Chip8::isHalted() {
+    return halted;
+}
+
+
+const char *Chip8::getFault() {
+    return fault;
+}
+
+
+// Mixes one piece of state into a 64-bit value (splitmix64 finaliser)
+// The key says which piece of state it is, so equal values in different places hash differently
+static inline uint64_t hashValue(uint64_t key, uint64_t value) {
+    uint64_t z = (key * 0x9E3779B97F4A7C15ull) ^ value;
+    z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ull;
+    z = (z ^ (z >> 27)) * 0x94D049BB133111EBull;
+    return z ^ (z >> 31);
+}
+
+// Memory bytes and display rows that are zero add nothing to the hash, so clearing them is cheap and most of a fresh machine costs nothing to hash
+static inline uint64_t hashCell(uint64_t key, uint64_t value) {
+    return value ? hashValue(key, value) : 0;
+}
+
+// Keys for hashValue(), the low bits are the address, register number or row
+const uint64_t HASH_REGISTERS = 0x10000;
+const uint64_t HASH_MEMORY = 0x20000;
+const uint64_t HASH_VIDEO = 0x40000;
+const uint64_t HASH_STACK = 0x80000;
+const uint64_t HASH_MISC = 0x100000;
+
+static inline uint64_t hashRow(unsigned int plane, unsigned int y, VideoRow row) {
+    uint64_t key = HASH_VIDEO | (plane << 8) | (y << 1);
+    return hashCell(key, (uint64_t)row) ^ hashCell(key | 1, (uint64_t)(row >> 64));
+}
+
+
+// Every piece of state is hashed separately and the results are XOR'd together
+// Anything that only the frontend changes (keypad, speed, seed) is left out, both sides of a comparison are given the same
+// This recomputes everything from scratch, stateHash() gives the same value without walking memory and the display
+uint64_t Chip8::computeStateHash() {
+    uint64_t hash = hashRegisters();
+
+    for (uint32_t i = 0; i <= memory_mask; i++) {
+        hash ^= hashCell(HASH_MEMORY | i, mem(i));
+    }
+    for (int p = 0; p < PLANE_COUNT; p++) {
+        for (int i = 0; i < VIDEO_HEIGHT; i++) {
+            hash ^= hashRow(p, i, video[p][i]);
+        }
+    }
+    return hash;
+}
+
+
+// Memory is hashed as it is written, display rows are rehashed here if they were drawn to since the last call,
+// and the registers (a fixed 80 or so values) are hashed here too
+// Build with -DCHIP8_VERIFY_HASH to check every call against computeStateHash()
+uint64_t Chip8::stateHash() {
+    updateVideoHash();
+    uint64_t hash = hashRegisters() ^ memory_hash ^ video_hash;
+
+#ifdef CHIP8_VERIFY_HASH
+    if (hash != computeStateHash()) {
+        std::cout << "ERROR: Incremental state hash is out of date (PC 0x" << std::hex << pc << ", opcode 0x" << opcode << ")" << std::endl;
+        abort();
+    }
+#endif
+    return hash;
+}
+
+
+uint64_t Chip8::hashRegisters() {
+    uint64_t hash = 0;
+
+    for (int i = 0; i < REGISTER_COUNT; i++) {
+        hash ^= hashValue(HASH_REGISTERS | i, V[i]);
+    }
+    for (int i = 0; i < STACK_SIZE; i++) {
+        hash ^= hashValue(HASH_STACK | i, stack[i]);
+    }
+    for (int i = 0; i < RPL_COUNT; i++) {
+        hash ^= hashValue(HASH_STACK | 0x100 | i, rpl[i]);
+    }
+    for (int i = 0; i < AUDIO_PATTERN_SIZE; i++) {
+        hash ^= hashValue(HASH_STACK | 0x200 | i, audio_pattern[i]);
+    }
+
+    hash ^= hashValue(HASH_MISC | 0, pc);
+    hash ^= hashValue(HASH_MISC | 1, sp);
+    hash ^= hashValue(HASH_MISC | 2, I);
+    hash ^= hashValue(HASH_MISC | 3, delay_timer);
+    hash ^= hashValue(HASH_MISC | 4, sound_timer);
+    hash ^= hashValue(HASH_MISC | 5, hires);
+    hash ^= hashValue(HASH_MISC | 6, planes);
+    hash ^= hashValue(HASH_MISC | 7, halted);
+    hash ^= hashValue(HASH_MISC | 8, audio_pattern_loaded);
+    hash ^= hashValue(HASH_MISC | 9, pitch);
+    hash ^= hashValue(HASH_MISC | 10, rng_state);
+    hash ^= hashValue(HASH_MISC | 11, key_presses);
+    hash ^= hashValue(HASH_MISC | 12, (uint8_t)wait_key);
+    hash ^= hashValue(HASH_MISC | 13, frame_remainder);
+    return hash;
+}
+
+
+void Chip8::rehashMemory() {
+    memory_hash = 0;
+    for (uint32_t page = 0; page < pages.size(); page++) {
+        if (pages[page] == zeroPage())
+            continue;
+
+        for (uint32_t i = page * MEMORY_PAGE_SIZE; i < (page + 1) * MEMORY_PAGE_SIZE; i++) {
+            memory_hash ^= hashCell(HASH_MEMORY | i, mem(i));
+        }
+    }
+}
+
+
+// Swaps the old hash of each dirty row for its new one
+void Chip8::updateVideoHash() {
+    for (int p = 0; p < PLANE_COUNT; p++) {
+        for (uint64_t dirty = dirty_rows[p]; dirty; dirty &= dirty - 1) {
+            unsigned int y = __builtin_ctzll(dirty);
+            uint64_t hash = hashRow(p, y, video[p][y]);
+            video_hash ^= row_hashes[p][y] ^ hash;
+            row_hashes[p][y] = hash;
+        }
+        dirty_rows[p] = 0;
+    }
+}
+
+
+// Writes guest memory, swapping the old byte's hash for the new one's
+inline void Chip8::storeMemory(uint32_t address, uint8_t value) {
+    uint8_t &cell = writableMem(address);
+    address &= memory_mask;
+    memory_hash ^= hashCell(HASH_MEMORY | address, cell) ^ hashCell(HASH_MEMORY | address, value);
+    cell = value;
+
+    // Self-modifying code: the generated code for this page may no longer be what the program does
+    uint32_t offset = address - PROGRAM_START_ADDRES;
+    if (compiled_active && offset < compiled->rom_size && (compiled->code[offset / 64] >> (offset % 64)) & 1)
+        code_written[address / MEMORY_PAGE_SIZE / 64] |= 1ull << (address / MEMORY_PAGE_SIZE % 64);
+    if (block_cache && block_cache->covered[address])
+        demoteBlocks(address);
+}
+
+
+uint8_t Chip8::readMemory(uint32_t address) {
+    return mem(address);
+}
+
+
+uint32_t Chip8::memorySize() {
+    return memory_mask + 1;
+}
+
+
+Registers Chip8::getRegisters() {
+    Registers registers;
+    registers.pc = pc;
+    registers.I = I;
+    registers.sp = sp;
+    registers.delay_timer = delay_timer;
+    registers.sound_timer = sound_timer;
+    memcpy(registers.V, V, REGISTER_COUNT);
+    return registers;
+}
+
+
+// Checked after every instruction by the fuzzer
+bool Chip8::isStateValid() {
+    return sp <= STACK_SIZE && pc <= memory_mask && pages.size() * MEMORY_PAGE_SIZE == memory_mask + 1;
+}
+
+
+// Decoded through the opcode tables, so an instruction the platform does not have never counts
+bool Chip8::readsInput() {
+    opTable handler = decodeOpcode((mem(pc) << 8) | mem(pc + 1));
+    return handler == &Chip8::OP_Cxkk || handler == &Chip8::OP_Ex9E || handler == &Chip8::OP_ExA1 || handler == &Chip8::OP_Fx0A;
+}
+
+
+unsigned int Chip8::screenWidth() {
+    return hires ? VIDEO_WIDTH : LORES_WIDTH;
+}
+
+
+unsigned int Chip8::screenHeight() {
+    return hires ? VIDEO_HEIGHT : LORES_HEIGHT;
+}
+
+
+bool Chip8::getPixel(unsigned int x, unsigned int y, unsigned int plane) {
+    return (video[plane][y] >> (VIDEO_WIDTH - 1 - x)) & 1;
+}
+
+
+bool Chip8::hasAudioPattern() {
+    return audio_pattern_loaded;
+}
+
+
+const uint8_t *Chip8::getAudioPattern() {
+    return audio_pattern;
+}
+
+
+// XO-CHIP plays the pattern at 4000 * 2^((pitch - 64) / 48) samples per second
+double Chip8::getAudioPatternRate() {
+    return 4000.0 * pow(2.0, (pitch - 64) / 48.0);
+}
+
+
+// In low resolution only the leftmost 64 pixels of each row are part of the display
+VideoRow Chip8::rowMask() {
+    return hires ? ~(VideoRow)0 : LORES_ROW_MASK;
+}
+
+
+// Every guest memory access goes through here
+// Addresses are wrapped with a mask rather than checked, so a ROM can never reach outside memory and the hot path has no extra branch
+// The checked build stops on the first address past the end instead, to find ROMs that depend on wrapping
+inline uint8_t Chip8::mem(uint32_t address) {
+#ifdef CHIP8_CHECKED_MEMORY
+    if (address > memory_mask) {
+        std::cout << "ERROR: Memory access out of bounds at 0x" << std::hex << address << " (PC 0x" << pc << ", opcode 0x" << opcode << ")" << std::endl;
+        abort();
+    }
+#endif
+    address &= memory_mask;
+    return pages[address / MEMORY_PAGE_SIZE]->bytes[address % MEMORY_PAGE_SIZE];
+}
+
+
+// Writes go through here, a page that is shared with a clone (or is the zero page) is copied first
+inline uint8_t &Chip8::writableMem(uint32_t address) {
+#ifdef CHIP8_CHECKED_MEMORY
+    if (address > memory_mask) {
+        std::cout << "ERROR: Memory access out of bounds at 0x" << std::hex << address << " (PC 0x" << pc << ", opcode 0x" << opcode << ")" << std::endl;
+        abort();
+    }
+#endif
+    address &= memory_mask;
+    std::shared_ptr<MemoryPage> &page = pages[address / MEMORY_PAGE_SIZE];
+    if (page.use_count() != 1)
+        page = std::make_shared<MemoryPage>(*page);
+    return page->bytes[address % MEMORY_PAGE_SIZE];
+}
+
+
+void Chip8::unshareMemory() {
+    for (size_t i = 0; i < pages.size(); i++) {
+        if (pages[i].use_count() != 1)
+            pages[i] = std::make_shared<MemoryPage>(*pages[i]);
+    }
+}
+
+
+// One page of zeroes shared by every instance, so fresh memory costs nothing until it is written
+const std::shared_ptr<Chip8::MemoryPage> &Chip8::zeroPage() {
+    static const std::shared_ptr<MemoryPage> page = std::make_shared<MemoryPage>();
+    return page;
+}
+
+
+// Skip the next instruction
+// On XO-CHIP, F000 nnnn is 4 bytes long so it has to be skipped over as a whole
+void Chip8::skipInstruction() {
+    if (platform == PLATFORM_XOCHIP && mem(pc) == 0xF0 && mem(pc + 1) == 0x00) {
+        pc += 4;
+    } else {
+        pc += 2;
+    }
+}
+
+
+
+
+// Index into OpcodeTable_0 based on the last two hex digits of the opcode
+void Chip8::getTable0() {
+    int index = opcode & 0x00FF;
+
+    // Dereference OpcodeTable_0 and call the function at the index
+    (this->*(tables->OpcodeTable_0[index]))();
+}
+
+
+// Index into OpcodeTable_5 based on the last hex digit of the opcode
+void Chip8::getTable5() {
+    int index = opcode & 0x000F;
+
+    // Dereference OpcodeTable_5 and call the function at the index
+    (this->*(tables->OpcodeTable_5[index]))();
+}
+
+
+// Index into OpcodeTable_8 based on the last hex digit of the opcode
+void Chip8::getTable8() {
+    int index = opcode & 0x000F;
+
+    // Dereference OpcodeTable_8 and call the function at the index
+    (this->*(tables->OpcodeTable_8[index]))();
+}
+
+
+// Index into OpcodeTable_E based on the last hex digit of the opcode
+void Chip8::getTableE() {
+    int index = opcode & 0x000F;
+
+    // Dereference OpcodeTable_E and call the function at the index
+    (this->*(tables->OpcodeTable_E[index]))();
+}
+
+
+// Index into OpcodeTable_F based on the last two hex digits of the opcode
+void Chip8::getTableF() {
+    int index = opcode & 0x00FF;
+
+    // Dereference OpcodeTable_0 and call the function at the index
+    (this->*(tables->OpcodeTable_F[index]))();
+}
+
+
+
+
+// Every cycle the CPU will fetch the opcode, decode the opcode, execute the opcode, and update timers
+void Chip8::emulateCycle() {
+    if (halted)
+        return;
+
+    if (coverage_on)
+        coverage[pc / 64] |= 1ull << (pc % 64);
+
+    // Fetch Opcode
+    // Each opcode is 2 bytes long, need to merge the two halves in memory
+    // Both halves are on the same page unless the opcode starts on the last byte of one, so the page is only looked up once
+    uint32_t offset = pc % MEMORY_PAGE_SIZE;
+    if (offset != MEMORY_PAGE_SIZE - 1) {
+        const uint8_t *page = pages[pc / MEMORY_PAGE_SIZE]->bytes;
+        opcode = (page[offset] << 8) | page[offset + 1];
+    } else {
+        opcode = (mem(pc) << 8) | mem(pc + 1);
+    }
+
+    pc += 2;
+
+    // Decode and Execute Opcode
+    (this->*(tables->OpcodeTable[(opcode & 0xF000) >> 12]))();
+
+    pc &= memory_mask;                              // Jumps and skips past the end of memory wrap around to the start, like every other address
+}
+
+
+
+
+// Sets how many instructions are executed per emulated second
+void Chip8::setSpeed(unsigned int ips) {
+    instructions_per_second = ips;
+}
+
+
+// Sets the seed of the random number generator and restarts it from that seed
+void Chip8::seed(uint32_t value) {
+    rng_seed = value;
+    rng_state = rng_seed ? rng_seed : 0x2545F491;
+}
+
+
+// Returns the next byte from a xorshift32 generator
+// rand() is not used as its sequence differs between C libraries, which would make runs differ between machines
+uint8_t Chip8::nextRandom() {
+    rng_state ^= rng_state << 13;
+    rng_state ^= rng_state >> 17;
+    rng_state ^= rng_state << 5;
+
+    return rng_state >> 24;
+}
+
+
+// Executes one frame (1/60 of an emulated second) of instructions and then updates the timers once
+// Timers tick every IPS/60 executed instructions, if IPS is not a multiple of 60 the leftover instructions are spread across frames
+void Chip8::emulateFrame() {
+    emulateCycles(beginFrame());
+    endFrame();
+}
+
+
+// Generated code runs as much as it can, then predecoded blocks if tiering is on, and the interpreter runs whatever is left
+void Chip8::emulateCycles(unsigned int count) {
+    unsigned int i = 0;
+
+    if (compiled_active && !coverage_on) {
+        i = compiled->run(*this, count);
+        tier_stats.native += i;
+    } else if (block_cache) {
+        i = runTiered(count);
+    }
+
+    tier_stats.interpreted += count - i;
+    for (; i < count; i++) {
+        emulateCycle();
+    }
+}
+
+
+// The frame is split up so tools can step a frame one instruction at a time and still run exactly what emulateFrame() would
+unsigned int Chip8::beginFrame() {
+    unsigned int cycles = instructions_per_second / TIMER_FREQUENCY;
+
+    frame_remainder += instructions_per_second % TIMER_FREQUENCY;
+    if (frame_remainder >= TIMER_FREQUENCY) {
+        frame_remainder -= TIMER_FREQUENCY;
+        cycles++;
+    }
+
+    return cycles;
+}
+
+
+void Chip8::endFrame() {
+    updateTimers();
+
+    key_presses = 0;                    // Presses have had a whole frame to be seen by Fx0A
+}
+
+
+// Press or release a key
+// A key going from released to pressed is recorded so Fx0A can wait for a fresh press rather than a key that is being held down
+void Chip8::setKey(uint8_t key, bool pressed) {
+    if (pressed && !keypad[key])
+        key_presses |= 1 << key;
+
+    keypad[key] = pressed;
+}
+
+
+
+
+// Updates the delay timer and sound timer
+// The tone itself is produced by the frontend, which checks isSoundPlaying() after each frame
+void Chip8::updateTimers() {
+    if (delay_timer) 
+        delay_timer--;
+    
+    if (sound_timer)
+        sound_timer--;
+}
+
+
+// A tone is played for as long as the sound timer is non-zero
+bool Chip8::isSoundPlaying() {
+    return sound_timer > 0;
+}
+
+
+
+
+// Load a program into memory starting from memory address 0x200
+bool Chip8::loadROM(const char *filename) {
+    initialize();
+
+    FILE *fp;
+    fp = fopen(filename, "rb");
+    if (fp == NULL) {
+        std::cout << "ERROR: Could not open file" << std::endl << std::endl;
+        return false;
+    }
+
+    // Obtain size of file
+    long fsize;
+    fseek(fp , 0 , SEEK_END);
+    fsize = ftell(fp);
+    rewind(fp);
+
+    // If file is larger than memory allows, throw an error
+    if (fsize > (long)(memorySize() - 0x200)) {
+        std::cout << "ERROR: File is too large" << std::endl << "File must be of size " << memorySize() - 0x200 << " or smaller" << std::endl << std::endl;
+        std::cout << fsize;
+        fclose(fp);
+        return false;
+    }
+
+    // Put the contents of the file in memory starting at address 0x200
+    // ftell() fails (-1) on things that are not files, like directories
+    std::vector<uint8_t> data(std::max(fsize, 0l));
+    if (fsize < 0 || fread(data.data(), 1, fsize, fp) != (size_t)fsize) {
+        std::cout << "ERROR: File reading error" << std::endl << std::endl;
+        fclose(fp);
+        return false;
+    }
+
+    fclose(fp);
+    for (long i = 0; i < fsize; i++) {
+        writableMem(0x200 + i) = data[i];
+    }
+    rehashMemory();
+    checkCompiled();
+    return true;
+}
+
+
+// Load a program that is already in host memory into memory starting from memory address 0x200
+bool Chip8::loadROM(const uint8_t *data, uint32_t size) {
+    initialize();
+
+    if (size > (memorySize() - 0x200)) {
+        std::cout << "ERROR: ROM is too large" << std::endl << "ROM must be of size " << memorySize() - 0x200 << " or smaller" << std::endl << std::endl;
+        return false;
+    }
+
+    for (uint32_t i = 0; i < size; i++) {
+        writableMem(0x200 + i) = data[i];
+    }
+    rehashMemory();
+    checkCompiled();
+    return true;
+}
+
+
+// The whole machine is copied from the template, then the settings that belong to this machine are put back
+void Chip8::reset(const ROMTemplate &rom) {
+    unsigned int ips = instructions_per_second;
+    uint32_t seed = rng_seed;
+    const CompiledROM *code = compiled;
+    unsigned int threshold = tier_threshold;
+    uint32_t generation = tier_generation;
+    bool recording = coverage_on;
+    std::vector<uint64_t> recorded;
+    recorded.swap(coverage);
+
+    // Pages only this machine holds are put aside and refilled with the template's bytes, rather than dropped for the template's shared pages
+    // So a machine that is reset over and over only copies a page the first time it writes it, and not again after every reset
+    std::vector<std::shared_ptr<MemoryPage>> own;
+    own.swap(spare_pages);
+    own.resize(pages.size());
+    for (size_t i = 0; i < pages.size(); i++) {
+        if (pages[i].use_count() == 1)
+            own[i] = std::move(pages[i]);
+    }
+
+    *this = rom.image;
+
+    for (size_t i = 0; i < own.size() && i < pages.size(); i++) {
+        if (own[i]) {
+            *own[i] = *pages[i];
+            pages[i] = std::move(own[i]);
+        }
+    }
+    own.clear();
+    spare_pages.swap(own);                                  // Kept empty, but with its storage, so the next reset does not allocate it again
+
+    instructions_per_second = ips;
+    rng_seed = seed;
+    rng_state = rng_seed ? rng_seed : 0x2545F491;
+    compiled = code;
+    tier_threshold = threshold;
+    tier_generation = generation;
+    coverage_on = recording;
+    coverage.swap(recorded);
+
+    // The frames the template skipped were timed at its speed, and frame_remainder is carried on from them
+    if (rom.prefix_ips)
+        instructions_per_second = rom.prefix_ips;
+
+    resetBlocks();
+    checkCompiled();
+}
+
+
+bool ROMTemplate::load(const char *filename, Platform platform) {
+    prefix_ips = 0;
+    prefix_frames = 0;
+    prefix_instructions = 0;
+    image.setPlatform(platform);
+    return image.loadROM(filename);
+}
+
+
+bool ROMTemplate::load(const uint8_t *data, uint32_t size, Platform platform) {
+    prefix_ips = 0;
+    prefix_frames = 0;
+    prefix_instructions = 0;
+    image.setPlatform(platform);
+    return image.loadROM(data, size);
+}
+
+
+void ROMTemplate::setQuirks(const Quirks &q) {
+    image.setQuirks(q);
+}
+
+
+// The machine is stepped one instruction at a time so it can stop before an instruction that reads input, the image is only moved on at the end of a frame
+// The interpreter runs every instruction here, so the stats and coverage of the image stay empty
+unsigned long ROMTemplate::skipPrefix(unsigned int ips, unsigned long max_frames) {
+    prefix_ips = ips;
+    image.setSpeed(ips);
+
+    Chip8 machine = image.clone();
+    while (prefix_frames < max_frames && !machine.isHalted()) {
+        unsigned int count = machine.beginFrame();
+        unsigned int i = 0;
+        for (; i < count && !machine.isHalted(); i++) {
+            if (machine.readsInput())
+                return prefix_frames;
+            machine.emulateCycle();
+        }
+        machine.endFrame();
+
+        machine.cloneInto(image);
+        prefix_frames++;
+        prefix_instructions += i;
+    }
+    return prefix_frames;
+}
+
+
+unsigned long ROMTemplate::prefixFrames() const {
+    return prefix_frames;
+}
+
+
+uint64_t ROMTemplate::prefixInstructions() const {
+    return prefix_instructions;
+}
+
+
+void Chip8::setCompiledROM(const CompiledROM *code) {
+    compiled = code;
+    checkCompiled();
+}
+
+
+bool Chip8::isCompiled() {
+    return compiled_active;
+}
+
+
+// The generated code is only used on the exact ROM and platform it was generated from, with the platform's own quirks, anything else is interpreted
+void Chip8::checkCompiled() {
+    compiled_active = false;
+    if (compiled == NULL || compiled->platform != platform || quirks != platformQuirks(platform) || compiled->rom_size > memorySize() - PROGRAM_START_ADDRES)
+        return;
+
+    for (uint32_t i = 0; i < compiled->rom_size; i++) {
+        if (mem(PROGRAM_START_ADDRES + i) != compiled->rom[i])
+            return;
+    }
+    compiled_active = true;
+}
+
+
+
+
+void Chip8::setTiering(unsigned int threshold) {
+    tier_threshold = threshold;
+    resetBlocks();
+}
+
+
+TierStats Chip8::getTierStats() {
+    return tier_stats;
+}
+
+
+// Sized for XO-CHIP memory so the platform can change while recording
+void Chip8::setCoverage(bool on) {
+    coverage_on = on;
+    if (on)
+        coverage.assign(XO_MEMORY_SIZE / 64, 0);
+}
+
+
+// What was recorded stays readable after recording stops
+bool Chip8::isCovered(uint32_t address) {
+    address &= memory_mask;
+    return !coverage.empty() && (coverage[address / 64] >> (address % 64)) & 1;
+}
+
+
+// A fresh cache for the current memory size, blocks that clones are still using stay with them
+void Chip8::resetBlocks() {
+    block_cache = NULL;
+    if (tier_threshold) {
+        block_cache = std::make_shared<BlockCache>();
+        block_cache->block_at.assign(memorySize(), 0);
+        block_cache->covered.assign(memorySize(), 0);
+    }
+    tier_generation++;
+    block_entry = true;
+}
+
+
+// Blocks are only looked up where one starts, anywhere else (the frame ended inside a block, or a block was demoted while it ran) is interpreted up to the end of the block
+unsigned int Chip8::runTiered(unsigned int count) {
+    unsigned int done = 0;
+
+    while (done < count) {
+        if (halted)
+            return count;               // The rest would do nothing
+
+        if (block_entry) {
+            TierBlock *block = enterBlock();
+            if (block) {
+                done += runBlock(*block, count - done);
+                continue;
+            }
+        }
+
+        emulateCycle();
+        tier_stats.interpreted++;
+        done++;
+        block_entry = endsBlock(decodeOpcode(opcode));
+    }
+
+    return done;
+}
+
+
+// The cache is only copied away from clones when a block is counted or promoted, running promoted blocks leaves it shared
+Chip8::TierBlock *Chip8::enterBlock() {
+    uint16_t index = block_cache->block_at[pc];
+    if (index && block_cache->blocks[index - 1].promoted)
+        return &block_cache->blocks[index - 1];
+
+    if (block_cache.use_count() != 1)
+        block_cache = std::make_shared<BlockCache>(*block_cache);
+    BlockCache &cache = *block_cache;
+
+    if (!index) {
+        if (cache.blocks.size() == UINT16_MAX)
+            return NULL;                // Only self-modifying code jumping all over memory gets here, it stays interpreted
+        cache.blocks.push_back({pc, 0, 0, false, {}, NULL, 0, 0});
+        index = cache.blocks.size();
+        cache.block_at[pc] = index;
+    }
 
-Chip8::Chip8() {
-    initialize();
+    TierBlock &block = cache.blocks[index - 1];
+    if (++block.entries < tier_threshold)
+        return NULL;
+
+    promoteBlock(cache, block);
+    return &block;
 }
 
 
-// Initializes the registers and memory
-void Chip8::initialize() {
-    drawFlag = true;
+// Decodes the block from memory as it is now, demoteBlocks() throws it away if that changes
+void Chip8::promoteBlock(BlockCache &cache, TierBlock &block) {
+    const unsigned int MAX_BLOCK_LENGTH = 64;               // Instructions, so a block that runs on through memory is not decoded all at once
 
-    pc = PROGRAM_START_ADDRES;          // 0x200 is where Chip8 programs start
-                                        // 0x000 to 0x1FF are where the original interpreter was located and should not be used
+    block.ops.clear();
+    uint32_t address = block.start;
+    uint32_t size = 0;
+    while (block.ops.size() < MAX_BLOCK_LENGTH) {
+        uint16_t op = (mem(address) << 8) | mem(address + 1);
+        opTable handler = decodeOpcode(op);
+        block.ops.push_back({handler, handler, NULL, op, (uint16_t)((address + 2) & memory_mask), 1, 0});
 
-    sp = 0;                             // Reset stack pointer
-    I = 0;                              // Reset index register 
-    opcode = 0;                         // Reset current opcode 
+        unsigned int length = (platform == PLATFORM_XOCHIP && op == 0xF000) ? 4 : 2;
+        address = (address + length) & memory_mask;
+        size += length;
+        if (endsBlock(handler))
+            break;
+    }
 
-    delay_timer = 0;                    // Reset delay timer
-    sound_timer = 0;                    // Reset sound timer
+    block.size = size;
+    fuseBlock(block);
+    removeDeadFlags(block);
 
-    // Clear registers and keypad
-    for (int i = 0; i < REGISTER_COUNT; i++) {
-        keypad[i] = V[i] = 0;
+    block.promoted = true;
+    for (uint32_t i = 0; i < block.size; i++) {
+        cache.covered[(block.start + i) & memory_mask]++;
     }
+    tier_stats.promoted++;
+}
 
-    // Clear video display
-    for (int i = 0; i < VIDEO_WIDTH * VIDEO_HEIGHT; i++) {       
-        video[i] = 0;
+
+// Sequences are matched on the functions the platform's tables picked, so an instruction the platform does not have is never fused
+void Chip8::fuseBlock(TierBlock &block) {
+    std::vector<TierOp> &ops = block.ops;
+
+    // A loop is a block of two instructions ending in a skip, followed by a jump back to the start of the block
+    // 1nnn only reaches the first 4KB, so XO-CHIP code above that is never a loop
+    block.loop = NULL;
+    uint32_t tail = (block.start + block.size) & memory_mask;
+    uint16_t jump = (mem(tail) << 8) | mem(tail + 1);
+    bool reachable = block.start <= 0x0FFF;
+    if (reachable && ops.size() == 2 && ops[1].handler == &Chip8::OP_3xkk && jump == (0x1000 | block.start)) {
+        if (ops[0].handler == &Chip8::OP_Fx07) {
+            block.loop = &Chip8::LOOP_TimerWait;
+            block.loop_fusion = FUSE_TIMER_WAIT;
+        } else if (ops[0].handler == &Chip8::OP_7xkk) {
+            block.loop = &Chip8::LOOP_Counted;
+            block.loop_fusion = FUSE_COUNTED_LOOP;
+        }
+        if (block.loop)
+            block.size += 2;                                // A write to the jump back has to demote the block too
+    }
+    if (reachable && ops.size() == 1 && ops[0].opcode == (0x1000 | block.start)) {
+        block.loop = &Chip8::LOOP_Idle;
+        block.loop_fusion = FUSE_IDLE_LOOP;
     }
 
-    // Clear memory
-    for (int i = 0; i < MEMORY_SIZE; i++) {
-        memory[i] = 0;
+    for (size_t i = 0; i + 1 < ops.size(); i++) {
+        opTable first = ops[i].handler;
+        opTable second = ops[i + 1].handler;
+
+        if (first == &Chip8::OP_Annn && second == &Chip8::OP_Dxyn) {
+            ops[i].fused = &Chip8::FUSED_LoadDraw;
+            ops[i].fusion = FUSE_LOAD_DRAW;
+        } else if (first == &Chip8::OP_6xkk && second == &Chip8::OP_Fx15) {
+            ops[i].fused = &Chip8::FUSED_SetTimer;
+            ops[i].fusion = FUSE_SET_TIMER;
+        } else if (first == &Chip8::OP_Fx1E && second == &Chip8::OP_Fx65) {
+            ops[i].fused = &Chip8::FUSED_TableLoad;
+            ops[i].fusion = FUSE_TABLE_LOAD;
+        } else {
+            continue;
+        }
+        ops[i].length = 2;
+        i++;                                                // The second instruction is part of this superinstruction, it cannot start one
     }
+}
 
-    // Load fonts (sprites 0-F) into memory from address 0x050 to 0x0A0
-    for (int i = 0; i < FONTSET_SIZE; i++) {
-        memory[FONTSET_START_ADDRESS + i] = chip8_fontset[i];
+
+void Chip8::demoteBlocks(uint32_t address) {
+    if (block_cache.use_count() != 1)
+        block_cache = std::make_shared<BlockCache>(*block_cache);
+    BlockCache &cache = *block_cache;
+
+    for (TierBlock &block : cache.blocks) {
+        if (!block.promoted || ((address - block.start) & memory_mask) >= block.size)
+            continue;
+
+        for (uint32_t i = 0; i < block.size; i++) {
+            cache.covered[(block.start + i) & memory_mask]--;
+        }
+        block.promoted = false;
+        block.entries = 0;
+        tier_stats.demoted++;
     }
+    tier_generation++;
+}
 
-    // Clear stack
-    for (int i = 0; i < STACK_SIZE; i++) {
-        stack[i] = 0;
+
+// Runs the block's instructions without fetching or decoding them, stopping after limit of them
+// Returns how many ran -- fewer if an instruction wrote over the block, which may already have been freed
+inline unsigned int Chip8::runBlock(const TierBlock &block, unsigned int limit) {
+    const TierOp *op = block.ops.data();
+    unsigned int size = block.ops.size();
+
+    // A loop needs room for at least one trip round it, including the jump back
+    if (block.loop && limit > size) {
+        unsigned int ran = (this->*(block.loop))(op, limit);
+        if (coverage_on) {
+            coverOps(op, std::min(ran, size));
+            uint32_t jump = (block.start + block.size - 2) & memory_mask;
+            if (ran > size)
+                coverage[jump / 64] |= 1ull << (jump % 64);
+        }
+        pc &= memory_mask;
+        block_entry = true;
+        tier_stats.predecoded += ran;
+        tier_stats.fused[block.loop_fusion] += ran;
+        return ran;
     }
 
+    // VF is only left out when the whole block runs, so wherever the frame ends the registers are exactly what stepping would leave
+    uint32_t generation = tier_generation;
+    unsigned int count = std::min(size, limit);
+    bool whole = count == size;
+    unsigned int i = 0;
+    while (i < count) {
+        // Coverage is recorded before each instruction runs, while the block is known to still be there
+        if (op[i].fused && count - i >= op[i].length) {
+            if (coverage_on)
+                coverOps(&op[i], op[i].length);
+            (this->*(op[i].fused))(&op[i]);
+            tier_stats.fused[op[i].fusion] += op[i].length;
+            i += op[i].length;
+        } else {
+            if (coverage_on)
+                coverOps(&op[i], 1);
+            opcode = op[i].opcode;
+            pc = op[i].pc;
+            (this->*(whole ? op[i].whole : op[i].handler))();
+            i++;
+        }
 
-    // Set up function pointer table for opcodes
-        OpcodeTable[0x0] = &Chip8::getTable0;
-        OpcodeTable[0x1] = &Chip8::OP_1nnn;
-        OpcodeTable[0x2] = &Chip8::OP_2nnn;
-        OpcodeTable[0x3] = &Chip8::OP_3xkk;
-        OpcodeTable[0x4] = &Chip8::OP_4xkk;
-        OpcodeTable[0x5] = &Chip8::OP_5xy0;
-        OpcodeTable[0x6] = &Chip8::OP_6xkk;
-        OpcodeTable[0x7] = &Chip8::OP_7xkk;
-        OpcodeTable[0x8] = &Chip8::getTable8;
-        OpcodeTable[0x9] = &Chip8::OP_9xy0;
-        OpcodeTable[0xA] = &Chip8::OP_Annn;
-        OpcodeTable[0xB] = &Chip8::OP_Bnnn;
-        OpcodeTable[0xC] = &Chip8::OP_Cxkk;
-        OpcodeTable[0xD] = &Chip8::OP_Dxyn;
-        OpcodeTable[0xE] = &Chip8::getTableE;
-        OpcodeTable[0xF] = &Chip8::getTableF;
-
-
-    // Initialize opcode tables 0, 8, and E with all NULL values
-    for (int i = 0; i < 0xE + 1; i++) {
-        OpcodeTable_0[i] = &Chip8::OP_NULL;
-        OpcodeTable_8[i] = &Chip8::OP_NULL;
-        OpcodeTable_E[i] = &Chip8::OP_NULL;
+        if (tier_generation != generation)
+            break;
     }
 
-    // Fill the proper indices with their opcodes
-    OpcodeTable_0[0x0] = &Chip8::OP_00E0;
-    OpcodeTable_0[0xE] = &Chip8::OP_00EE;
+    pc &= memory_mask;
+    block_entry = tier_generation == generation && i == size;
+    if (block_entry && whole)
+        tier_stats.dead_flags += block.dead_flags;
+    tier_stats.predecoded += i;
+    return i;
+}
 
-    OpcodeTable_8[0x0] = &Chip8::OP_8xy0;
-    OpcodeTable_8[0x1] = &Chip8::OP_8xy1;
-    OpcodeTable_8[0x2] = &Chip8::OP_8xy2;
-    OpcodeTable_8[0x3] = &Chip8::OP_8xy3;
-    OpcodeTable_8[0x4] = &Chip8::OP_8xy4;
-    OpcodeTable_8[0x5] = &Chip8::OP_8xy5;
-    OpcodeTable_8[0x6] = &Chip8::OP_8xy6;
-    OpcodeTable_8[0x7] = &Chip8::OP_8xy7;
-    OpcodeTable_8[0xE] = &Chip8::OP_8xyE;
 
-    OpcodeTable_E[0xE] = &Chip8::OP_Ex9E;
-    OpcodeTable_E[0x1] = &Chip8::OP_ExA1;
+void Chip8::coverOps(const TierOp *op, unsigned int count) {
+    for (unsigned int i = 0; i < count; i++) {
+        uint32_t address = (op[i].pc - 2) & memory_mask;
+        coverage[address / 64] |= 1ull << (address % 64);
+    }
+}
+
 
+// Goes backwards through the block, keeping track of whether VF is read before it is next overwritten
+// VF counts as read at the end of the block, since whatever runs next may read it
+void Chip8::removeDeadFlags(TierBlock &block) {
+    static const opTable WITH_FLAG[] = {
+        &Chip8::OP_8xy1, &Chip8::OP_8xy2, &Chip8::OP_8xy3, &Chip8::OP_8xy4, &Chip8::OP_8xy5, &Chip8::OP_8xy6, &Chip8::OP_8xy7, &Chip8::OP_8xyE, &Chip8::OP_Dxyn
+    };
+    static const opTable WITHOUT_FLAG[] = {
+        &Chip8::NOVF_8xy1, &Chip8::NOVF_8xy2, &Chip8::NOVF_8xy3, &Chip8::NOVF_8xy4, &Chip8::NOVF_8xy5, &Chip8::NOVF_8xy6, &Chip8::NOVF_8xy7, &Chip8::NOVF_8xyE, &Chip8::NOVF_Dxyn
+    };
+
+    std::vector<TierOp> &ops = block.ops;
+    block.dead_flags = 0;
+    bool live = true;
+    for (size_t i = ops.size(); i-- > 0;) {
+        TierOp &op = ops[i];
+        op.whole = op.handler;
+
+        // Superinstructions always run their instructions in full
+        bool fused = op.fused || (i > 0 && ops[i - 1].fused);
+        bool overwrites = overwritesVF(op);
+        if (!live && overwrites && !fused) {
+            for (size_t f = 0; f < sizeof(WITH_FLAG) / sizeof(WITH_FLAG[0]); f++) {
+                if (op.handler == WITH_FLAG[f]) {
+                    op.whole = WITHOUT_FLAG[f];
+                    block.dead_flags++;
+                }
+            }
+        }
 
-    // Initialize opcode table F with all NULL values
-    for (int i = 0; i < 0x65 + 1; i++) {
-        OpcodeTable_F[i] = &Chip8::OP_NULL;
+        if (overwrites)
+            live = false;
+        if (readsVF(op))
+            live = true;
     }
+}
 
-    // Fill the proper indices with their opcodes
-    OpcodeTable_F[0x07] = &Chip8::OP_Fx07;
-    OpcodeTable_F[0x0A] = &Chip8::OP_Fx0A;
-    OpcodeTable_F[0x15] = &Chip8::OP_Fx15;
-    OpcodeTable_F[0x18] = &Chip8::OP_Fx18;
-    OpcodeTable_F[0x1E] = &Chip8::OP_Fx1E;
-    OpcodeTable_F[0x29] = &Chip8::OP_Fx29;
-    OpcodeTable_F[0x33] = &Chip8::OP_Fx33;
-    OpcodeTable_F[0x55] = &Chip8::OP_Fx55;
-    OpcodeTable_F[0x65] = &Chip8::OP_Fx65;
 
-    // Initialize seed for random number generator
-    srand(time(NULL));
+// Apart from the instructions that only write Vx, any instruction with VF as its x or y is taken to read it, which is more often than it really does
+// Writes to memory count as reads too: they can demote the block part way through, and the instruction that was going to overwrite VF would then never run
+bool Chip8::readsVF(const TierOp &op) {
+    opTable handler = op.handler;
+    if (handler == &Chip8::OP_Fx55 || handler == &Chip8::OP_Fx33 || handler == &Chip8::OP_5xy2)
+        return true;
+
+    bool yIsVF = (op.opcode & 0x00F0) == 0x00F0;
+    if (handler == &Chip8::OP_6xkk || handler == &Chip8::OP_Cxkk || handler == &Chip8::OP_Fx07)
+        return false;
+    if (handler == &Chip8::OP_8xy0)
+        return yIsVF;
+
+    return (op.opcode & 0x0F00) == 0x0F00 || yIsVF;
 }
 
 
+// True if the instruction always writes VF, whatever VF held before
+bool Chip8::overwritesVF(const TierOp &op) {
+    opTable handler = op.handler;
+    if (handler == &Chip8::OP_8xy4 || handler == &Chip8::OP_8xy5 || handler == &Chip8::OP_8xy6 || handler == &Chip8::OP_8xy7 ||
+        handler == &Chip8::OP_8xyE || handler == &Chip8::OP_Dxyn)
+        return true;
 
+    if (handler == &Chip8::OP_8xy1 || handler == &Chip8::OP_8xy2 || handler == &Chip8::OP_8xy3)
+        return quirks.vf_reset;
 
-// Index into OpcodeTable_0 based on the last hex digit of the opcode
-void Chip8::getTable0() {
-    int index = opcode & 0x000F;
+    bool toVF = (op.opcode & 0x0F00) == 0x0F00;
+    return toVF && (handler == &Chip8::OP_6xkk || handler == &Chip8::OP_8xy0 || handler == &Chip8::OP_Cxkk || handler == &Chip8::OP_Fx07);
+}
 
-    // Dereference OpcodeTable_0 and call the function at the index
-    (this->*(OpcodeTable_0[index]))();
+
+// Follows the getTable functions down to the instruction itself
+Chip8::opTable Chip8::decodeOpcode(uint16_t op) {
+    switch (op >> 12) {
+        case 0x0 : return tables->OpcodeTable_0[op & 0x00FF];
+        case 0x5 : return tables->OpcodeTable_5[op & 0x000F];
+        case 0x8 : return tables->OpcodeTable_8[op & 0x000F];
+        case 0xE : return tables->OpcodeTable_E[op & 0x000F];
+        case 0xF : return tables->OpcodeTable_F[op & 0x00FF];
+        default : return tables->OpcodeTable[op >> 12];
+    }
 }
 
 
-// Index into OpcodeTable_8 based on the last hex digit of the opcode
-void Chip8::getTable8() {
-    int index = opcode & 0x000F;
+bool Chip8::endsBlock(opTable handler) {
+    static const opTable ENDS_BLOCK[] = {
+        &Chip8::OP_00EE, &Chip8::OP_00FD, &Chip8::OP_1nnn, &Chip8::OP_2nnn, &Chip8::OP_3xkk, &Chip8::OP_4xkk, &Chip8::OP_5xy0,
+        &Chip8::OP_9xy0, &Chip8::OP_Bnnn, &Chip8::OP_Ex9E, &Chip8::OP_ExA1, &Chip8::OP_Fx0A
+    };
 
-    // Dereference OpcodeTable_8 and call the function at the index
-    (this->*(OpcodeTable_8[index]))();
+    for (opTable end : ENDS_BLOCK) {
+        if (handler == end)
+            return true;
+    }
+    return false;
 }
 
 
-// Index into OpcodeTable_E based on the last hex digit of the opcode
-void Chip8::getTableE() {
-    int index = opcode & 0x000F;
 
-    // Dereference OpcodeTable_E and call the function at the index
-    (this->*(OpcodeTable_E[index]))();
+// Annn Dxyn -- a sprite address loaded just before it is drawn
+void Chip8::FUSED_LoadDraw(const TierOp *op) {
+    I = op[0].opcode & 0x0FFF;
+    opcode = op[1].opcode;
+    pc = op[1].pc;
+    OP_Dxyn();
 }
 
 
-// Index into OpcodeTable_F based on the last two hex digits of the opcode
-void Chip8::getTableF() {
-    int index = opcode & 0x00FF;
+// 6xkk Fy15 -- a delay loaded into a register and then into the delay timer
+void Chip8::FUSED_SetTimer(const TierOp *op) {
+    V[(op[0].opcode & 0x0F00) >> 8] = op[0].opcode & 0x00FF;
+    opcode = op[1].opcode;
+    pc = op[1].pc;
+    OP_Fx15();
+}
 
-    // Dereference OpcodeTable_0 and call the function at the index
-    (this->*(OpcodeTable_F[index]))();
+
+// Fx1E Fy65 -- an index added to I and the table entry there loaded into registers
+void Chip8::FUSED_TableLoad(const TierOp *op) {
+    opcode = op[0].opcode;
+    OP_Fx1E();
+    opcode = op[1].opcode;
+    pc = op[1].pc;
+    OP_Fx65();
 }
 
 
+// Fx07 3ykk 1nnn -- waits for the delay timer, which only changes between frames
+// Every trip round the loop leaves the machine the same, so the trips left in the frame are run by counting them
+unsigned int Chip8::LOOP_TimerWait(const TierOp *op, unsigned int limit) {
+    V[(op[0].opcode & 0x0F00) >> 8] = delay_timer;
+    opcode = op[1].opcode;
+    pc = op[1].pc;
+    OP_3xkk();
+    if (pc != op[1].pc)
+        return 2;                                           // The wait is over
 
+    opcode = 0x1000 | (op[0].pc - 2);
+    pc = op[0].pc - 2;
+    return limit / 3 * 3;
+}
 
-// Every cycle the CPU will fetch the opcode, decode the opcode, execute the opcode, and update timers
-void Chip8::emulateCycle() {
-    // Fetch Opcode
-    opcode = (memory[pc] << 8) | memory[pc+1];      // Each opcode is 2 bytes long
-                                                    // Need to merge the two halves in memory
 
-    pc += 2;
+// 7xkk 3ykk 1nnn -- counts a register up until it reaches a value
+unsigned int Chip8::LOOP_Counted(const TierOp *op, unsigned int limit) {
+    uint8_t x = (op[0].opcode & 0x0F00) >> 8;
+    uint8_t add = op[0].opcode & 0x00FF;
+    uint8_t y = (op[1].opcode & 0x0F00) >> 8;
+    uint8_t until = op[1].opcode & 0x00FF;
+
+    unsigned int ran = 0;
+    for (; ran + 3 <= limit; ran += 3) {
+        V[x] += add;
+        if (V[y] == until) {
+            opcode = op[1].opcode;
+            pc = op[1].pc;
+            skipInstruction();
+            return ran + 2;
+        }
+    }
 
-    // Decode and Execute Opcode
-    (this->*(OpcodeTable[(opcode & 0xF000) >> 12]))();
+    opcode = 0x1000 | (op[0].pc - 2);
+    pc = op[0].pc - 2;
+    return ran;
 }
 
 
+// 1nnn to itself -- the program has stopped, but the frame still has to use up its instructions
+unsigned int Chip8::LOOP_Idle(const TierOp *op, unsigned int limit) {
+    opcode = op[0].opcode;
+    pc = op[0].pc - 2;
+    return limit;
+}
 
 
-// Updates the delay timer and sound timer and plays a tone while the sound timer is > 0
-void Chip8::updateTimers() {
-    if (delay_timer) 
-        delay_timer--;
-    
-    if (sound_timer) {
-        std::cout << "BEEP" << std::endl;
-        sound_timer--;
-    }
+
+// Vx is still worked out exactly as the OP_ function does, including the shift_vy quirk
+void Chip8::NOVF_8xy1() {
+    V[(opcode & 0x0F00) >> 8] |= V[(opcode & 0x00F0) >> 4];
 }
 
 
+void Chip8::NOVF_8xy2() {
+    V[(opcode & 0x0F00) >> 8] &= V[(opcode & 0x00F0) >> 4];
+}
 
 
-// Load a program into memory starting from memory address 0x200
-bool Chip8::loadROM(const char *filename) {
-    initialize();
+void Chip8::NOVF_8xy3() {
+    V[(opcode & 0x0F00) >> 8] ^= V[(opcode & 0x00F0) >> 4];
+}
 
-    FILE *fp;
-    fp = fopen(filename, "rb");
-    if (fp == NULL) {
-        std::cout << "ERROR: Could not open file" << std::endl << std::endl;
-        return false;
-    }
 
-    // Obtain size of file
-    long fsize;
-    fseek(fp , 0 , SEEK_END);
-    fsize = ftell(fp);
-    rewind(fp);
+void Chip8::NOVF_8xy4() {
+    V[(opcode & 0x0F00) >> 8] += V[(opcode & 0x00F0) >> 4];
+}
 
-    // If file is larger than memory allows, throw an error
-    if (fsize > (MEMORY_SIZE - 0x200)) {
-        std::cout << "ERROR: File is too large" << std::endl << "File must be of size " << MEMORY_SIZE - 0x200 << " or smaller" << std::endl << std::endl;
-        std::cout << fsize;
-        return false;
-    }
 
-    // Put the contents of the file in memory starting at address 0x200
-    if (fread(&(memory[0x200]), 1, fsize, fp) != fsize) {
-        std::cout << "ERROR: File reading error" << std::endl << std::endl;
-        return false;
-    }
+void Chip8::NOVF_8xy5() {
+    V[(opcode & 0x0F00) >> 8] -= V[(opcode & 0x00F0) >> 4];
+}
 
-    fclose(fp);
-    return true;
+
+void Chip8::NOVF_8xy6() {
+    uint8_t x = (opcode & 0x0F00) >> 8;
+    uint8_t y = (opcode & 0x00F0) >> 4;
+    if (quirks.shift_vy)
+        V[x] = V[y];
+
+    V[x] >>= 1;
+}
+
+
+void Chip8::NOVF_8xy7() {
+    uint8_t x = (opcode & 0x0F00) >> 8;
+    uint8_t y = (opcode & 0x00F0) >> 4;
+
+    V[x] = V[y] - V[x];
+}
+
+
+void Chip8::NOVF_8xyE() {
+    uint8_t x = (opcode & 0x0F00) >> 8;
+    uint8_t y = (opcode & 0x00F0) >> 4;
+    if (quirks.shift_vy)
+        V[x] = V[y];
+
+    V[x] <<= 1;
+}
+
+
+// Draws without checking each row for collisions
+void Chip8::NOVF_Dxyn() {
+    drawSprite(false);
 }
 
 
@@ -252,27 +1534,136 @@ bool Chip8::loadROM(const char *filename) {
 void Chip8::OP_NULL(){}
 
 // Clear the display
+// On XO-CHIP only the selected bitplanes are cleared
 void Chip8::OP_00E0() {
     drawFlag = true;
 
-    for (int i = 0; i < VIDEO_WIDTH * VIDEO_HEIGHT; i++) {       
-        video[i] = 0;
+    for (int p = 0; p < PLANE_COUNT; p++) {
+        if (!(planes & (1 << p)))
+            continue;
+
+        for (int i = 0; i < VIDEO_HEIGHT; i++) {       
+            video[p][i] = 0;
+        }
+        dirty_rows[p] = ~0ull;
     }
 }
 
 // Return from a subroutine
+// Returning with an empty stack stops the interpreter
 void Chip8::OP_00EE() {
+    if (sp == 0) {
+        fault = "Stack underflow";
+        halted = true;
+        return;
+    }
+
     sp--;
     pc = stack[sp];
 }
 
+// Scroll the display down n lines, the lines scrolled in at the top are blank
+// Moving whole packed rows is a single memmove
+// Like every scroll, only the selected bitplanes move
+void Chip8::OP_00Cn() {
+    drawFlag = true;
+
+    unsigned int n = opcode & 0x000F;
+    unsigned int height = screenHeight();
+    if (n > height)
+        n = height;
+
+    for (int p = 0; p < PLANE_COUNT; p++) {
+        if (!(planes & (1 << p)))
+            continue;
+
+        memmove(&video[p][n], &video[p][0], (height - n) * sizeof(VideoRow));
+        memset(&video[p][0], 0, n * sizeof(VideoRow));
+        dirty_rows[p] = ~0ull;
+    }
+}
+
+// Scroll the display up n lines, the lines scrolled in at the bottom are blank
+void Chip8::OP_00Dn() {
+    drawFlag = true;
+
+    unsigned int n = opcode & 0x000F;
+    unsigned int height = screenHeight();
+    if (n > height)
+        n = height;
+
+    for (int p = 0; p < PLANE_COUNT; p++) {
+        if (!(planes & (1 << p)))
+            continue;
+
+        memmove(&video[p][0], &video[p][n], (height - n) * sizeof(VideoRow));
+        memset(&video[p][height - n], 0, n * sizeof(VideoRow));
+        dirty_rows[p] = ~0ull;
+    }
+}
+
+// Scroll the display right 4 pixels, pixels scrolled past the right edge are lost
+void Chip8::OP_00FB() {
+    drawFlag = true;
+
+    VideoRow mask = rowMask();
+    for (int p = 0; p < PLANE_COUNT; p++) {
+        if (!(planes & (1 << p)))
+            continue;
+
+        for (int i = 0; i < VIDEO_HEIGHT; i++) {
+            video[p][i] = (video[p][i] >> 4) & mask;
+        }
+        dirty_rows[p] = ~0ull;
+    }
+}
+
+// Scroll the display left 4 pixels, pixels scrolled past the left edge are lost
+void Chip8::OP_00FC() {
+    drawFlag = true;
+
+    for (int p = 0; p < PLANE_COUNT; p++) {
+        if (!(planes & (1 << p)))
+            continue;
+
+        for (int i = 0; i < VIDEO_HEIGHT; i++) {
+            video[p][i] = video[p][i] << 4;
+        }
+        dirty_rows[p] = ~0ull;
+    }
+}
+
+// Exit the interpreter, no further instructions are executed
+void Chip8::OP_00FD() {
+    halted = true;
+}
+
+// Switch to low resolution (64x32) and clear the display
+void Chip8::OP_00FE() {
+    hires = false;
+    OP_00E0();
+}
+
+// Switch to high resolution (128x64) and clear the display
+void Chip8::OP_00FF() {
+    hires = true;
+    OP_00E0();
+}
+
 // Jump to address nnn
 void Chip8::OP_1nnn() {
     pc = opcode & 0x0FFF;
 }
 
 // Call subroutine at address nnn
+// Calling with a full stack stops the interpreter
 void Chip8::OP_2nnn() {
+    if (sp == STACK_SIZE) {
+        fault = "Stack overflow";
+        halted = true;
+        return;
+    }
+
     stack[sp] = pc;
     sp++;
     pc = opcode & 0x0FFF;
@@ -284,7 +1675,7 @@ void Chip8::OP_3xkk() {
     uint8_t kk = opcode & 0x00FF;
 
     if (V[x] == kk) {
-        pc += 2;
+        skipInstruction();
     }
 }
 
@@ -294,7 +1685,7 @@ void Chip8::OP_4xkk() {
     uint8_t kk = opcode & 0x00FF;
 
     if (V[x] != kk) {
-        pc += 2;
+        skipInstruction();
     }
 }
 
@@ -304,7 +1695,31 @@ void Chip8::OP_5xy0() {
     uint8_t y = (opcode & 0x00F0) >> 4;
 
     if (V[x] == V[y]) {
-        pc += 2;
+        skipInstruction();
+    }
+}
+
+// Store registers Vx through Vy in memory starting at location I, I is not changed
+// If x > y the registers are stored in reverse order
+void Chip8::OP_5xy2() {
+    uint8_t x = (opcode & 0x0F00) >> 8;
+    uint8_t y = (opcode & 0x00F0) >> 4;
+    int step = x <= y ? 1 : -1;
+
+    for (int i = 0; i <= abs(y - x); i++) {
+        storeMemory(I + i, V[x + i * step]);
+    }
+}
+
+// Load registers Vx through Vy from memory starting at location I, I is not changed
+// If x > y the registers are loaded in reverse order
+void Chip8::OP_5xy3() {
+    uint8_t x = (opcode & 0x0F00) >> 8;
+    uint8_t y = (opcode & 0x00F0) >> 4;
+    int step = x <= y ? 1 : -1;
+
+    for (int i = 0; i <= abs(y - x); i++) {
+        V[x + i * step] = mem(I + i);
     }
 }
 
@@ -333,33 +1748,36 @@ void Chip8::OP_8xy0() {
 }
 
 // Set Vx = Vx OR Vy
-// Also resets VF
+// Also resets VF (except on SUPER-CHIP)
 void Chip8::OP_8xy1() {
     uint8_t x = (opcode & 0x0F00) >> 8;
     uint8_t y = (opcode & 0x00F0) >> 4;
 
     V[x] = V[x] | V[y];
-    V[0xF] = 0;
+    if (quirks.vf_reset)
+        V[0xF] = 0;
 }
 
 // Set Vx = Vx AND Vy
-// Also resets VF
+// Also resets VF (except on SUPER-CHIP)
 void Chip8::OP_8xy2() {
     uint8_t x = (opcode & 0x0F00) >> 8;
     uint8_t y = (opcode & 0x00F0) >> 4;
 
     V[x] = V[x] & V[y];
-    V[0xF] = 0;
+    if (quirks.vf_reset)
+        V[0xF] = 0;
 }
 
 // Set Vx = Vx XOR Vy
-// Also resets VF
+// Also resets VF (except on SUPER-CHIP)
 void Chip8::OP_8xy3() {
     uint8_t x = (opcode & 0x0F00) >> 8;
     uint8_t y = (opcode & 0x00F0) >> 4;
 
     V[x] = V[x] ^ V[y];
-    V[0xF] = 0;
+    if (quirks.vf_reset)
+        V[0xF] = 0;
 }
 
 // Set Vx = Vx + Vy 
@@ -398,10 +1816,13 @@ void Chip8::OP_8xy5() {
 
 // If the least significant bit of Vx is 1, VF = 1, otherwise VF = 0
 // Divide Vx by 2
-// This variation of the opcode doesn't actually use Vy
+// Vy is only used with the shift_vy quirk, where Vy is shifted and stored in Vx
 // VF can also be either Vx or Vy
 void Chip8::OP_8xy6() {
     uint8_t x = (opcode & 0x0F00) >> 8;
+    uint8_t y = (opcode & 0x00F0) >> 4;
+    if (quirks.shift_vy)
+        V[x] = V[y];
     uint8_t lsb = V[x] & 0x1;
 
     V[x] = V[x] >> 1;
@@ -426,10 +1847,13 @@ void Chip8::OP_8xy7() {
 
 // If the most significant bit of Vx is 1, VF = 1, otherwise VF = 0
 // Multiply Vx by 2
-// This variation of the opcode doesn't actually use Vy
+// Vy is only used with the shift_vy quirk, where Vy is shifted and stored in Vx
 // VF can also be either Vx or Vy
 void Chip8::OP_8xyE() {
     uint8_t x = (opcode & 0x0F00) >> 8;
+    uint8_t y = (opcode & 0x00F0) >> 4;
+    if (quirks.shift_vy)
+        V[x] = V[y];
     uint8_t msb = (V[x] & 0x80) >> 7;
     uint16_t val = V[x] << 1;
 
@@ -443,7 +1867,7 @@ void Chip8::OP_9xy0() {
     uint8_t y = (opcode & 0x00F0) >> 4;
 
     if (V[x] != V[y])
-        pc += 2;
+        skipInstruction();
 }
 
 // Set I = nnn
@@ -452,8 +1876,11 @@ void Chip8::OP_Annn() {
 }
 
 // Jump to location nnn + V0
+// With the jump_vx quirk (SUPER-CHIP) the opcode is read as Bxnn and jumps to xnn + Vx instead
 void Chip8::OP_Bnnn() {
-    pc = (opcode & 0x0FFF) + V[0x0];
+    uint8_t x = quirks.jump_vx ? (opcode & 0x0F00) >> 8 : 0x0;
+
+    pc = (opcode & 0x0FFF) + V[x];
 }
 
 // Generate a random byte between 0 and 255 and AND it with kk
@@ -461,62 +1888,84 @@ void Chip8::OP_Bnnn() {
 void Chip8::OP_Cxkk() {
     uint8_t x = (opcode & 0x0F00) >> 8;
     uint8_t kk = opcode & 0x00FF;
-    int random = rand() % 256;
 
-    V[x] = random & kk;
+    V[x] = nextRandom() & kk;
 }
 
 // Read n bytes of memory starting at the address stored in I
 // Display these bytes as sprites on the screen at coordinates (Vx, Vy)
 // Sprites are XOR'd onto the screen - if this causes sprites to be erased set VF = 1, otherwise VF = 0
-// Sprites do not wrap around the edges of the screen - if they reach the edges they are clipped and cut off
-// Coordinates wrap, so if x > 63 or y > 32, then x = x % 64 or y = y % 32, respectively
+// Sprites do not wrap around the edges of the screen - if they reach the edges they are clipped and cut off (except with the wrap quirk on XO-CHIP)
+// Coordinates wrap, so if x > 63 or y > 31, then x = x % 64 or y = y % 32, respectively (x % 128 and y % 64 in high resolution)
 // A sprite is a group of bytes which are a binary representation of the desired picture - Chip-8 sprites may be up to 15 bytes, for a possible sprite size of 8x15
+// On SUPER-CHIP and XO-CHIP, Dxy0 draws a 16x16 sprite made of 32 bytes, two bytes per row
+// On XO-CHIP the sprite is drawn to each selected bitplane in turn, with the data for each plane following on from the last
+// Each sprite row is shifted into place across a whole packed display row, so the row is drawn with one XOR and checked for collisions with one AND
 void Chip8::OP_Dxyn() {
+    drawSprite(true);
+}
+
+
+inline void Chip8::drawSprite(bool collision) {
     drawFlag = true;
 
     uint8_t x = (opcode & 0x0F00) >> 8;
     uint8_t y = (opcode & 0x00F0) >> 4;
     uint8_t n = (opcode & 0x000F);
-    if (V[x] > 63)
-        V[x] = V[x] % 64;
-    if (V[y] > 31)
-        V[y] = V[y] % 32;
-
-    uint16_t vidx = (VIDEO_WIDTH * V[y]) + V[x];                // Index into the video buffer
-    uint16_t start_vidx = vidx;                                 // Keeps track of what index the sprite will start being drawn from in each row
-    uint16_t end_vidx = (VIDEO_WIDTH * V[y]) + VIDEO_WIDTH-1;   // Keeps track of what index the end of each row is at in case the sprite is clipped
-
-    V[0xF] = 0;
-    for (int i = 0; i < n; i++) {
-
-        // Draw one row of bits
-        uint8_t bit = 0x80;                                     // Used to check if a particular bit needs to be drawn, starts at 0b10000000 (0x80) and ends at 0b00000001 (0x01)
-        for (int j = 0; j < 8; j++) {
-            if (vidx > end_vidx) {                              // If vidx goes too far and clips past the edge of the screen
-                break;                                          // Stop and go to the next row
+
+    unsigned int width = screenWidth();
+    unsigned int height = screenHeight();
+    unsigned int px = V[x] % width;
+    unsigned int py = V[y] % height;
+
+    unsigned int spriteWidth = 8;
+    unsigned int rows = n;
+    if (n == 0 && platform != PLATFORM_CHIP8) {
+        spriteWidth = 16;
+        rows = 16;
+    }
+    unsigned int spriteBytes = rows * (spriteWidth / 8);
+
+    VideoRow mask = rowMask();                                  // Clips anything past the right edge of the screen
+    uint16_t addr = I;
+
+    if (collision)
+        V[0xF] = 0;
+    for (int p = 0; p < PLANE_COUNT; p++) {
+        if (!(planes & (1 << p)))
+            continue;
+
+        for (unsigned int i = 0; i < rows; i++) {
+            unsigned int row = py + i;
+            if (row >= height) {
+                if (!quirks.wrap)                               // If the sprite reaches the bottom of the screen, stop drawing
+                    break;
+                row -= height;
             }
 
-            if ((memory[I + i] & bit) && video[vidx]) {         // If a pixel was already here -AND- new pixel is being drawn here:
-                V[0xF] = 1;                                     // Set VF = 1
-                video[vidx] = 0;                                // 1 XOR 1 = 0
-            } else if (memory[I + i] & bit) {                   // If no pixel was here and a new pixel must be drawn:
-                video[vidx] = 1;                                // 0 XOR 1 = 1
+            uint16_t bits;
+            if (spriteWidth == 16) {
+                bits = (mem(addr + 2 * i) << 8) | mem(addr + 2 * i + 1);
+            } else {
+                bits = mem(addr + i);
             }
 
-            bit = bit >> 1;       
-            vidx++;                                         
-        }
-        
-        // Time to go to the next row
-        vidx = start_vidx;                                      // Reset vidx to its starting position to make it easier to calculate the start position for the next row
+            // Line the sprite row up with the left edge of the display, then move it right to x
+            // Bits pushed past the right end of the row are dropped, which clips the sprite
+            // With the wrap quirk they are shifted back in at the left edge instead
+            VideoRow line = (VideoRow)bits << (VIDEO_WIDTH - spriteWidth);
+            VideoRow sprite = line >> px;
+            if (quirks.wrap && px > 0)
+                sprite |= line << (width - px);
+            sprite &= mask;
 
-        vidx += VIDEO_WIDTH;                                    // Go to the next row in the video buffer
-        start_vidx += VIDEO_WIDTH;                              // Set start_vidx to the start of the next row
-        end_vidx += VIDEO_WIDTH;                                // Set end_vidx to the end of the next row       
-        if (vidx >= VIDEO_WIDTH * VIDEO_HEIGHT) {               // If the sprite reaches the bottom of the screen, stop drawing
-            break;
+            if (collision && (video[p][row] & sprite))          // If any pixel was already here -AND- a new pixel is being drawn here:
+                V[0xF] = 1;                                     // Set VF = 1
+            video[p][row] ^= sprite;
+            dirty_rows[p] |= 1ull << row;
         }
+
+        addr += spriteBytes;
     }
 }
 
@@ -524,16 +1973,43 @@ void Chip8::OP_Dxyn() {
 void Chip8::OP_Ex9E() {
     uint8_t x = (opcode & 0x0F00) >> 8;
 
-    if (keypad[V[x]])
-        pc += 2;  
+    if (keypad[V[x] & 0xF])
+        skipInstruction();
 }
 
 // Skip next instruction if a key with the value of Vx is NOT pressed 
 void Chip8::OP_ExA1() {
     uint8_t x = (opcode & 0x0F00) >> 8;
 
-    if (!keypad[V[x]])
-        pc += 2;  
+    if (!keypad[V[x] & 0xF])
+        skipInstruction();
+}
+
+// Set I = the 16-bit address stored in the two bytes after the opcode, then skip over them
+void Chip8::OP_F000() {
+    if (opcode & 0x0F00) {                                      // Only F000 has the address, Fx00 is not an instruction
+        return;
+    }
+
+    I = (mem(pc) << 8) | mem(pc + 1);
+    pc += 2;
+}
+
+// Select the bitplanes that are drawn to, cleared and scrolled -- n is a bitmask, 0 selects no planes
+void Chip8::OP_Fn01() {
+    planes = ((opcode & 0x0F00) >> 8) & 0x3;
+}
+
+// Load the 16 byte audio pattern starting at location I
+void Chip8::OP_F002() {
+    if (opcode & 0x0F00) {                                      // Only F002 loads the pattern, Fx02 is not an instruction
+        return;
+    }
+
+    for (int i = 0; i < AUDIO_PATTERN_SIZE; i++) {
+        audio_pattern[i] = mem(I + i);
+    }
+    audio_pattern_loaded = true;
 }
 
 // Vx = delay_timer
@@ -544,17 +2020,29 @@ void Chip8::OP_Fx07() {
 }
 
 // Wait for a key press and store the value of the key in Vx
+// Like the COSMAC VIP, the key has to be pressed and then released again before execution continues
 void Chip8::OP_Fx0A() {
     uint8_t x = (opcode & 0x0F00) >> 8;
 
-    for (int i = 0; i < KEY_COUNT; i++) {
-        if (keypad[i]) {
-            V[x] = i;
-            return;
-        }  
+    // Wait for a key to be pressed
+    if (wait_key < 0) {
+        for (int i = 0; i < KEY_COUNT; i++) {
+            if (key_presses & (1 << i)) {
+                wait_key = i;
+                break;
+            }
+        }
     }
 
-    pc -= 2;    // No key was pressed, so retry the opcode
+    // Then wait for that key to be released
+    if (wait_key >= 0 && !keypad[wait_key]) {
+        V[x] = wait_key;
+        wait_key = -1;
+        key_presses = 0;
+        return;
+    }
+
+    pc -= 2;    // Still waiting, so retry the opcode
 }
 
 // delay_timer = Vx
@@ -585,39 +2073,78 @@ void Chip8::OP_Fx29() {
     I = FONTSET_START_ADDRESS + (5 * V[x]);
 }
 
+// Set I = location of the big sprite for digit stored in Vx
+void Chip8::OP_Fx30() {
+    uint8_t x = (opcode & 0x0F00) >> 8;
+
+    I = BIG_FONTSET_START_ADDRESS + (10 * (V[x] & 0xF));
+}
+
 // Take the decimal value of Vx, and place the hundreds digit in memory at location in I, the tens digit at location I+1, and the ones digit at location I+2
 void Chip8::OP_Fx33() {
     uint8_t x = (opcode & 0x0F00) >> 8;
     uint8_t val = V[x];
 
-    memory[I+2] = val % 10;
+    storeMemory(I + 2, val % 10);
     val /= 10;
 
-    memory[I+1] = val % 10;
+    storeMemory(I + 1, val % 10);
     val /= 10;
 
-    memory[I] = val % 10;
+    storeMemory(I, val % 10);
+}
+
+// Set the playback pitch of the audio pattern to Vx
+void Chip8::OP_Fx3A() {
+    uint8_t x = (opcode & 0x0F00) >> 8;
+
+    pitch = V[x];
 }
 
 // Store registers V0 through Vx in memory starting at location I
-// I is incremented in the COSMAC variant
+// I is incremented in the COSMAC variant (memory_increment quirk), but left unchanged on SUPER-CHIP
 void Chip8::OP_Fx55() {
     uint8_t x = (opcode & 0x0F00) >> 8;
 
     for (int i = 0; i <= x; i++) {
-        memory[I] = V[i];
-        I++;
+        storeMemory(I + i, V[i]);
     }
+
+    if (quirks.memory_increment)
+        I += x + 1;
 }
 
 // Load registers V0 through Vx from memory starting at location I
-// I is incremented in the COSMAC variant
+// I is incremented in the COSMAC variant (memory_increment quirk), but left unchanged on SUPER-CHIP
 void Chip8::OP_Fx65() {
     uint8_t x = (opcode & 0x0F00) >> 8;
 
     for (int i = 0; i <= x; i++) {
-        V[i] = memory[I];
-        I++;
+        V[i] = mem(I + i);
+    }
+
+    if (quirks.memory_increment)
+        I += x + 1;
+}
+
+// Save registers V0 through Vx to the RPL user flags
+// SUPER-CHIP only has 8 flags, so only V0 - V7 can be saved -- XO-CHIP has all 16
+void Chip8::OP_Fx75() {
+    uint8_t x = (opcode & 0x0F00) >> 8;
+    int count = platform == PLATFORM_XOCHIP ? RPL_COUNT : 8;
+
+    for (int i = 0; i <= x && i < count; i++) {
+        rpl[i] = V[i];
+    }
+}
+
+// Load registers V0 through Vx from the RPL user flags
+void Chip8::OP_Fx85() {
+    uint8_t x = (opcode & 0x0F00) >> 8;
+    int count = platform == PLATFORM_XOCHIP ? RPL_COUNT : 8;
+
+    for (int i = 0; i <= x && i < count; i++) {
+        V[i] = rpl[i];
     }
 }
 
@@ -643,11 +2170,11 @@ void Chip8::debug(uint16_t bitmask) {
 
 
     if (d_dt) {
-        std::cout << "Delay timer value: " << std::dec << delay_timer << std::endl << std::endl;
+        std::cout << "Delay timer value: " << std::dec << (int)delay_timer << std::endl << std::endl;
     }
 
     if (d_st) {
-        std::cout << "Sound timer value: " << std::dec << sound_timer << std::endl << std::endl;
+        std::cout << "Sound timer value: " << std::dec << (int)sound_timer << std::endl << std::endl;
     }
 
 
@@ -670,17 +2197,17 @@ void Chip8::debug(uint16_t bitmask) {
 
 
     if (d_stack) {
-        std::cout << "SP points to stack level " << std::dec << sp << std::endl;
+        std::cout << "SP points to stack level " << std::dec << (int)sp << std::endl;
         for(int i = 0; i < STACK_SIZE; i++) {
-            if (sp == i) {
-                std::cout << "Stack level " << std::dec << i << " points to: 0x" << std::hex << std::setw(3) << std::setfill('0') << (int)stack[sp] << std::endl;
+            if (sp != i) {
+                std::cout << "Stack level " << std::dec << i << " points to: 0x" << std::hex << std::setw(3) << std::setfill('0') << (int)stack[i] << std::endl;
             } else {
-                std::cout << "Stack level " << std::dec << i << " points to: 0x" << std::hex << std::setw(3) << std::setfill('0') << (int)stack[sp] << "\t<< SP points here" << std::endl;
+                std::cout << "Stack level " << std::dec << i << " points to: 0x" << std::hex << std::setw(3) << std::setfill('0') << (int)stack[i] << "\t<< SP points here" << std::endl;
             }
         }
         std::cout << std::endl;
     } else if (d_sp) {
-        std::cout << "SP points to stack level " << std::dec << sp << std::endl << std::endl;
+        std::cout << "SP points to stack level " << std::dec << (int)sp << std::endl << std::endl;
     }
 
 
@@ -689,10 +2216,10 @@ void Chip8::debug(uint16_t bitmask) {
 
 
     if (d_mem_all) {
-        for (int i = 0; i < MEMORY_SIZE; i++) {
-            if (memory[i]) {
+        for (int i = 0; i <= (int)memory_mask; i++) {
+            if (mem(i)) {
                 std::cout << "Value at memory index " << std::dec << (int)i << " (memory address 0x" << std::hex << std::setw(3) << std::setfill('0') << (int)i << "): 0x" 
-                << std::hex << std::setw(2) << std::setfill('0') << (int)memory[i];
+                << std::hex << std::setw(2) << std::setfill('0') << (int)mem(i);
                 if (pc == i)
                     std::cout << "\t<< PC points here";
                 if (I == i)
@@ -703,9 +2230,9 @@ void Chip8::debug(uint16_t bitmask) {
         std::cout << std::endl;
     } else if (d_mem_fonts) {
         for (int i = 0; i < 0x1FF; i++) {
-            if (memory[i]) {
+            if (mem(i)) {
                     std::cout << "Value at memory index " << std::dec << (int)i << " (memory address 0x" << std::hex << std::setw(3) << std::setfill('0') << (int)i << "): 0x" 
-                    << std::hex << std::setw(2) << std::setfill('0') << (int)memory[i];
+                    << std::hex << std::setw(2) << std::setfill('0') << (int)mem(i);
                 if (pc == i)
                     std::cout << "\t<< PC points here";
                 if (I == i)
@@ -715,10 +2242,10 @@ void Chip8::debug(uint16_t bitmask) {
         }
         std::cout << std::endl;
     } else if (d_mem_rom) {
-        for (int i = 0x200; i < MEMORY_SIZE; i++) {
-            if (memory[i]) {
+        for (int i = 0x200; i <= (int)memory_mask; i++) {
+            if (mem(i)) {
                 std::cout << "Value at memory index " << std::dec << (int)i << " (memory address 0x" << std::hex << std::setw(3) << std::setfill('0') << (int)i << "): 0x" 
-                << std::hex << std::setw(2) << std::setfill('0') << (int)memory[i];
+                << std::hex << std::setw(2) << std::setfill('0') << (int)mem(i);
                 if (pc == i)
                     std::cout << "\t<< PC points here";
                 if (I == i)
@@ -740,14 +2267,12 @@ void Chip8::debug(uint16_t bitmask) {
 
     if (d_video) {
         std::cout << "VIDEO: " << std::endl;
-        for (int i = 0; i < VIDEO_WIDTH * VIDEO_HEIGHT; i++) {
-            if (i % VIDEO_WIDTH == 0) 
-                std::cout << std::endl;
+        for (unsigned int y = 0; y < screenHeight(); y++) {
+            std::cout << std::endl;
 
-            if (video[i]) {
-                std::cout << "1";
-            } else {
-                std::cout << "0";
+            for (unsigned int x = 0; x < screenWidth(); x++) {
+                // Each pixel is printed as its colour index -- 0 or 1, or up to 3 with both XO-CHIP bitplanes
+                std::cout << (getPixel(x, y, 0) | (getPixel(x, y, 1) << 1));
             }
         }
         std::cout << std::endl;
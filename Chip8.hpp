@@ -1,15 +1,105 @@
 #pragma once
 
 #include <cstdint>
+#include <vector>
+#include <memory>
+#include <string>
 
-// COSMAC VIP variant
+// COSMAC VIP variant, with optional SUPER-CHIP and XO-CHIP extensions (see setPlatform())
 
 const unsigned int KEY_COUNT = 16;
-const unsigned int VIDEO_WIDTH = 64;
-const unsigned int VIDEO_HEIGHT = 32;
+const unsigned int VIDEO_WIDTH = 128;                       // Size of the SUPER-CHIP high resolution display
+const unsigned int VIDEO_HEIGHT = 64;
+const unsigned int LORES_WIDTH = 64;                        // Size of the original display, also used by SUPER-CHIP in low resolution
+const unsigned int LORES_HEIGHT = 32;
 const unsigned int REGISTER_COUNT = 16;
 const unsigned int MEMORY_SIZE = 4096;
+const unsigned int XO_MEMORY_SIZE = 65536;                  // XO-CHIP memory, only allocated for XO-CHIP instances
+const unsigned int PLANE_COUNT = 2;                         // XO-CHIP display bitplanes, other platforms only use plane 0
+const unsigned int AUDIO_PATTERN_SIZE = 16;                 // XO-CHIP audio pattern buffer, 128 one-bit samples
 const unsigned int STACK_SIZE = 16;
+const unsigned int TIMER_FREQUENCY = 60;                    // Delay and sound timers tick at 60hz
+const unsigned int RPL_COUNT = 16;                          // RPL user flags saved and loaded by Fx75/Fx85 -- SUPER-CHIP only has the first 8
+const unsigned int MEMORY_PAGE_SIZE = 256;                  // Memory is shared between clones in pages of this size, a page is copied the first time a clone writes to it
+
+// One row of the display, packed one bit per pixel
+// The leftmost pixel is the most significant bit, so scrolling is a shift and drawing a sprite row is a shift and an XOR
+typedef unsigned __int128 VideoRow;
+
+// The instruction set and behaviour being emulated
+enum Platform {
+    PLATFORM_CHIP8,                                         // COSMAC VIP CHIP-8
+    PLATFORM_SCHIP,                                         // SUPER-CHIP 1.1: 128x64 high resolution, scrolling, 16x16 sprites, big font, RPL flags
+    PLATFORM_XOCHIP                                         // XO-CHIP: SUPER-CHIP plus 64KB memory, two bitplanes and audio patterns
+};
+
+// Behaviours that differ between CHIP-8 interpreters, set by setPlatform() and changed with setQuirks()
+struct Quirks {
+    bool vf_reset;                                          // 8xy1, 8xy2 and 8xy3 reset VF to 0
+    bool memory_increment;                                  // Fx55 and Fx65 leave I pointing past the last register
+    bool shift_vy;                                          // 8xy6 and 8xyE shift Vy into Vx, instead of shifting Vx in place
+    bool jump_vx;                                           // Bnnn jumps to xnn + Vx instead of nnn + V0
+    bool wrap;                                              // Sprites wrap around the edges of the screen instead of being clipped
+};
+
+inline bool operator==(const Quirks &a, const Quirks &b) {
+    return a.vf_reset == b.vf_reset && a.memory_increment == b.memory_increment && a.shift_vy == b.shift_vy && a.jump_vx == b.jump_vx && a.wrap == b.wrap;
+}
+
+inline bool operator!=(const Quirks &a, const Quirks &b) {
+    return !(a == b);
+}
+
+// A copy of the CPU registers, for tools that watch the machine from outside
+struct Registers {
+    uint16_t pc;
+    uint16_t I;
+    uint8_t sp;
+    uint8_t delay_timer;
+    uint8_t sound_timer;
+    uint8_t V[REGISTER_COUNT];
+};
+
+class Chip8;
+class ROMTemplate;
+
+// Native code for one ROM, generated ahead of time by chip8_recomp (see recomp.cpp)
+// It is only run while memory still holds the ROM it was generated from, on the platform it was generated for
+struct CompiledROM {
+    const char *name;                                       // File the ROM was loaded from
+    Platform platform;
+    const uint8_t *rom;                                     // The ROM's bytes
+    uint32_t rom_size;
+    const uint64_t *code;                                   // One bit per ROM byte the generated code was translated from
+    unsigned int (*run)(Chip8 &chip8, unsigned int cycles); // Runs up to cycles instructions and returns how many it ran, instructions it has no code for are interpreted
+};
+
+// The generated code of each ROM is a specialisation of this, which gives it the same access to the machine as the interpreter
+template <typename ROM> struct CompiledCode;
+
+// Common instruction sequences that predecoded blocks run as one superinstruction
+enum Fusion {
+    FUSE_LOAD_DRAW,                                         // Annn Dxyn
+    FUSE_SET_TIMER,                                         // 6xkk Fy15
+    FUSE_TABLE_LOAD,                                        // Fx1E Fy65
+    FUSE_TIMER_WAIT,                                        // Fx07 3ykk 1nnn back to the Fx07 -- every iteration until the end of the frame is run at once
+    FUSE_COUNTED_LOOP,                                      // 7xkk 3ykk 1nnn back to the 7xkk -- iterations are run without going back through the block
+    FUSE_IDLE_LOOP,                                         // 1nnn to itself
+    FUSION_COUNT
+};
+
+const char *const FUSION_NAMES[FUSION_COUNT] = { "load+draw", "set timer", "table load", "timer wait", "counted loop", "idle loop" };
+
+// Instructions run by each tier and blocks moved between them, counted by emulateFrame() and emulateCycles() since the ROM was loaded (see setTiering())
+struct TierStats {
+    uint64_t interpreted;                                   // Instructions fetched and decoded one at a time by emulateCycle()
+    uint64_t predecoded;                                    // Instructions run from predecoded blocks
+    uint64_t fused[FUSION_COUNT];                           // The part of predecoded that ran inside each kind of superinstruction
+    uint64_t native;                                        // Instructions run while code generated by chip8_recomp was on
+    uint64_t promoted;                                      // Blocks predecoded after being entered the threshold number of times
+    uint64_t demoted;                                       // Predecoded blocks thrown away because the program wrote over them
+    uint64_t dead_flags;                                    // Predecoded instructions that skipped working out VF because the block overwrote it unread
+};
 
 // Flags for the debug() function -- OR'd together
 const uint16_t D_OP = 0b1000000000000;                      // Show opcode
@@ -32,22 +122,81 @@ class Chip8 {
     public:
         Chip8();
 
+        // Copying a Chip8 is cheap: memory pages are shared until one side writes to them, and the opcode tables are shared by every instance of a platform
+        Chip8 clone();                                      // A copy of this machine that runs on independently of it
+        void cloneInto(Chip8 &target);                      // Makes target a copy of this machine, reusing target's storage -- for search trees that keep a pool of machines
+
         void emulateCycle();                                // Emulates one cycle of the CPU (60 cycles per second)
 		bool loadROM(const char * filename);                // Loads a ROM into the program memory (starting at 0x200)
-        void updateTimers();                                // Updates the delay timer and sound timer and plays a tone while the sound timer is > 0
+        bool loadROM(const uint8_t *data, uint32_t size);   // Loads a ROM that is already in host memory
+        void reset(const ROMTemplate &rom);                 // Same as setPlatform() and loadROM() with the template's ROM, but only copies the machine the template prepared
+                                                            // The speed, seed, tiering, coverage and generated code of this machine are kept
+                                                            // After skipPrefix(), the machine takes the template's speed, and the prefix is not recorded as covered
+                                                            // Memory pages the machine already had to itself stay its own, so it does not copy them again when it writes them
+        void unshareMemory();                               // Gives the machine its own copy of every memory page, so writing memory never allocates (until it is cloned)
+        void updateTimers();                                // Updates the delay timer and sound timer
+        bool isSoundPlaying();                              // True while the sound timer is non-zero and a tone should be played
+
+        void setSpeed(unsigned int ips);                    // Sets how many instructions are executed per emulated second
+        void emulateFrame();                                // Executes one timer tick (1/60 of an emulated second) worth of instructions, then updates the timers
+                                                            // Timing is counted in executed instructions rather than wall-clock time, so a run is identical no matter how fast the host is
+        void emulateCycles(unsigned int count);             // Executes count instructions through whichever tiers are on -- the same as count emulateCycle() calls
+        unsigned int beginFrame();                          // Starts a frame and returns how many instructions it runs -- emulateFrame() is beginFrame(), emulateCycles() of that many, then endFrame()
+        void endFrame();                                    // Finishes a frame, updating the timers
+        void seed(uint32_t value);                          // Seeds the random number generator used by Cxkk -- the same seed always produces the same run
+
+        void setKey(uint8_t key, bool pressed);             // Presses or releases a key on the keypad, press edges are remembered for Fx0A
+
+        void setPlatform(Platform p);                       // Selects the instruction set and quirks, the default is PLATFORM_CHIP8
+        void setQuirks(const Quirks &q);                    // Replaces the quirks setPlatform() picked, until the platform is set again
+        Quirks getQuirks();
+        static Quirks platformQuirks(Platform p);           // The quirks setPlatform() picks for a platform
+        static bool parsePlatform(const std::string &name, Platform &p);   // chip8, schip or xochip
+        static const char *platformName(Platform p);        // The name parsePlatform() reads
+        static Platform platformFor(const std::string &rom);    // Picks the platform from the file extension: .sc8 is SUPER-CHIP, .xo8 is XO-CHIP and anything else is CHIP-8
+        void setCompiledROM(const CompiledROM *code);       // Runs emulateFrame() through code generated by chip8_recomp while its ROM is loaded, NULL to always interpret
+        bool isCompiled();                                  // True while emulateFrame() is running generated code
+        void setTiering(unsigned int threshold);            // Starts every block in the interpreter and predecodes it once it has been entered threshold times, 0 (the default) always interprets
+                                                            // Generated code set by setCompiledROM() still comes first while it is on
+        TierStats getTierStats();
+        void setCoverage(bool on);                          // Starts recording every address an instruction is run from, clearing what was recorded, or stops recording
+                                                            // Kept through loadROM() so runs can be added up, generated code is not used while recording
+        bool isCovered(uint32_t address);                   // True if an instruction was run from address while recording, still answered after recording stops
+        bool isHalted();                                    // True once the program has exited (SUPER-CHIP 00FD) or faulted
+        const char *getFault();                             // Why the program was stopped (stack overflow or underflow), NULL if it was not
+        bool isStateValid();                                // True if the stack pointer is within the stack and PC is within memory
+        bool readsInput();                                  // True if the next instruction depends on the keypad or the random number generator (Cxkk, Ex9E, ExA1, Fx0A)
+        uint64_t stateHash();                               // Hash of the whole machine state (registers, stack, timers, memory, display...), equal states hash equally
+                                                            // Kept up to date as memory and the display are written, so it costs the same no matter how big memory is
+                                                            // The display must only be changed by the interpreter for this to stay correct
+        uint64_t computeStateHash();                        // The same hash recomputed from scratch, slow -- for checking stateHash()
+        uint8_t readMemory(uint32_t address);               // Reads guest memory for tools, the address wraps like it does for the interpreter
+        uint32_t memorySize();                              // 4KB, or 64KB on XO-CHIP
+        Registers getRegisters();
+
+        unsigned int screenWidth();                         // Width of the display in the current resolution
+        unsigned int screenHeight();                        // Height of the display in the current resolution
+        bool getPixel(unsigned int x, unsigned int y, unsigned int plane = 0);    // True if the pixel at (x, y) is on in the given bitplane
+
+        bool hasAudioPattern();                             // True once an XO-CHIP program has loaded an audio pattern with F002
+        const uint8_t *getAudioPattern();                   // The XO-CHIP audio pattern, 128 one-bit samples, most significant bit first
+        double getAudioPatternRate();                       // Playback rate of the audio pattern in samples per second, set by Fx3A
 
         void debug(uint16_t bitmask);                       // Prints out the current states of class variables
                                                             // A bitmask is used to select which variables should be output
 
-        uint8_t keypad[KEY_COUNT]{};                        // Used for keypad input
-        uint32_t video[VIDEO_WIDTH * VIDEO_HEIGHT]{};       // Used to represent the display
-                                                            // Each pixel is either ON or OFF
+        uint8_t keypad[KEY_COUNT]{};                        // Used for keypad input -- use setKey() to change it so that key presses are seen by Fx0A
+        VideoRow video[PLANE_COUNT][VIDEO_HEIGHT]{};        // Used to represent the display, one packed row per line in each bitplane
+                                                            // Each pixel is either ON or OFF, the colour of a pixel is picked from its bit in both planes
+                                                            // In low resolution only the top-left 64x32 pixels are used
+        bool hires;                                         // True while SUPER-CHIP high resolution (128x64) is on
 
         bool drawFlag;                                      // A flag used to determine whether the emulator should draw to the display or not
                                                             // Set by OP_00E0() and OP_DXYN()
                                                             // Only needs to draw if something new should be drawn to the screen
 
     private:
+        template <typename ROM> friend struct CompiledCode;
 
         uint16_t pc;                                        // Program counter
 
@@ -58,16 +207,137 @@ class Chip8 {
         uint8_t delay_timer;                                // Used for timing
                                                             // When non-zero, decrements at a rate of 60hz
         uint8_t sound_timer;                                // Used for sound
-                                                            // When non-zero, decrements at a rate of 60hz while playing a tone
+                                                            // When non-zero, decrements at a rate of 60hz while the frontend plays a tone
 
         uint8_t V[REGISTER_COUNT];                          // 16 registers (V0-VF)
                                                             // VF should not be used by programs, it is used as a flag by some instructions
-        uint8_t memory[MEMORY_SIZE];                        // 4KB of memory
+        struct MemoryPage {
+            uint8_t bytes[MEMORY_PAGE_SIZE];
+        };
+        std::vector<std::shared_ptr<MemoryPage>> pages;     // 4KB of memory (64KB on XO-CHIP) -- only accessed through mem() and writableMem()
+                                                            // A page may be shared with clones, so it is only ever written after writableMem() has made it private
+        std::vector<std::shared_ptr<MemoryPage>> spare_pages;       // Always empty, only holds on to the storage reset() puts this machine's own pages aside in
+        uint32_t memory_mask;                               // memory.size() - 1, both memory sizes are powers of two
+        uint64_t memory_hash;                               // Hash of memory, updated by storeMemory()
+        uint64_t video_hash;                                // Hash of the display as of the last updateVideoHash()
+        uint64_t row_hashes[PLANE_COUNT][VIDEO_HEIGHT];     // Hash of each display row included in video_hash
+        uint64_t dirty_rows[PLANE_COUNT];                   // One bit per row of each bitplane that was written since its hash was last updated
         uint16_t stack[STACK_SIZE];                         // Stack with 16 levels
+        uint8_t rpl[RPL_COUNT];                             // SUPER-CHIP RPL user flags
+        uint8_t planes;                                     // Bitplanes drawn to, cleared and scrolled -- bit 0 for plane 0, bit 1 for plane 1 (XO-CHIP Fn01)
 
+        uint8_t audio_pattern[AUDIO_PATTERN_SIZE];          // XO-CHIP audio pattern loaded by F002
+        bool audio_pattern_loaded;
+        uint8_t pitch;                                      // XO-CHIP playback pitch set by Fx3A
 
-        void initialize();                                  // Initialize registers and memory
+        Platform platform;                                  // Instruction set being emulated
+        Quirks quirks;                                      // Behaviours of the platform being emulated
+        bool halted;                                        // Set when the program exits, no more instructions are executed
+        const char *fault;                                  // Set along with halted when the program does something that cannot be emulated
+
+        unsigned int instructions_per_second;               // Emulated CPU speed
+        unsigned int frame_remainder;                       // Accumulates the leftover (IPS % 60) instructions so each emulated second executes exactly IPS instructions
+
+        uint16_t key_presses;                               // One bit per key that went from released to pressed since the end of the last frame
+        int8_t wait_key;                                    // The key Fx0A is waiting to be released, -1 while no key has been pressed yet
+
+        const CompiledROM *compiled;                        // Generated code set by setCompiledROM(), NULL when there is none
+        bool compiled_active;                               // The generated code matches the loaded ROM and the platform
+        uint64_t code_written[XO_MEMORY_SIZE / MEMORY_PAGE_SIZE / 64];   // One bit per memory page where the program has written over code that was translated
+                                                                         // Blocks on those pages check their bytes are still the ROM's before they run
 
+        // Tiered execution (see setTiering())
+        // A block starts where the interpreter lands after a jump, call, return or skip and runs up to and including the next one
+        struct TierOp;
+        typedef void (Chip8::*opTable)();
+        typedef void (Chip8::*fusedOp)(const TierOp *op);                           // Runs the instructions a superinstruction stands for, starting at op
+        typedef unsigned int (Chip8::*loopOp)(const TierOp *op, unsigned int limit);    // Runs a loop block up to limit instructions, returns how many it ran
+        struct TierOp {
+            opTable handler;                                // The instruction's function, looked up through the opcode tables once
+            opTable whole;                                  // The function used when the whole block runs -- handler, or a NOVF_ function if VF is dead after it
+            fusedOp fused;                                  // Superinstruction starting with this instruction, NULL if there is none
+            uint16_t opcode;
+            uint16_t pc;                                    // PC while the instruction runs, already past it
+            uint8_t length;                                 // Instructions the superinstruction stands for
+            uint8_t fusion;                                 // Which kind of superinstruction it is, for the stats
+        };
+        struct TierBlock {
+            uint16_t start;
+            uint16_t size;                                  // Bytes of memory the block was decoded from, including the jump back of a loop
+            uint32_t entries;                               // Times the interpreter entered the block since it was created or demoted
+            bool promoted;                                  // ops holds the block's instructions
+            std::vector<TierOp> ops;
+            loopOp loop;                                    // Runs the whole block and its jump back over and over, NULL if it is not a loop the tier knows
+            uint8_t loop_fusion;
+            uint8_t dead_flags;                             // Instructions that skip working out VF when the whole block runs
+        };
+        struct BlockCache {
+            std::vector<uint16_t> block_at;                 // 1 + the index in blocks of the block starting at each address, 0 if there is none
+            std::vector<TierBlock> blocks;
+            std::vector<uint8_t> covered;                   // Promoted blocks decoded from each byte, a write to a byte that is covered demotes them
+        };
+        std::shared_ptr<BlockCache> block_cache;            // Shared with clones until one side changes it like a memory page, NULL while tiering is off
+        unsigned int tier_threshold;
+        uint32_t tier_generation;                           // Changes whenever a block is demoted, so a block that is running sees it was written over
+        bool block_entry;                                   // The last instruction ended a block, so PC is the start of one
+        TierStats tier_stats;
+
+        std::vector<uint64_t> coverage;                     // One bit per address an instruction was run from, see setCoverage()
+        bool coverage_on;
+
+        uint32_t rng_seed;                                  // Seed the random number generator is reset to by initialize()
+        uint32_t rng_state;                                 // Current state of the xorshift random number generator
+
+
+        void initialize();                                  // Initialize registers and memory
+        void checkCompiled();                               // Decides whether the generated code can run, after the ROM or platform changed
+        uint8_t nextRandom();                               // Returns the next byte from the random number generator
+        void resetBlocks();                                 // Forgets every block, after memory was written directly or the platform changed
+        unsigned int runTiered(unsigned int count);         // Runs count instructions, entering blocks through the tiers
+        TierBlock *enterBlock();                            // Counts an entry to the block at PC, returns it if it is promoted
+        void promoteBlock(BlockCache &cache, TierBlock &block);
+        void fuseBlock(TierBlock &block);                   // Finds the superinstructions in a block that has just been decoded
+        void removeDeadFlags(TierBlock &block);             // Picks the NOVF_ functions for instructions whose VF the rest of the block overwrites unread
+        bool readsVF(const TierOp &op);
+        bool overwritesVF(const TierOp &op);
+        void demoteBlocks(uint32_t address);                // Demotes every promoted block decoded from address
+        unsigned int runBlock(const TierBlock &block, unsigned int limit);
+        void coverOps(const TierOp *op, unsigned int count);           // Records count instructions of a block, starting at op, as run
+        opTable decodeOpcode(uint16_t op);                  // The function that runs op, without going through the getTable functions
+        static bool endsBlock(opTable handler);             // True for instructions that may not continue with the next one
+
+        // Superinstructions -- each one leaves the machine exactly as running its instructions one by one would
+        // They are only used when the whole sequence fits in what is left of the frame, so a frame never ends inside one
+        void FUSED_LoadDraw(const TierOp *op);
+        void FUSED_SetTimer(const TierOp *op);
+        void FUSED_TableLoad(const TierOp *op);
+        unsigned int LOOP_TimerWait(const TierOp *op, unsigned int limit);
+        unsigned int LOOP_Counted(const TierOp *op, unsigned int limit);
+        unsigned int LOOP_Idle(const TierOp *op, unsigned int limit);
+
+        // The same instructions without working out VF, for where the block overwrites VF before anything reads it (see removeDeadFlags())
+        void NOVF_8xy1();
+        void NOVF_8xy2();
+        void NOVF_8xy3();
+        void NOVF_8xy4();
+        void NOVF_8xy5();
+        void NOVF_8xy6();
+        void NOVF_8xy7();
+        void NOVF_8xyE();
+        void NOVF_Dxyn();
+
+
+        VideoRow rowMask();                                 // Bits of a display row that are visible in the current resolution
+        uint8_t mem(uint32_t address);                      // Guest memory at address, wrapped around the end of memory
+                                                            // Build with -DCHIP8_CHECKED_MEMORY to stop on addresses past the end instead
+        uint8_t &writableMem(uint32_t address);             // The same byte, ready to be written -- copies the page first if it is shared
+        static const std::shared_ptr<MemoryPage> &zeroPage();
+        void storeMemory(uint32_t address, uint8_t value);  // Writes guest memory and keeps memory_hash up to date -- every write by an instruction goes through here
+        uint64_t hashRegisters();                           // Hash of everything except memory and the display
+        void rehashMemory();                                // Recomputes memory_hash after memory was written directly (reset, ROM loading, platform change)
+        void updateVideoHash();                             // Brings video_hash up to date with the dirty rows
+        void skipInstruction();                             // Skips the next instruction, which is 4 bytes long if it is XO-CHIP F000 nnnn
+        void getTable5();                                   // Indexes into OpcodeTable_5
 
         void getTable0();                                   // Indexes into OpcodeTable_0
         void getTable8();                                   // Indexes into OpcodeTable_8
@@ -76,12 +346,17 @@ class Chip8 {
 
 
         // Tables of pointers to opcodes
-        typedef void (Chip8::*opTable)();
-        opTable OpcodeTable[0xF + 1];
-        opTable OpcodeTable_0[0xE + 1];
-        opTable OpcodeTable_8[0xE + 1];
-        opTable OpcodeTable_E[0xE + 1];
-        opTable OpcodeTable_F[0x65 + 1];
+        struct OpcodeTables {
+            opTable OpcodeTable[0xF + 1];
+            opTable OpcodeTable_0[0xFF + 1];
+            opTable OpcodeTable_5[0xF + 1];
+            opTable OpcodeTable_8[0xF + 1];
+            opTable OpcodeTable_E[0xF + 1];
+            opTable OpcodeTable_F[0xFF + 1];
+        };
+        const OpcodeTables *tables;                         // The tables of the current platform, shared by every instance
+        static const OpcodeTables *opcodeTablesFor(Platform platform);
+        static void setupOpcodeTables(OpcodeTables &tables, Platform platform);     // Fills the opcode tables for a platform
     
 
         // Functions which execute opcodes
@@ -89,6 +364,13 @@ class Chip8 {
                                    
         void OP_00E0();                     // Clear screen
         void OP_00EE();                     // Return from subroutine              
+        void OP_00Cn();                     // Scroll display down n lines (SUPER-CHIP)
+        void OP_00Dn();                     // Scroll display up n lines (XO-CHIP)
+        void OP_00FB();                     // Scroll display right 4 pixels (SUPER-CHIP)
+        void OP_00FC();                     // Scroll display left 4 pixels (SUPER-CHIP)
+        void OP_00FD();                     // Exit the interpreter (SUPER-CHIP)
+        void OP_00FE();                     // Low resolution (SUPER-CHIP)
+        void OP_00FF();                     // High resolution (SUPER-CHIP)
     
         void OP_1nnn();                     // Jump to address nnn
 
@@ -99,6 +381,8 @@ class Chip8 {
         void OP_4xkk();                     // Skip if not equal Vx, byte
 
         void OP_5xy0();                     // Skip if equal Vx, Vy
+        void OP_5xy2();                     // Store Vx - Vy starting at I (XO-CHIP)
+        void OP_5xy3();                     // Load Vx - Vy starting at I (XO-CHIP)
 
         void OP_6xkk();                     // LD Vx, byte
 
@@ -122,18 +406,53 @@ class Chip8 {
 
         void OP_Cxkk();                     // Vx = rand() & kk
 
-        void OP_Dxyn();                     // DRW Vx, Vy, nibble
+        void OP_Dxyn();                     // DRW Vx, Vy, nibble -- Dxy0 draws a 16x16 sprite on SUPER-CHIP
+        void drawSprite(bool collision);    // Dxyn, setting VF only if collision is true
 
         void OP_Ex9E();                     // Skip if key pressed Vx
         void OP_ExA1();                     // Skip if key not pressed Vx
 
+        void OP_F000();                     // LD I, 16-bit address stored in the next two bytes (XO-CHIP)
+        void OP_Fn01();                     // Select bitplanes n (XO-CHIP)
+        void OP_F002();                     // Load the audio pattern from the 16 bytes at I (XO-CHIP)
         void OP_Fx07();                     // LD Vx, DT
         void OP_Fx0A();                     // Wait for key press and store it in Vx
         void OP_Fx15();                     // LD DT, Vx
         void OP_Fx18();                     // LD ST, Vx
         void OP_Fx1E();                     // ADD I, Vx
         void OP_Fx29();                     // Sets I to the location of the sprite for the character in Vx
+        void OP_Fx30();                     // Sets I to the location of the big sprite for the digit in Vx (SUPER-CHIP)
         void OP_Fx33();                     // Store decimal digits of Vx in I, I+1, I+2
+        void OP_Fx3A();                     // Set the audio pattern pitch to Vx (XO-CHIP)
         void OP_Fx55();                     // Store V0 - Vx starting at I
         void OP_Fx65();                     // Load V0 - Vx starting at I
-};
\ No newline at end of file
+        void OP_Fx75();                     // Save V0 - Vx to the RPL flags (SUPER-CHIP)
+        void OP_Fx85();                     // Load V0 - Vx from the RPL flags (SUPER-CHIP)
+};
+
+
+// A ROM loaded once, kept as the machine looks straight after loadROM(), so machines can be reset to it at a high rate (see Chip8::reset())
+// The file is not read again, and memory, the display and the fonts are not rebuilt -- memory pages are shared until they are written, like a clone's
+//
+// A ROM usually runs for a while before it first looks at the keypad or asks for a random number, e.g. drawing its title screen
+// Up to there, every run of it goes through the same states, so skipPrefix() can run that part once and have every reset start after it
+class ROMTemplate {
+    public:
+        bool load(const char *filename, Platform platform);
+        bool load(const uint8_t *data, uint32_t size, Platform platform);
+        void setQuirks(const Quirks &q);                    // Quirks other than the platform's, set before skipPrefix()
+
+        // Runs whole frames at ips with no keys pressed, up to max_frames, and stops at the start of the first frame that would run an instruction that reads input (see Chip8::readsInput())
+        // Returns the frames run, which a machine reset to the template has already been through
+        unsigned long skipPrefix(unsigned int ips, unsigned long max_frames);
+        unsigned long prefixFrames() const;
+        uint64_t prefixInstructions() const;                // Instructions run by skipPrefix(), which every reset saves
+
+    private:
+        friend class Chip8;
+
+        Chip8 image;
+        unsigned int prefix_ips = 0;                        // Speed the prefix was run at, 0 until skipPrefix() is called
+        unsigned long prefix_frames = 0;
+        uint64_t prefix_instructions = 0;
+};
@@ -0,0 +1,105 @@
+#include "Coverage.hpp"
+#include "Disassembler.hpp"
+#include <cstdio>
+#include <iostream>
+#include <fstream>
+
+
+CoverageRecord collectCoverage(const char *rom, Chip8 &chip8, Platform platform) {
+    CoverageRecord record;
+    record.rom = rom;
+
+    std::ifstream file(rom, std::ios::binary);
+    std::vector<uint8_t> data((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+    std::vector<bool> code = findCode(data.data(), data.size(), platform);
+    for (uint32_t offset = 0; offset < code.size(); offset++) {
+        if (code[offset])
+            record.hits[0x200 + offset] = 0;
+    }
+
+    // Code can also run from addresses the disassembler did not find, like the targets of computed jumps or code the program wrote
+    for (uint32_t address = 0; address < chip8.memorySize(); address++) {
+        if (chip8.isCovered(address))
+            record.hits[address] = 1;
+    }
+    return record;
+}
+
+
+void mergeCoverage(std::vector<CoverageRecord> &records, const CoverageRecord &record) {
+    for (CoverageRecord &existing : records) {
+        if (existing.rom == record.rom) {
+            for (const auto &hit : record.hits)
+                existing.hits[hit.first] += hit.second;
+            return;
+        }
+    }
+    records.push_back(record);
+}
+
+
+// Only the records themselves are read: TN:, LF: and LH: are recomputed, and function and branch lines are left out since CHIP-8 code has neither
+bool readCoverage(const char *filename, std::vector<CoverageRecord> &records) {
+    std::ifstream file(filename);
+    if (!file) {
+        std::cout << "ERROR: Could not open coverage file " << filename << std::endl;
+        return false;
+    }
+
+    CoverageRecord record;
+    bool open = false;
+    std::string line;
+    int lineNumber = 0;
+    while (std::getline(file, line)) {
+        lineNumber++;
+
+        if (line.compare(0, 3, "SF:") == 0) {
+            record.rom = line.substr(3);
+            record.hits.clear();
+            open = true;
+        } else if (line.compare(0, 3, "DA:") == 0 && open) {
+            unsigned long address;
+            unsigned long long hits;
+            if (sscanf(line.c_str() + 3, "%lu,%llu", &address, &hits) != 2) {
+                std::cout << "ERROR: " << filename << ":" << lineNumber << ": expected DA:<ADDRESS>,<HITS>" << std::endl;
+                return false;
+            }
+            record.hits[address] += hits;
+        } else if (line == "end_of_record" && open) {
+            mergeCoverage(records, record);
+            open = false;
+        }
+    }
+
+    if (open) {
+        std::cout << "ERROR: " << filename << ": missing end_of_record" << std::endl;
+        return false;
+    }
+    return true;
+}
+
+
+bool writeCoverage(const char *filename, const std::vector<CoverageRecord> &records) {
+    FILE *fp = fopen(filename, "w");
+    if (fp == NULL) {
+        std::cout << "ERROR: Could not open coverage file " << filename << std::endl;
+        return false;
+    }
+
+    fprintf(fp, "TN:\n");
+    for (const CoverageRecord &record : records) {
+        unsigned int hit = 0;
+        fprintf(fp, "SF:%s\n", record.rom.c_str());
+        for (const auto &address : record.hits) {
+            fprintf(fp, "DA:%u,%llu\n", address.first, (unsigned long long)address.second);
+            hit += address.second > 0;
+        }
+        fprintf(fp, "LF:%u\nLH:%u\nend_of_record\n", (unsigned int)record.hits.size(), hit);
+    }
+
+    bool ok = !ferror(fp);
+    fclose(fp);
+    if (!ok)
+        std::cout << "ERROR: Could not write coverage file " << filename << std::endl;
+    return ok;
+}
@@ -0,0 +1,26 @@
+#pragma once
+
+#include <cstdint>
+#include <map>
+#include <string>
+#include <vector>
+#include "Chip8.hpp"
+
+// Guest code coverage, read and written as lcov tracefiles so the usual lcov tools can merge and filter them too
+// Each ROM is one record (SF:), and each of its "lines" (DA:) is a guest address in decimal
+// The hit count of an address is how many runs ran an instruction from it, not how many times it was run
+
+
+struct CoverageRecord {
+    std::string rom;                                        // ROM path as it was given when the run was recorded
+    std::map<uint32_t, uint64_t> hits;                      // Address -> runs that ran an instruction from it
+};
+
+
+// One run's coverage of a ROM, chip8 must have been recording (Chip8::setCoverage()) since the ROM was loaded
+// Every instruction the disassembler finds in the ROM file is listed, with 0 hits if the run never got to it
+CoverageRecord collectCoverage(const char *rom, Chip8 &chip8, Platform platform);
+
+void mergeCoverage(std::vector<CoverageRecord> &records, const CoverageRecord &record);   // Adds record's hits to the record of the same ROM, or adds it
+bool readCoverage(const char *filename, std::vector<CoverageRecord> &records);          // Merges every record in the tracefile into records
+bool writeCoverage(const char *filename, const std::vector<CoverageRecord> &records);
@@ -0,0 +1,155 @@
+#include "Disassembler.hpp"
+#include <cstdio>
+
+
+unsigned int instructionLength(uint16_t opcode, Platform platform) {
+    return (platform == PLATFORM_XOCHIP && opcode == 0xF000) ? 4 : 2;
+}
+
+
+std::string disassemble(uint16_t opcode, uint16_t next, Platform platform) {
+    unsigned int x = (opcode & 0x0F00) >> 8;
+    unsigned int y = (opcode & 0x00F0) >> 4;
+    unsigned int n = opcode & 0x000F;
+    unsigned int kk = opcode & 0x00FF;
+    unsigned int nnn = opcode & 0x0FFF;
+    bool schip = platform != PLATFORM_CHIP8;
+    bool xochip = platform == PLATFORM_XOCHIP;
+
+    char text[32];
+    switch (opcode >> 12) {
+        case 0x0 :
+            if (kk == 0xE0) return "CLS";
+            if (kk == 0xEE) return "RET";
+            if (schip && (kk & 0xF0) == 0xC0) { snprintf(text, sizeof(text), "SCD %u", n); return text; }
+            if (xochip && (kk & 0xF0) == 0xD0) { snprintf(text, sizeof(text), "SCU %u", n); return text; }
+            if (schip && kk == 0xFB) return "SCR";
+            if (schip && kk == 0xFC) return "SCL";
+            if (schip && kk == 0xFD) return "EXIT";
+            if (schip && kk == 0xFE) return "LOW";
+            if (schip && kk == 0xFF) return "HIGH";
+            break;
+
+        case 0x1 : snprintf(text, sizeof(text), "JP 0x%03X", nnn); return text;
+        case 0x2 : snprintf(text, sizeof(text), "CALL 0x%03X", nnn); return text;
+        case 0x3 : snprintf(text, sizeof(text), "SE V%X, 0x%02X", x, kk); return text;
+        case 0x4 : snprintf(text, sizeof(text), "SNE V%X, 0x%02X", x, kk); return text;
+
+        case 0x5 :
+            if (n == 0x0) { snprintf(text, sizeof(text), "SE V%X, V%X", x, y); return text; }
+            if (xochip && n == 0x2) { snprintf(text, sizeof(text), "SAVE V%X - V%X", x, y); return text; }
+            if (xochip && n == 0x3) { snprintf(text, sizeof(text), "LOAD V%X - V%X", x, y); return text; }
+            break;
+
+        case 0x6 : snprintf(text, sizeof(text), "LD V%X, 0x%02X", x, kk); return text;
+        case 0x7 : snprintf(text, sizeof(text), "ADD V%X, 0x%02X", x, kk); return text;
+
+        case 0x8 : {
+            static const char *const MNEMONICS[16] = { "LD", "OR", "AND", "XOR", "ADD", "SUB", "SHR", "SUBN", NULL, NULL, NULL, NULL, NULL, NULL, "SHL", NULL };
+            if (!MNEMONICS[n])
+                break;
+            snprintf(text, sizeof(text), "%s V%X, V%X", MNEMONICS[n], x, y);
+            return text;
+        }
+
+        case 0x9 :
+            if (n != 0x0)
+                break;
+            snprintf(text, sizeof(text), "SNE V%X, V%X", x, y);
+            return text;
+
+        case 0xA : snprintf(text, sizeof(text), "LD I, 0x%03X", nnn); return text;
+        case 0xB : snprintf(text, sizeof(text), "JP V0, 0x%03X", nnn); return text;
+        case 0xC : snprintf(text, sizeof(text), "RND V%X, 0x%02X", x, kk); return text;
+        case 0xD : snprintf(text, sizeof(text), "DRW V%X, V%X, %u", x, y, n); return text;
+
+        case 0xE :
+            if (n == 0xE) { snprintf(text, sizeof(text), "SKP V%X", x); return text; }
+            if (n == 0x1) { snprintf(text, sizeof(text), "SKNP V%X", x); return text; }
+            break;
+
+        case 0xF :
+            switch (kk) {
+                case 0x07 : snprintf(text, sizeof(text), "LD V%X, DT", x); return text;
+                case 0x0A : snprintf(text, sizeof(text), "LD V%X, K", x); return text;
+                case 0x15 : snprintf(text, sizeof(text), "LD DT, V%X", x); return text;
+                case 0x18 : snprintf(text, sizeof(text), "LD ST, V%X", x); return text;
+                case 0x1E : snprintf(text, sizeof(text), "ADD I, V%X", x); return text;
+                case 0x29 : snprintf(text, sizeof(text), "LD F, V%X", x); return text;
+                case 0x33 : snprintf(text, sizeof(text), "LD B, V%X", x); return text;
+                case 0x55 : snprintf(text, sizeof(text), "LD [I], V%X", x); return text;
+                case 0x65 : snprintf(text, sizeof(text), "LD V%X, [I]", x); return text;
+                default : break;
+            }
+            if (schip && kk == 0x30) { snprintf(text, sizeof(text), "LD HF, V%X", x); return text; }
+            if (schip && kk == 0x75) { snprintf(text, sizeof(text), "LD R, V%X", x); return text; }
+            if (schip && kk == 0x85) { snprintf(text, sizeof(text), "LD V%X, R", x); return text; }
+            if (xochip && kk == 0x00) { snprintf(text, sizeof(text), "LD I, 0x%04X", next); return text; }
+            if (xochip && kk == 0x01) { snprintf(text, sizeof(text), "PLANE %u", x); return text; }
+            if (xochip && kk == 0x02) return "AUDIO";
+            if (xochip && kk == 0x3A) { snprintf(text, sizeof(text), "PITCH V%X", x); return text; }
+            break;
+    }
+
+    snprintf(text, sizeof(text), "DW 0x%04X", opcode);
+    return text;
+}
+
+
+// Platforms are in the order each one added instructions to the last
+int firstPlatformWith(uint16_t opcode) {
+    for (int p = PLATFORM_CHIP8; p <= PLATFORM_XOCHIP; p++) {
+        if (disassemble(opcode, 0, (Platform)p).compare(0, 3, "DW ") != 0)
+            return p;
+    }
+    return -1;
+}
+
+
+// Worklist of addresses still to decode, a skip continues at both the next instruction and the one after it
+std::vector<bool> findCode(const uint8_t *rom, uint32_t size, Platform platform) {
+    const uint32_t START = 0x200;
+    std::vector<bool> code(size, false);
+    std::vector<uint32_t> pending = { START };
+
+    auto word = [&](uint32_t address) -> uint16_t {
+        uint32_t offset = address - START;
+        return offset + 1 < size ? (rom[offset] << 8) | rom[offset + 1] : 0;
+    };
+
+    while (!pending.empty()) {
+        uint32_t address = pending.back();
+        pending.pop_back();
+
+        while (address >= START && address + 1 < START + size && !code[address - START]) {
+            code[address - START] = true;
+            uint16_t opcode = word(address);
+            uint32_t next = address + instructionLength(opcode, platform);
+            unsigned int kk = opcode & 0x00FF;
+
+            switch (opcode >> 12) {
+                case 0x0 :
+                    if (kk == 0xEE || (platform != PLATFORM_CHIP8 && kk == 0xFD))
+                        next = 0;                           // Return or exit
+                    break;
+                case 0x1 :
+                    next = opcode & 0x0FFF;
+                    break;
+                case 0x2 :
+                    pending.push_back(opcode & 0x0FFF);
+                    break;
+                case 0x3 : case 0x4 : case 0x5 : case 0x9 : case 0xE :
+                    pending.push_back(next + instructionLength(word(next), platform));
+                    break;
+                case 0xB :
+                    next = 0;                               // Computed jump
+                    break;
+                default :
+                    break;
+            }
+            address = next;
+        }
+    }
+
+    return code;
+}
@@ -0,0 +1,22 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+#include "Chip8.hpp"
+
+// Static disassembly, decoded the same way as the opcode tables in Chip8::setupOpcodeTables()
+// Like the tables, 0nnn and Fnnn are picked by their low byte only
+
+
+// One instruction in the usual mnemonics, e.g. "LD V1, 0x2A"
+// next is the word after the instruction, the address loaded by XO-CHIP F000 nnnn
+// Opcodes the platform does not have are shown as data
+std::string disassemble(uint16_t opcode, uint16_t next, Platform platform);
+
+unsigned int instructionLength(uint16_t opcode, Platform platform);         // 4 for XO-CHIP F000 nnnn, 2 otherwise
+int firstPlatformWith(uint16_t opcode);                                     // The oldest platform that has the instruction, -1 if none of them do
+
+// One flag per ROM byte that starts an instruction reachable from 0x200 by following jumps, calls, returns and skips
+// Computed jumps (Bnnn), and code the program only reaches after writing it, are not followed
+std::vector<bool> findCode(const uint8_t *rom, uint32_t size, Platform platform);
@@ -0,0 +1,89 @@
+#include "InputScript.hpp"
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <algorithm>
+#include <cctype>
+
+
+InputScript::InputScript() {
+    next = 0;
+    quit = false;
+}
+
+
+// Each line is "<frame> <key in hex> down", "<frame> <key in hex> up" or "<frame> quit"
+// Frames count from 0, the first frame emulated after the ROM is loaded
+// Everything after a '#' is a comment
+bool InputScript::load(const char *filename) {
+    std::ifstream file(filename);
+    if (!file) {
+        std::cout << "ERROR: Could not open input script " << filename << std::endl;
+        return false;
+    }
+
+    events.clear();
+    next = 0;
+    quit = false;
+
+    std::string line;
+    int lineNumber = 0;
+    while (std::getline(file, line)) {
+        lineNumber++;
+
+        size_t comment = line.find('#');
+        if (comment != std::string::npos)
+            line.erase(comment);
+
+        std::istringstream fields(line);
+        ScriptedEvent event;
+        std::string key, action;
+
+        if (!(fields >> event.frame))
+            continue;                                       // Blank line
+
+        fields >> key >> action;
+        if (key == "quit") {
+            event.key = -1;
+            event.pressed = false;
+        } else if (key.size() == 1 && isxdigit((unsigned char)key[0]) && (action == "down" || action == "up")) {
+            event.key = std::stoi(key, NULL, 16);
+            event.pressed = action == "down";
+        } else {
+            std::cout << "ERROR: " << filename << ":" << lineNumber << ": expected <FRAME> <KEY> down|up or <FRAME> quit" << std::endl;
+            return false;
+        }
+
+        events.push_back(event);
+    }
+
+    // Events on the same frame keep the order they were written in
+    std::stable_sort(events.begin(), events.end(), [](const ScriptedEvent &a, const ScriptedEvent &b) {
+        return a.frame < b.frame;
+    });
+    return true;
+}
+
+
+int InputScript::apply(Chip8 &chip8, uint64_t frame) {
+    int changed = 0;
+
+    while (next < events.size() && events[next].frame <= frame) {
+        const ScriptedEvent &event = events[next++];
+
+        if (event.key < 0) {
+            quit = true;
+        } else if (chip8.keypad[event.key] != event.pressed) {
+            chip8.setKey(event.key, event.pressed);
+            changed++;
+        }
+    }
+
+    return changed;
+}
+
+
+bool InputScript::quitRequested() {
+    return quit;
+}
@@ -0,0 +1,27 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+#include "Chip8.hpp"
+
+// A key change scheduled for a given emulated frame
+struct ScriptedEvent {
+    uint64_t frame;                                         // Applied just before this frame is emulated
+    int8_t key;                                             // CHIP-8 key, or -1 to quit
+    bool pressed;
+};
+
+// Feeds key presses from a file instead of the keyboard, so runs can be repeated unattended
+class InputScript {
+    public:
+        InputScript();
+
+        bool load(const char *filename);                    // Reads a script, see InputScript.cpp for the format
+        int apply(Chip8 &chip8, uint64_t frame);            // Applies every event scheduled for this frame, returns how many keys changed
+        bool quitRequested();                               // True once a "quit" line has been reached
+
+    private:
+        std::vector<ScriptedEvent> events;                  // Sorted by frame
+        size_t next;                                        // Next event to apply
+        bool quit;
+};
@@ -0,0 +1,99 @@
+#include "KeyMap.hpp"
+#include <iostream>
+#include <fstream>
+#include <string>
+#include <cctype>
+
+
+// Default layout: the host keys 0-9 and A-F press the CHIP-8 key with the same hex value
+KeyMap::KeyMap() {
+    for (int i = 0; i < SDL_NUM_SCANCODES; i++) {
+        keys[i] = -1;
+    }
+
+    keys[SDL_SCANCODE_0] = 0x0;
+    for (int i = 0; i < 9; i++) {
+        keys[SDL_SCANCODE_1 + i] = 0x1 + i;                 // Scancodes for 1-9 are consecutive
+    }
+    for (int i = 0; i < 6; i++) {
+        keys[SDL_SCANCODE_A + i] = 0xA + i;                 // Scancodes for A-F are consecutive
+    }
+}
+
+
+// Removes leading and trailing whitespace
+static std::string trim(const std::string &str) {
+    size_t start = str.find_first_not_of(" \t\r");
+    size_t end = str.find_last_not_of(" \t\r");
+
+    if (start == std::string::npos)
+        return "";
+    return str.substr(start, end - start + 1);
+}
+
+
+// Load a layout from a config file
+// Each line has the form "<CHIP-8 key in hex> = <SDL key name>", e.g. "C = 4" or "A = Z"
+// Key names are the ones used by SDL_GetScancodeFromName(), everything after a '#' is a comment
+bool KeyMap::load(const char *filename) {
+    std::ifstream file(filename);
+    if (!file) {
+        std::cout << "ERROR: Could not open key map " << filename << std::endl;
+        return false;
+    }
+
+    int8_t loaded[SDL_NUM_SCANCODES];
+    for (int i = 0; i < SDL_NUM_SCANCODES; i++) {
+        loaded[i] = -1;
+    }
+
+    std::string line;
+    int lineNumber = 0;
+    while (std::getline(file, line)) {
+        lineNumber++;
+
+        size_t comment = line.find('#');
+        if (comment != std::string::npos)
+            line.erase(comment);
+
+        line = trim(line);
+        if (line.empty())
+            continue;
+
+        size_t equals = line.find('=');
+        if (equals == std::string::npos) {
+            std::cout << "ERROR: " << filename << ":" << lineNumber << ": expected <KEY> = <SDL KEY NAME>" << std::endl;
+            return false;
+        }
+
+        std::string chipKey = trim(line.substr(0, equals));
+        std::string hostKey = trim(line.substr(equals + 1));
+
+        if (chipKey.size() != 1 || !isxdigit((unsigned char)chipKey[0])) {
+            std::cout << "ERROR: " << filename << ":" << lineNumber << ": \"" << chipKey << "\" is not a CHIP-8 key (0-F)" << std::endl;
+            return false;
+        }
+
+        SDL_Scancode scancode = SDL_GetScancodeFromName(hostKey.c_str());
+        if (scancode == SDL_SCANCODE_UNKNOWN) {
+            std::cout << "ERROR: " << filename << ":" << lineNumber << ": unknown key name \"" << hostKey << "\"" << std::endl;
+            return false;
+        }
+
+        loaded[scancode] = std::stoi(chipKey, NULL, 16);
+    }
+
+    // Only replace the current layout once the whole file was read successfully
+    for (int i = 0; i < SDL_NUM_SCANCODES; i++) {
+        keys[i] = loaded[i];
+    }
+    return true;
+}
+
+
+int KeyMap::lookup(SDL_Scancode scancode) {
+    if (scancode < 0 || scancode >= SDL_NUM_SCANCODES)
+        return -1;
+
+    return keys[scancode];
+}
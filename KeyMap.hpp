@@ -0,0 +1,17 @@
+#pragma once
+
+#include <SDL2/SDL.h>
+#include <cstdint>
+
+// Maps host keyboard scancodes to CHIP-8 keys (0x0 - 0xF)
+// Several host keys may map to the same CHIP-8 key
+class KeyMap {
+    public:
+        KeyMap();                                           // Starts with the default layout: keys 0-9 and A-F map to their hex value
+
+        bool load(const char *filename);                    // Replaces the current layout with the one in a config file
+        int lookup(SDL_Scancode scancode);                  // Returns the CHIP-8 key for a scancode, or -1 if it is not mapped
+
+    private:
+        int8_t keys[SDL_NUM_SCANCODES];                     // CHIP-8 key for every scancode, -1 if unmapped
+};
@@ -0,0 +1,112 @@
+#include "Latency.hpp"
+#include <iostream>
+#include <iomanip>
+#include <algorithm>
+#include <chrono>
+#include <string>
+
+const int HISTOGRAM_BUCKETS = 16;                           // The last bucket also counts everything above it
+const int HISTOGRAM_BAR_WIDTH = 50;
+
+
+LatencyProbe::LatencyProbe() {
+    pending = false;
+    pending_frame = 0;
+    pending_ns = 0;
+    unanswered = 0;
+    samples = 0;
+    presented = 0;
+}
+
+
+int64_t LatencyProbe::now() {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+
+// Only the first key change is timed until the display responds, later changes before that are part of the same measurement
+void LatencyProbe::keyApplied(uint64_t frame) {
+    if (pending && frame - pending_frame > LATENCY_TIMEOUT_FRAMES) {
+        unanswered++;
+        pending = false;
+    }
+
+    if (!pending) {
+        pending = true;
+        pending_frame = frame;
+        pending_ns = now();
+    }
+}
+
+
+LatencySample LatencyProbe::frameChanged(uint64_t frame) {
+    LatencySample sample{};
+
+    if (pending && frame - pending_frame > LATENCY_TIMEOUT_FRAMES) {
+        unanswered++;
+        pending = false;
+    }
+
+    if (pending) {
+        sample.valid = true;
+        sample.sequence = ++samples;
+        sample.input_frame = pending_frame;
+        sample.change_frame = frame;
+        sample.input_ns = pending_ns;
+        sample.change_ns = now();
+        pending = false;
+    }
+
+    return sample;
+}
+
+
+void LatencyProbe::framePresented(const LatencySample &sample) {
+    if (!sample.valid || sample.sequence <= presented)
+        return;
+
+    presented = sample.sequence;
+    change_frames.push_back(sample.change_frame - sample.input_frame);
+    change_ms.push_back((sample.change_ns - sample.input_ns) / 1e6);
+    present_ms.push_back((now() - sample.input_ns) / 1e6);
+}
+
+
+// Prints min/median/max and a histogram of the values, bucketWidth is the range of values counted by each bar
+static void printHistogram(const char *title, std::vector<double> values, double bucketWidth) {
+    std::cout << title << std::endl;
+    if (values.empty()) {
+        std::cout << "  no samples" << std::endl << std::endl;
+        return;
+    }
+
+    std::sort(values.begin(), values.end());
+    std::cout << std::fixed << std::setprecision(2);
+    std::cout << "  min " << values.front() << "  median " << values[values.size() / 2] << "  max " << values.back() << std::endl;
+
+    uint64_t buckets[HISTOGRAM_BUCKETS] = {};
+    uint64_t largest = 0;
+    for (size_t i = 0; i < values.size(); i++) {
+        int bucket = std::min((int)(values[i] / bucketWidth), HISTOGRAM_BUCKETS - 1);
+        largest = std::max(largest, ++buckets[bucket]);
+    }
+
+    int lastUsed = HISTOGRAM_BUCKETS - 1;
+    while (!buckets[lastUsed])
+        lastUsed--;
+
+    for (int i = 0; i <= lastUsed; i++) {
+        std::cout << "  " << std::setprecision(0) << std::setw(5) << i * bucketWidth << (i == HISTOGRAM_BUCKETS - 1 ? "+ | " : "  | ")
+                  << std::string(buckets[i] * HISTOGRAM_BAR_WIDTH / largest, '#') << " " << buckets[i] << std::endl;
+    }
+    std::cout << std::endl;
+}
+
+
+void LatencyProbe::report() {
+    std::cout << "LATENCY: " << change_frames.size() << " key changes measured, " << unanswered << " without a display change" << std::endl << std::endl;
+
+    printHistogram("Key change to display change (frames):", change_frames, 1);
+    printHistogram("Key change to display change (ms):", change_ms, 2);
+    printHistogram("Key change to frame presented (ms):", present_ms, 2);
+}
@@ -0,0 +1,45 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+const uint64_t LATENCY_TIMEOUT_FRAMES = 60;                 // A key change with no display change within this many frames is counted as unanswered
+
+// Timestamps of one key change and the display change that followed it
+// Travels with the frame from the emulation thread to the thread that presents it
+struct LatencySample {
+    bool valid;
+    uint64_t sequence;                                      // Numbers the samples from 1, a frame can carry a sample already presented with an earlier frame
+    uint64_t input_frame;                                   // Emulated frame the key change was applied in
+    uint64_t change_frame;                                  // Emulated frame the display first changed in afterwards
+    int64_t input_ns;                                       // steady_clock time the key change was applied
+    int64_t change_ns;                                      // steady_clock time the changed frame was finished
+};
+
+// Measures input-to-photon latency: key change applied -> display changes -> changed frame presented
+// keyApplied() and frameChanged() are called by the emulation thread, framePresented() and report() by the presenting thread
+class LatencyProbe {
+    public:
+        LatencyProbe();
+
+        void keyApplied(uint64_t frame);                    // A key change was just applied to the keypad
+        LatencySample frameChanged(uint64_t frame);         // The display just changed, returns a valid sample if a key change was waiting for it
+        void framePresented(const LatencySample &sample);   // A frame was presented, records the sample it carried the first time it is presented
+        void report();                                      // Prints latency histograms in frames and milliseconds
+
+        static int64_t now();                               // Current steady_clock time in nanoseconds
+
+    private:
+        // Emulation thread
+        bool pending;                                       // A key change is waiting for the display to change
+        uint64_t pending_frame;
+        int64_t pending_ns;
+        uint64_t unanswered;                                // Key changes that never changed the display
+        uint64_t samples;                                   // Samples handed out so far
+
+        // Presenting thread
+        uint64_t presented;                                 // Sequence number of the last sample recorded
+        std::vector<double> change_frames;                  // Input -> display change, in frames
+        std::vector<double> change_ms;                      // Input -> display change, in milliseconds
+        std::vector<double> present_ms;                     // Input -> frame presented, in milliseconds
+};
@@ -0,0 +1,54 @@
+#include "Palette.hpp"
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+
+// Every pixel's colour comes from its bit in each plane, so a row is expanded 4 pixels at a time:
+// the next 4 bits of each plane are spread across the 4 lanes of a vector, turned into all-ones/all-zeroes masks,
+// and the masks select between the 4 palette colours without any per-pixel branches or lookups
+#ifdef __SSE2__
+void expandPalette(const VideoRow video[PLANE_COUNT][VIDEO_HEIGHT], unsigned int width, unsigned int height,
+                   const Palette &palette, uint32_t *pixels, unsigned int pitch) {
+    const __m128i laneBits = _mm_set_epi32(1, 2, 4, 8);            // Lane 0 is the leftmost pixel, the highest bit of the nibble
+    const __m128i c0 = _mm_set1_epi32(palette.colours[0]);
+    const __m128i c1 = _mm_set1_epi32(palette.colours[1]);
+    const __m128i c2 = _mm_set1_epi32(palette.colours[2]);
+    const __m128i c3 = _mm_set1_epi32(palette.colours[3]);
+
+    for (unsigned int y = 0; y < height; y++) {
+        VideoRow row0 = video[0][y];
+        VideoRow row1 = video[1][y];
+        uint32_t *out = pixels + y * pitch;
+
+        for (unsigned int x = 0; x < width; x += 4, row0 <<= 4, row1 <<= 4) {
+            __m128i n0 = _mm_set1_epi32((int)(row0 >> (VIDEO_WIDTH - 4)));
+            __m128i n1 = _mm_set1_epi32((int)(row1 >> (VIDEO_WIDTH - 4)));
+            __m128i m0 = _mm_cmpeq_epi32(_mm_and_si128(n0, laneBits), laneBits);
+            __m128i m1 = _mm_cmpeq_epi32(_mm_and_si128(n1, laneBits), laneBits);
+
+            // Pick between colours 0/1 and 2/3 with plane 0, then between those with plane 1
+            __m128i lo = _mm_or_si128(_mm_andnot_si128(m0, c0), _mm_and_si128(m0, c1));
+            __m128i hi = _mm_or_si128(_mm_andnot_si128(m0, c2), _mm_and_si128(m0, c3));
+            __m128i colour = _mm_or_si128(_mm_andnot_si128(m1, lo), _mm_and_si128(m1, hi));
+
+            _mm_storeu_si128((__m128i *)(out + x), colour);
+        }
+    }
+}
+#else
+void expandPalette(const VideoRow video[PLANE_COUNT][VIDEO_HEIGHT], unsigned int width, unsigned int height,
+                   const Palette &palette, uint32_t *pixels, unsigned int pitch) {
+    for (unsigned int y = 0; y < height; y++) {
+        VideoRow row0 = video[0][y];
+        VideoRow row1 = video[1][y];
+        uint32_t *out = pixels + y * pitch;
+
+        for (unsigned int x = 0; x < width; x++, row0 <<= 1, row1 <<= 1) {
+            unsigned int index = (unsigned int)(row0 >> (VIDEO_WIDTH - 1)) | ((unsigned int)(row1 >> (VIDEO_WIDTH - 1)) << 1);
+            out[x] = palette.colours[index];
+        }
+    }
+}
+#endif
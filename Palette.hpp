@@ -0,0 +1,21 @@
+#pragma once
+
+#include <cstdint>
+#include "Chip8.hpp"
+
+const unsigned int PALETTE_SIZE = 4;                        // One colour for each combination of the two bitplanes
+
+
+// Colours of the display, as ARGB8888
+// Index 0 is used where neither plane is set, 1 for plane 0 only, 2 for plane 1 only and 3 where both are set
+struct Palette {
+    uint32_t colours[PALETTE_SIZE];
+};
+
+const Palette DEFAULT_PALETTE = {{0xFF000000, 0xFFFFFFFF, 0xFFAAAAAA, 0xFF555555}};
+
+
+// Turns width x height pixels of the packed bitplanes into ARGB8888 pixels, one row every pitch pixels
+// Width must be a multiple of 4
+void expandPalette(const VideoRow video[PLANE_COUNT][VIDEO_HEIGHT], unsigned int width, unsigned int height,
+                   const Palette &palette, uint32_t *pixels, unsigned int pitch);
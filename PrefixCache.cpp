@@ -0,0 +1,60 @@
+#include "PrefixCache.hpp"
+#include <cstring>
+
+
+PrefixCache::PrefixCache(unsigned long max_frames) {
+    this->max_frames = max_frames;
+    hit_count = 0;
+    miss_count = 0;
+}
+
+
+const ROMTemplate *PrefixCache::find(const uint8_t *data, uint32_t size, Platform platform, const Quirks &quirks, unsigned int ips) {
+    Key key;
+    sha1(data, size, key.sha1);
+    key.platform = platform;
+    key.quirks = quirks.vf_reset | quirks.memory_increment << 1 | quirks.shift_vy << 2 | quirks.jump_vx << 3 | quirks.wrap << 4;
+    key.ips = ips;
+
+    auto found = templates.find(key);
+    if (found != templates.end()) {
+        hit_count++;
+        return &found->second;
+    }
+
+    ROMTemplate rom;
+    if (!rom.load(data, size, platform))
+        return NULL;
+    rom.setQuirks(quirks);
+    rom.skipPrefix(ips, max_frames);
+
+    miss_count++;
+    return &templates.emplace(key, rom).first->second;
+}
+
+
+size_t PrefixCache::size() {
+    return templates.size();
+}
+
+
+uint64_t PrefixCache::hits() {
+    return hit_count;
+}
+
+
+uint64_t PrefixCache::misses() {
+    return miss_count;
+}
+
+
+bool PrefixCache::Key::operator<(const Key &other) const {
+    int order = memcmp(sha1, other.sha1, SHA1_SIZE);
+    if (order)
+        return order < 0;
+    if (platform != other.platform)
+        return platform < other.platform;
+    if (quirks != other.quirks)
+        return quirks < other.quirks;
+    return ips < other.ips;
+}
@@ -0,0 +1,42 @@
+#pragma once
+
+#include <cstdint>
+#include <map>
+#include "Chip8.hpp"
+#include "Sha1.hpp"
+
+// ROM templates that have already run through their ROM's deterministic prefix (see ROMTemplate::skipPrefix())
+// A batch that runs the same ROM over and over only pays for the prefix the first time
+// Templates are keyed by the SHA-1 of the ROM and by everything the prefix depends on: the platform, the quirks and the speed
+// Not safe to use from more than one thread at a time
+
+const unsigned long DEFAULT_PREFIX_FRAMES = 36000;          // Ten emulated minutes, for ROMs that never read input
+
+
+class PrefixCache {
+    public:
+        PrefixCache(unsigned long max_frames = DEFAULT_PREFIX_FRAMES);     // The most frames any prefix is run for
+
+        // The template for a ROM, running its prefix the first time the ROM is asked for with these settings
+        // NULL if the ROM could not be loaded, the template stays valid as long as the cache
+        const ROMTemplate *find(const uint8_t *data, uint32_t size, Platform platform, const Quirks &quirks, unsigned int ips);
+
+        size_t size();
+        uint64_t hits();                                    // Calls to find() that did not have to run a prefix
+        uint64_t misses();
+
+    private:
+        struct Key {
+            uint8_t sha1[SHA1_SIZE];
+            uint8_t platform;
+            uint8_t quirks;                                 // One bit per field of Quirks, in declaration order
+            unsigned int ips;
+
+            bool operator<(const Key &other) const;
+        };
+
+        unsigned long max_frames;
+        std::map<Key, ROMTemplate> templates;
+        uint64_t hit_count;
+        uint64_t miss_count;
+};
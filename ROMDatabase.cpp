@@ -0,0 +1,249 @@
+#include "ROMDatabase.hpp"
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <cstdio>
+#include <cstring>
+#include <algorithm>
+
+const char *const QUIRK_NAMES[QUIRK_COUNT] = {"vf_reset", "memory_increment", "shift_vy", "jump_vx", "wrap"};
+bool Quirks::*const QUIRK_FIELDS[QUIRK_COUNT] = {&Quirks::vf_reset, &Quirks::memory_increment, &Quirks::shift_vy, &Quirks::jump_vx, &Quirks::wrap};
+
+
+bool parseQuirks(const std::string &list, Quirks &quirks) {
+    Quirks parsed = {};
+    if (list == "none") {
+        quirks = parsed;
+        return true;
+    }
+
+    std::istringstream names(list);
+    std::string name;
+    while (std::getline(names, name, ',')) {
+        unsigned int q = 0;
+        while (q < QUIRK_COUNT && name != QUIRK_NAMES[q])
+            q++;
+        if (q == QUIRK_COUNT)
+            return false;
+        parsed.*QUIRK_FIELDS[q] = true;
+    }
+
+    quirks = parsed;
+    return true;
+}
+
+
+std::string quirksName(const Quirks &quirks) {
+    std::string list;
+    for (unsigned int q = 0; q < QUIRK_COUNT; q++) {
+        if (quirks.*QUIRK_FIELDS[q])
+            list += (list.empty() ? "" : ",") + std::string(QUIRK_NAMES[q]);
+    }
+    return list.empty() ? "none" : list;
+}
+
+
+bool ROMDatabase::load(const char *filename) {
+    FILE *fp = fopen(filename, "rb");
+    if (fp == NULL) {
+        std::cout << "ERROR: Could not open ROM database " << filename << std::endl;
+        return false;
+    }
+
+    fseek(fp, 0, SEEK_END);
+    long fsize = ftell(fp);
+    fseek(fp, 0, SEEK_SET);
+
+    DatabaseHeader header;
+    bool ok = fread(&header, sizeof(header), 1, fp) == 1 && header.magic == DATABASE_MAGIC;
+    if (ok && header.version != DATABASE_VERSION) {
+        std::cout << "ERROR: " << filename << " is a version " << header.version << " ROM database, only version " << DATABASE_VERSION << " can be read" << std::endl;
+        fclose(fp);
+        return false;
+    }
+
+    // A damaged header must give the cut short error below rather than a huge allocation
+    ok = ok && fsize >= 0 &&
+         (uint64_t)header.count * sizeof(DatabaseRecord) + header.strings_size <= (uint64_t)fsize - sizeof(header);
+    if (ok) {
+        records.resize(header.count);
+        strings.resize(header.strings_size);
+        ok = fread(records.data(), sizeof(DatabaseRecord), header.count, fp) == header.count &&
+             fread(strings.data(), 1, header.strings_size, fp) == header.strings_size &&
+             (strings.empty() || strings.back() == '\0');
+    }
+    fclose(fp);
+
+    if (!ok) {
+        std::cout << "ERROR: " << filename << " is not a ROM database, or is cut short" << std::endl;
+        records.clear();
+        strings.clear();
+        return false;
+    }
+
+    // find() binary searches the records, so they must be in strictly increasing SHA-1 order
+    for (size_t i = 1; i < records.size(); i++) {
+        if (memcmp(records[i - 1].sha1, records[i].sha1, SHA1_SIZE) >= 0) {
+            std::cout << "ERROR: " << filename << " is not sorted by SHA-1" << std::endl;
+            records.clear();
+            strings.clear();
+            return false;
+        }
+    }
+    return true;
+}
+
+
+bool ROMDatabase::find(const uint8_t *rom, uint32_t size, ROMSettings &settings) {
+    uint8_t digest[SHA1_SIZE];
+    sha1(rom, size, digest);
+    return find(digest, settings);
+}
+
+
+bool ROMDatabase::find(const uint8_t sha1[SHA1_SIZE], ROMSettings &settings) {
+    auto record = std::lower_bound(records.begin(), records.end(), sha1, [](const DatabaseRecord &record, const uint8_t *key) {
+        return memcmp(record.sha1, key, SHA1_SIZE) < 0;
+    });
+    if (record == records.end() || memcmp(record->sha1, sha1, SHA1_SIZE))
+        return false;
+
+    auto string = [&](uint32_t offset) {
+        return offset < strings.size() ? std::string(&strings[offset]) : std::string();
+    };
+
+    settings.settings = record->settings;
+    settings.platform = record->platform <= PLATFORM_XOCHIP ? (Platform)record->platform : PLATFORM_CHIP8;
+    settings.ips = record->ips;
+    for (unsigned int q = 0; q < QUIRK_COUNT; q++) {
+        settings.quirks.*QUIRK_FIELDS[q] = (record->quirks >> q) & 1;
+    }
+    settings.title = string(record->title);
+    settings.keymap = string(record->keymap);
+    memcpy(settings.palette.colours, record->palette, sizeof(settings.palette.colours));
+    return true;
+}
+
+
+size_t ROMDatabase::size() {
+    return records.size();
+}
+
+
+// Each line is "<SHA-1> <FIELD>=<VALUE>...", with the fields:
+//   platform=chip8|schip|xochip
+//   ips=<INSTRUCTIONS PER SECOND>
+//   quirks=<LIST>                  see parseQuirks(), the platform's quirks are used if this is left out
+//   keymap=<FILE>                  a key map file as read by --keymap
+//   palette=<RRGGBB>,<RRGGBB>,<RRGGBB>,<RRGGBB>    the display colours, in the order of Palette
+//   title=<TITLE>                  must come last, the rest of the line is the title
+// Everything after a '#' is a comment
+bool ROMDatabase::compile(const char *source, const char *filename) {
+    std::ifstream file(source);
+    if (!file) {
+        std::cout << "ERROR: Could not open ROM database source " << source << std::endl;
+        return false;
+    }
+
+    std::vector<DatabaseRecord> records;
+    std::vector<char> strings;
+    auto addString = [&](const std::string &value) {
+        uint32_t offset = strings.size();
+        strings.insert(strings.end(), value.begin(), value.end());
+        strings.push_back('\0');
+        return offset;
+    };
+
+    std::string line;
+    int lineNumber = 0;
+    while (std::getline(file, line)) {
+        lineNumber++;
+
+        size_t comment = line.find('#');
+        if (comment != std::string::npos)
+            line.erase(comment);
+
+        std::istringstream fields(line);
+        std::string hash;
+        if (!(fields >> hash))
+            continue;                                       // Blank line
+
+        DatabaseRecord record = {};
+        record.title = NO_STRING;
+        record.keymap = NO_STRING;
+        if (!parseSha1(hash, record.sha1)) {
+            std::cout << "ERROR: " << source << ":" << lineNumber << ": \"" << hash << "\" is not a SHA-1" << std::endl;
+            return false;
+        }
+
+        std::string field;
+        while (fields >> field) {
+            size_t equals = field.find('=');
+            std::string name = field.substr(0, equals);
+            std::string value = equals == std::string::npos ? "" : field.substr(equals + 1);
+            Platform platform;
+            Quirks quirks;
+            unsigned int colours[PALETTE_SIZE];
+            char end;
+
+            if (name == "title") {
+                std::string rest;
+                std::getline(fields, rest);
+                value += rest;
+                value.erase(value.find_last_not_of(" \t\r") + 1);
+                record.title = addString(value);
+            } else if (name == "platform" && Chip8::parsePlatform(value, platform)) {
+                record.platform = platform;
+                record.settings |= SETTING_PLATFORM;
+            } else if (name == "ips" && sscanf(value.c_str(), "%u%c", &record.ips, &end) == 1 && record.ips) {
+                record.settings |= SETTING_IPS;
+            } else if (name == "quirks" && parseQuirks(value, quirks)) {
+                for (unsigned int q = 0; q < QUIRK_COUNT; q++) {
+                    record.quirks |= (quirks.*QUIRK_FIELDS[q]) << q;
+                }
+                record.settings |= SETTING_QUIRKS;
+            } else if (name == "keymap" && !value.empty()) {
+                record.keymap = addString(value);
+                record.settings |= SETTING_KEYMAP;
+            } else if (name == "palette" && sscanf(value.c_str(), "%6x,%6x,%6x,%6x%c", &colours[0], &colours[1], &colours[2], &colours[3], &end) == 4) {
+                for (unsigned int i = 0; i < PALETTE_SIZE; i++) {
+                    record.palette[i] = 0xFF000000 | colours[i];
+                }
+                record.settings |= SETTING_PALETTE;
+            } else {
+                std::cout << "ERROR: " << source << ":" << lineNumber << ": bad field \"" << field << "\"" << std::endl;
+                return false;
+            }
+        }
+
+        records.push_back(record);
+    }
+
+    std::sort(records.begin(), records.end(), [](const DatabaseRecord &a, const DatabaseRecord &b) {
+        return memcmp(a.sha1, b.sha1, SHA1_SIZE) < 0;
+    });
+    for (size_t i = 1; i < records.size(); i++) {
+        if (!memcmp(records[i - 1].sha1, records[i].sha1, SHA1_SIZE)) {
+            std::cout << "ERROR: " << source << ": " << sha1Hex(records[i].sha1) << " is listed more than once" << std::endl;
+            return false;
+        }
+    }
+
+    FILE *fp = fopen(filename, "wb");
+    if (fp == NULL) {
+        std::cout << "ERROR: Could not open file " << filename << std::endl;
+        return false;
+    }
+
+    DatabaseHeader header = {DATABASE_MAGIC, DATABASE_VERSION, (uint32_t)records.size(), (uint32_t)strings.size()};
+    fwrite(&header, sizeof(header), 1, fp);
+    fwrite(records.data(), sizeof(DatabaseRecord), records.size(), fp);
+    fwrite(strings.data(), 1, strings.size(), fp);
+
+    bool ok = !ferror(fp);
+    if (fclose(fp) != 0)
+        ok = false;
+    if (!ok)
+        std::cout << "ERROR: Could not write file " << filename << std::endl;
+    return ok;
+}
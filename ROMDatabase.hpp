@@ -0,0 +1,90 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+#include "Chip8.hpp"
+#include "Palette.hpp"
+#include "Sha1.hpp"
+
+// Settings known to suit particular ROMs, looked up by the SHA-1 of the ROM file
+// The database is written as text (see romdb/romdb.txt for the format) and compiled by romdb into a binary index:
+//   header    magic "CRDB", version, record count, size of the string table
+//   records   one DatabaseRecord per ROM, sorted by SHA-1
+//   strings   titles and key map paths, each followed by a 0 byte
+// Looking a ROM up is a binary search over the records as they were read from the file
+// Every field is in host byte order
+
+const uint32_t DATABASE_MAGIC = 0x42445243;                 // "CRDB"
+const uint32_t DATABASE_VERSION = 1;
+const uint32_t NO_STRING = UINT32_MAX;
+
+// Which of a record's settings are set, anything else is left as it is
+const uint8_t SETTING_PLATFORM = 0x01;
+const uint8_t SETTING_IPS = 0x02;
+const uint8_t SETTING_QUIRKS = 0x04;
+const uint8_t SETTING_KEYMAP = 0x08;
+const uint8_t SETTING_PALETTE = 0x10;
+
+// Quirk bits of a record
+const uint8_t QUIRK_VF_RESET = 0x01;
+const uint8_t QUIRK_MEMORY_INCREMENT = 0x02;
+const uint8_t QUIRK_SHIFT_VY = 0x04;
+const uint8_t QUIRK_JUMP_VX = 0x08;
+const uint8_t QUIRK_WRAP = 0x10;
+const unsigned int QUIRK_COUNT = 5;
+
+extern const char *const QUIRK_NAMES[QUIRK_COUNT];         // The quirks in the order of their QUIRK_ bits, named as in Quirks
+extern bool Quirks::*const QUIRK_FIELDS[QUIRK_COUNT];
+
+
+struct DatabaseHeader {
+    uint32_t magic;
+    uint32_t version;
+    uint32_t count;
+    uint32_t strings_size;
+};
+
+struct DatabaseRecord {
+    uint8_t sha1[SHA1_SIZE];
+    uint8_t settings;                                       // SETTING_ bits
+    uint8_t platform;
+    uint8_t quirks;                                         // QUIRK_ bits
+    uint8_t reserved;
+    uint32_t ips;
+    uint32_t title;                                         // Offset in the string table, NO_STRING if there is none
+    uint32_t keymap;
+    uint32_t palette[PALETTE_SIZE];
+};
+
+
+// A record with its strings looked up
+struct ROMSettings {
+    uint8_t settings;                                       // SETTING_ bits
+    Platform platform;
+    unsigned int ips;
+    Quirks quirks;
+    std::string title;
+    std::string keymap;                                     // Path of a key map file, relative to where the emulator is run from
+    Palette palette;
+};
+
+
+class ROMDatabase {
+    public:
+        bool load(const char *filename);                    // Reads a database compiled by romdb
+        bool find(const uint8_t *rom, uint32_t size, ROMSettings &settings);    // Looks the ROM up by its hash, false if it is not in the database
+        bool find(const uint8_t sha1[SHA1_SIZE], ROMSettings &settings);
+        size_t size();
+
+        static bool compile(const char *source, const char *filename);         // Turns the text form into the binary index
+
+    private:
+        std::vector<DatabaseRecord> records;
+        std::vector<char> strings;
+};
+
+
+// Quirk lists are the field names of Quirks separated by commas, e.g. "vf_reset,memory_increment" -- "none" turns every quirk off
+bool parseQuirks(const std::string &list, Quirks &quirks);
+std::string quirksName(const Quirks &quirks);
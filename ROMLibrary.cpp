@@ -0,0 +1,276 @@
+#include "ROMLibrary.hpp"
+#include "Chip8.hpp"
+#include <iostream>
+#include <cstdio>
+#include <cstring>
+#include <algorithm>
+#include <filesystem>
+
+#ifndef _WIN32
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+const uint32_t MAX_ROM_SIZE = XO_MEMORY_SIZE - 0x200;       // The most any platform can load
+
+
+ROMLibrary::ROMLibrary() {}
+
+
+ROMLibrary::~ROMLibrary() {
+    close();
+}
+
+
+bool ROMLibrary::open(const char *path) {
+    std::error_code error;
+    if (!std::filesystem::is_directory(path, error)) {
+        bool ok = openFile(path);
+        sort();
+        return ok;
+    }
+
+    // Sorted so the same directory always gives the same library, whatever order the file system lists it in
+    // Files of any size are opened, openFile() tells archives from ROMs and skips files too large to be either
+    std::vector<std::string> files;
+    for (const auto &entry : std::filesystem::recursive_directory_iterator(path, error)) {
+        if (entry.is_regular_file())
+            files.push_back(entry.path().string());
+    }
+    if (error) {
+        std::cout << "ERROR: Could not read directory " << path << std::endl;
+        return false;
+    }
+    std::sort(files.begin(), files.end());
+
+    bool ok = true;
+    for (const std::string &file : files) {
+        ok &= openFile(file);
+    }
+    sort();
+    return ok;
+}
+
+
+// An archive is recognised by its header, anything else is a single ROM
+bool ROMLibrary::openFile(const std::string &path) {
+    size_t size;
+    const uint8_t *file = map(path, size);
+    if (file == NULL && size)
+        return false;
+
+    if (size >= sizeof(ArchiveHeader) && ((const ArchiveHeader *)file)->magic == ARCHIVE_MAGIC)
+        return openArchive(path, file, size);
+
+    if (size > MAX_ROM_SIZE) {
+        unmapLast();
+        return true;
+    }
+
+    ROMEntry entry;
+    entry.name = path;
+    entry.data = file;
+    entry.size = size;
+    sha1(file, size, entry.sha1);
+    entries.push_back(entry);
+    return true;
+}
+
+
+bool ROMLibrary::openArchive(const std::string &path, const uint8_t *file, size_t size) {
+    const ArchiveHeader *header = (const ArchiveHeader *)file;
+    if (header->version != ARCHIVE_VERSION) {
+        std::cout << "ERROR: " << path << " is a version " << header->version << " ROM archive, only version " << ARCHIVE_VERSION << " can be read" << std::endl;
+        unmapLast();
+        return false;
+    }
+    if (header->count > (size - sizeof(ArchiveHeader)) / sizeof(ArchiveEntry)) {
+        std::cout << "ERROR: " << path << " is cut short" << std::endl;
+        unmapLast();
+        return false;
+    }
+
+    // A bad entry drops the whole archive, including the entries already added from it, as they point into the mapping
+    size_t first = entries.size();
+    const ArchiveEntry *index = (const ArchiveEntry *)(file + sizeof(ArchiveHeader));
+    for (uint32_t i = 0; i < header->count; i++) {
+        const ArchiveEntry &packed = index[i];
+        if ((uint64_t)packed.name_offset + packed.name_size >= size || (uint64_t)packed.data_offset + packed.data_size > size) {
+            std::cout << "ERROR: " << path << " has an entry outside the file" << std::endl;
+            entries.resize(first);
+            unmapLast();
+            return false;
+        }
+
+        ROMEntry entry;
+        entry.name.assign((const char *)file + packed.name_offset, packed.name_size);
+        entry.data = packed.data_size ? file + packed.data_offset : NULL;
+        entry.size = packed.data_size;
+        memcpy(entry.sha1, packed.sha1, SHA1_SIZE);
+        entries.push_back(entry);
+    }
+    return true;
+}
+
+
+bool ROMLibrary::pack(const char *filename) {
+    // One copy of each ROM, the index comes out sorted by SHA-1 since the entries are
+    std::vector<const ROMEntry *> unique;
+    for (const ROMEntry &entry : entries) {
+        if (unique.empty() || memcmp(unique.back()->sha1, entry.sha1, SHA1_SIZE))
+            unique.push_back(&entry);
+    }
+
+    ArchiveHeader header = {ARCHIVE_MAGIC, ARCHIVE_VERSION, (uint32_t)unique.size(), 0};
+    std::vector<ArchiveEntry> index(unique.size());
+    uint64_t offset = sizeof(ArchiveHeader) + sizeof(ArchiveEntry) * unique.size();
+    for (size_t i = 0; i < unique.size(); i++) {
+        memcpy(index[i].sha1, unique[i]->sha1, SHA1_SIZE);
+        index[i].name_offset = offset;
+        index[i].name_size = unique[i]->name.size();
+        offset += unique[i]->name.size() + 1;
+    }
+    for (size_t i = 0; i < unique.size(); i++) {
+        index[i].data_offset = offset;
+        index[i].data_size = unique[i]->size;
+        offset += unique[i]->size;
+    }
+    if (offset > UINT32_MAX) {
+        std::cout << "ERROR: The library is too large to pack into one archive" << std::endl;
+        return false;
+    }
+
+    FILE *fp = fopen(filename, "wb");
+    if (fp == NULL) {
+        std::cout << "ERROR: Could not open file " << filename << std::endl;
+        return false;
+    }
+
+    fwrite(&header, sizeof(header), 1, fp);
+    fwrite(index.data(), sizeof(ArchiveEntry), index.size(), fp);
+    for (const ROMEntry *entry : unique) {
+        fwrite(entry->name.c_str(), 1, entry->name.size() + 1, fp);
+    }
+    for (const ROMEntry *entry : unique) {
+        if (entry->size)
+            fwrite(entry->data, 1, entry->size, fp);
+    }
+
+    bool ok = !ferror(fp);
+    if (fclose(fp) != 0)
+        ok = false;
+    if (!ok)
+        std::cout << "ERROR: Could not write file " << filename << std::endl;
+    return ok;
+}
+
+
+size_t ROMLibrary::size() {
+    return entries.size();
+}
+
+
+const ROMEntry &ROMLibrary::entry(size_t i) {
+    return entries[i];
+}
+
+
+const ROMEntry *ROMLibrary::find(const uint8_t sha1[SHA1_SIZE]) {
+    auto first = std::lower_bound(entries.begin(), entries.end(), sha1, [](const ROMEntry &entry, const uint8_t *key) {
+        return memcmp(entry.sha1, key, SHA1_SIZE) < 0;
+    });
+    if (first == entries.end() || memcmp(first->sha1, sha1, SHA1_SIZE))
+        return NULL;
+    return &*first;
+}
+
+
+const ROMEntry *ROMLibrary::find(const std::string &sha1) {
+    uint8_t digest[SHA1_SIZE];
+    if (!parseSha1(sha1, digest))
+        return NULL;
+    return find(digest);
+}
+
+
+// Opening a single ROM adds it to the end, so most calls find the entries already in order
+void ROMLibrary::sort() {
+    auto before = [](const ROMEntry &a, const ROMEntry &b) {
+        int order = memcmp(a.sha1, b.sha1, SHA1_SIZE);
+        return order < 0 || (order == 0 && a.name < b.name);
+    };
+    if (!std::is_sorted(entries.begin(), entries.end(), before))
+        std::sort(entries.begin(), entries.end(), before);
+}
+
+
+#ifdef _WIN32
+
+const uint8_t *ROMLibrary::map(const std::string &path, size_t &size) {
+    std::cout << "ERROR: Memory-mapped ROM libraries are not supported on this platform" << std::endl;
+    size = 1;
+    return NULL;
+}
+
+
+void ROMLibrary::unmapLast() {}
+
+
+void ROMLibrary::close() {
+    entries.clear();
+}
+
+#else
+
+const uint8_t *ROMLibrary::map(const std::string &path, size_t &size) {
+    size = 1;                                               // Anything but 0, so a failure is not taken for an empty file
+
+    int fd = ::open(path.c_str(), O_RDONLY);
+    if (fd < 0) {
+        std::cout << "ERROR: Could not open file " << path << std::endl;
+        return NULL;
+    }
+
+    struct stat info;
+    if (fstat(fd, &info) < 0) {
+        std::cout << "ERROR: Could not read file " << path << std::endl;
+        ::close(fd);
+        return NULL;
+    }
+
+    size = info.st_size;
+    if (size == 0) {
+        ::close(fd);
+        return NULL;                                        // An empty mapping is not allowed, and an empty ROM does not need one
+    }
+
+    void *address = mmap(NULL, size, PROT_READ, MAP_PRIVATE, fd, 0);
+    ::close(fd);
+    if (address == MAP_FAILED) {
+        std::cout << "ERROR: Could not map file " << path << std::endl;
+        size = 1;
+        return NULL;
+    }
+
+    mappings.push_back({address, size});
+    return (const uint8_t *)address;
+}
+
+
+void ROMLibrary::unmapLast() {
+    munmap(mappings.back().address, mappings.back().size);
+    mappings.pop_back();
+}
+
+
+void ROMLibrary::close() {
+    entries.clear();
+    for (const Mapping &mapping : mappings) {
+        munmap(mapping.address, mapping.size);
+    }
+    mappings.clear();
+}
+
+#endif
@@ -0,0 +1,79 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+#include "Sha1.hpp"
+
+// A collection of ROMs mapped into memory and indexed by SHA-1
+// Every ROM is handed out as a span straight into the mapped files, ready for Chip8::loadROM(data, size) without copying or reading it again
+// Spans stay valid until the library is closed
+//
+// A library can also be packed into one archive file, which opens without reading or hashing any ROM:
+//   header    magic "CLIB", version, ROM count, 0
+//   index     one ArchiveEntry per ROM, sorted by SHA-1
+//   names     each one followed by a 0 byte
+//   ROMs      back to back
+// Offsets are from the start of the file, every field is in host byte order
+
+const uint32_t ARCHIVE_MAGIC = 0x42494C43;                  // "CLIB"
+const uint32_t ARCHIVE_VERSION = 1;
+
+
+struct ArchiveHeader {
+    uint32_t magic;
+    uint32_t version;
+    uint32_t count;
+    uint32_t reserved;
+};
+
+struct ArchiveEntry {
+    uint8_t sha1[SHA1_SIZE];
+    uint32_t name_offset;
+    uint32_t name_size;                                     // Not counting the 0 byte
+    uint32_t data_offset;
+    uint32_t data_size;
+};
+
+
+struct ROMEntry {
+    std::string name;                                       // Path of the file, or the name it was packed under
+    const uint8_t *data;                                    // Inside a mapped file, NULL for an empty ROM
+    uint32_t size;
+    uint8_t sha1[SHA1_SIZE];
+};
+
+
+class ROMLibrary {
+    public:
+        ROMLibrary();
+        ~ROMLibrary();
+        ROMLibrary(const ROMLibrary &) = delete;            // Entries point into the mappings, which only this library may unmap
+        ROMLibrary &operator=(const ROMLibrary &) = delete;
+
+        // Adds a ROM file, every file under a directory, or every ROM in an archive -- may be called again to add more
+        // Files too large to ever be loaded (bigger than XO-CHIP program memory) are skipped
+        bool open(const char *path);
+        bool pack(const char *filename);                    // Writes every ROM in the library to one archive, ROMs with the same hash are stored once
+        void close();                                       // Unmaps everything, every span handed out becomes invalid
+
+        size_t size();
+        const ROMEntry &entry(size_t i);                    // Entries are sorted by SHA-1, and by name where the hashes are equal
+        const ROMEntry *find(const uint8_t sha1[SHA1_SIZE]);        // The first ROM with this hash, NULL if there is none
+        const ROMEntry *find(const std::string &sha1);              // The same with the hash in hex
+
+    private:
+        struct Mapping {
+            void *address;
+            size_t size;
+        };
+
+        bool openFile(const std::string &path);
+        bool openArchive(const std::string &path, const uint8_t *file, size_t size);
+        const uint8_t *map(const std::string &path, size_t &size);     // Maps a whole file read-only, NULL if it could not be (size is 0 for an empty file)
+        void unmapLast();
+        void sort();
+
+        std::vector<Mapping> mappings;
+        std::vector<ROMEntry> entries;
+};
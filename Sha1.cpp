@@ -0,0 +1,112 @@
+#include "Sha1.hpp"
+#include <cstring>
+#include <cctype>
+
+
+static inline uint32_t rotateLeft(uint32_t value, unsigned int bits) {
+    return (value << bits) | (value >> (32 - bits));
+}
+
+
+// Runs the compression function on one 64-byte block
+static void sha1Block(uint32_t state[5], const uint8_t *block) {
+    uint32_t w[80];
+    for (unsigned int i = 0; i < 16; i++) {
+        w[i] = (block[i * 4] << 24) | (block[i * 4 + 1] << 16) | (block[i * 4 + 2] << 8) | block[i * 4 + 3];
+    }
+    for (unsigned int i = 16; i < 80; i++) {
+        w[i] = rotateLeft(w[i - 3] ^ w[i - 8] ^ w[i - 14] ^ w[i - 16], 1);
+    }
+
+    uint32_t a = state[0], b = state[1], c = state[2], d = state[3], e = state[4];
+    for (unsigned int i = 0; i < 80; i++) {
+        uint32_t f, k;
+        if (i < 20) {
+            f = (b & c) | (~b & d);
+            k = 0x5A827999;
+        } else if (i < 40) {
+            f = b ^ c ^ d;
+            k = 0x6ED9EBA1;
+        } else if (i < 60) {
+            f = (b & c) | (b & d) | (c & d);
+            k = 0x8F1BBCDC;
+        } else {
+            f = b ^ c ^ d;
+            k = 0xCA62C1D6;
+        }
+
+        uint32_t t = rotateLeft(a, 5) + f + e + k + w[i];
+        e = d;
+        d = c;
+        c = rotateLeft(b, 30);
+        b = a;
+        a = t;
+    }
+
+    state[0] += a;
+    state[1] += b;
+    state[2] += c;
+    state[3] += d;
+    state[4] += e;
+}
+
+
+void sha1(const uint8_t *data, size_t size, uint8_t digest[SHA1_SIZE]) {
+    uint32_t state[5] = {0x67452301, 0xEFCDAB89, 0x98BADCFE, 0x10325476, 0xC3D2E1F0};
+
+    size_t whole = size & ~(size_t)63;
+    for (size_t i = 0; i < whole; i += 64) {
+        sha1Block(state, data + i);
+    }
+
+    // The last block(s): the leftover bytes, a 1 bit, zeroes, then the length in bits
+    uint8_t tail[128] = {};
+    size_t left = size - whole;
+    if (left)
+        memcpy(tail, data + whole, left);
+    tail[left] = 0x80;
+    size_t tailSize = left < 56 ? 64 : 128;
+    uint64_t bits = (uint64_t)size * 8;
+    for (unsigned int i = 0; i < 8; i++) {
+        tail[tailSize - 1 - i] = bits >> (i * 8);
+    }
+    for (size_t i = 0; i < tailSize; i += 64) {
+        sha1Block(state, tail + i);
+    }
+
+    for (unsigned int i = 0; i < 5; i++) {
+        digest[i * 4] = state[i] >> 24;
+        digest[i * 4 + 1] = state[i] >> 16;
+        digest[i * 4 + 2] = state[i] >> 8;
+        digest[i * 4 + 3] = state[i];
+    }
+}
+
+
+std::string sha1Hex(const uint8_t digest[SHA1_SIZE]) {
+    static const char DIGITS[] = "0123456789abcdef";
+    std::string hex(SHA1_SIZE * 2, '0');
+    for (unsigned int i = 0; i < SHA1_SIZE; i++) {
+        hex[i * 2] = DIGITS[digest[i] >> 4];
+        hex[i * 2 + 1] = DIGITS[digest[i] & 0xF];
+    }
+    return hex;
+}
+
+
+bool parseSha1(const std::string &hex, uint8_t digest[SHA1_SIZE]) {
+    if (hex.size() != SHA1_SIZE * 2)
+        return false;
+
+    for (unsigned int i = 0; i < SHA1_SIZE * 2; i++) {
+        char c = tolower((unsigned char)hex[i]);
+        if (!isxdigit((unsigned char)c))
+            return false;
+        unsigned int nibble = c <= '9' ? c - '0' : c - 'a' + 10;
+        if (i % 2)
+            digest[i / 2] |= nibble;
+        else
+            digest[i / 2] = nibble << 4;
+    }
+    return true;
+}
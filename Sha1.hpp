@@ -0,0 +1,15 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+// SHA-1 of a ROM's bytes, the key ROMs are looked up by in ROM libraries and the metadata database
+// It is only used to tell ROMs apart, not for anything that has to stand up to an attacker
+
+const unsigned int SHA1_SIZE = 20;
+
+
+void sha1(const uint8_t *data, size_t size, uint8_t digest[SHA1_SIZE]);
+std::string sha1Hex(const uint8_t digest[SHA1_SIZE]);                      // 40 lowercase hex digits
+bool parseSha1(const std::string &hex, uint8_t digest[SHA1_SIZE]);        // False unless hex is exactly 40 hex digits, either case
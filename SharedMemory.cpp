@@ -0,0 +1,267 @@
+#include "SharedMemory.hpp"
+#include <iostream>
+#include <cstring>
+#include <new>
+
+#ifndef _WIN32
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+// The atomics live in memory shared between processes, so they must not hide a lock inside the process
+static_assert(std::atomic<uint32_t>::is_always_lock_free, "shared-memory atomics must be lock-free");
+
+
+SharedChannel::SharedChannel() {
+    segment = NULL;
+    name[0] = '\0';
+    owner = false;
+}
+
+
+SharedChannel::~SharedChannel() {
+    close();
+}
+
+
+#ifdef _WIN32
+
+bool SharedChannel::create(const char *name) {
+    std::cout << "ERROR: Shared memory is not supported on this platform" << std::endl;
+    return false;
+}
+
+
+bool SharedChannel::attach(const char *name) {
+    std::cout << "ERROR: Shared memory is not supported on this platform" << std::endl;
+    return false;
+}
+
+
+void SharedChannel::close() {}
+
+#else
+
+bool SharedChannel::create(const char *name) {
+    close();
+
+    shm_unlink(name);                                       // Left over from an emulator that did not exit cleanly
+    int fd = shm_open(name, O_CREAT | O_EXCL | O_RDWR, 0600);
+    if (fd < 0) {
+        std::cout << "ERROR: Could not create shared memory " << name << std::endl;
+        return false;
+    }
+
+    if (ftruncate(fd, sizeof(SharedSegment)) < 0) {
+        std::cout << "ERROR: Could not size shared memory " << name << std::endl;
+        ::close(fd);
+        shm_unlink(name);
+        return false;
+    }
+
+    void *memory = mmap(NULL, sizeof(SharedSegment), PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    ::close(fd);
+    if (memory == MAP_FAILED) {
+        std::cout << "ERROR: Could not map shared memory " << name << std::endl;
+        shm_unlink(name);
+        return false;
+    }
+
+    // The new segment is all zeroes, only the command slots need setting up
+    segment = new (memory) SharedSegment;
+    segment->version = SHARED_VERSION;
+    for (unsigned int i = 0; i < COMMAND_RING_SIZE; i++) {
+        segment->commands[i].sequence.store(i, std::memory_order_relaxed);
+    }
+    segment->magic.store(SHARED_MAGIC, std::memory_order_release);
+
+    strncpy(this->name, name, sizeof(this->name) - 1);
+    this->name[sizeof(this->name) - 1] = '\0';
+    owner = true;
+    return true;
+}
+
+
+bool SharedChannel::attach(const char *name) {
+    close();
+
+    int fd = shm_open(name, O_RDWR, 0);
+    if (fd < 0) {
+        std::cout << "ERROR: Could not open shared memory " << name << " -- is the emulator running with --shm?" << std::endl;
+        return false;
+    }
+
+    struct stat info;
+    if (fstat(fd, &info) < 0 || info.st_size < (off_t)sizeof(SharedSegment)) {
+        std::cout << "ERROR: Shared memory " << name << " is not a Chip8 segment" << std::endl;
+        ::close(fd);
+        return false;
+    }
+
+    void *memory = mmap(NULL, sizeof(SharedSegment), PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    ::close(fd);
+    if (memory == MAP_FAILED) {
+        std::cout << "ERROR: Could not map shared memory " << name << std::endl;
+        return false;
+    }
+
+    segment = (SharedSegment *)memory;
+    if (segment->magic.load(std::memory_order_acquire) != SHARED_MAGIC || segment->version != SHARED_VERSION) {
+        std::cout << "ERROR: Shared memory " << name << " is not a Chip8 segment of this version" << std::endl;
+        close();
+        return false;
+    }
+
+    owner = false;
+    return true;
+}
+
+
+void SharedChannel::close() {
+    if (!segment)
+        return;
+
+    munmap(segment, sizeof(SharedSegment));
+    segment = NULL;
+
+    if (owner)
+        shm_unlink(name);
+    owner = false;
+}
+
+#endif
+
+
+
+
+// Seqlock write: readers that overlap with this see an odd or changed sequence number and try again
+void SharedChannel::publish(Chip8 &chip8, uint64_t frame, bool paused) {
+    if (!segment)
+        return;
+
+    uint32_t sequence = segment->frame_sequence.load(std::memory_order_relaxed);
+    segment->frame_sequence.store(sequence + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+
+    SharedFrame &out = segment->frame;
+    out.frame = frame;
+    out.paused = paused;
+    out.width = chip8.screenWidth();
+    out.height = chip8.screenHeight();
+    out.registers = chip8.getRegisters();
+    memcpy(out.keypad, chip8.keypad, sizeof(out.keypad));
+    memcpy(out.video, chip8.video, sizeof(out.video));
+
+    segment->frame_sequence.store(sequence + 2, std::memory_order_release);
+}
+
+
+void SharedChannel::publishSnapshot(Chip8 &chip8, uint64_t frame) {
+    if (!segment)
+        return;
+
+    uint32_t sequence = segment->snapshot_sequence.load(std::memory_order_relaxed);
+    segment->snapshot_sequence.store(sequence + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+
+    segment->snapshot_frame = frame;
+    segment->snapshot_size = chip8.memorySize();
+    for (uint32_t i = 0; i < segment->snapshot_size; i++) {
+        segment->snapshot[i] = chip8.readMemory(i);
+    }
+
+    segment->snapshot_sequence.store(sequence + 2, std::memory_order_release);
+}
+
+
+// Only the emulator takes commands, so the tail needs no compare-and-swap
+bool SharedChannel::popCommand(SharedCommand &command) {
+    if (!segment)
+        return false;
+
+    uint32_t tail = segment->command_tail.load(std::memory_order_relaxed);
+    CommandSlot &slot = segment->commands[tail & (COMMAND_RING_SIZE - 1)];
+    if (slot.sequence.load(std::memory_order_acquire) != tail + 1)
+        return false;                                       // Empty, or a tool is still filling the slot in
+
+    command = slot.command;
+    slot.sequence.store(tail + COMMAND_RING_SIZE, std::memory_order_release);     // Free for the tool that laps the ring next
+    segment->command_tail.store(tail + 1, std::memory_order_relaxed);
+    return true;
+}
+
+
+
+
+bool SharedChannel::readFrame(SharedFrame &frame) {
+    if (!segment)
+        return false;
+
+    while (true) {
+        uint32_t before = segment->frame_sequence.load(std::memory_order_acquire);
+        if (before & 1)
+            continue;                                       // The emulator is writing, it is never in the middle for long
+
+        memcpy(&frame, &segment->frame, sizeof(SharedFrame));
+
+        std::atomic_thread_fence(std::memory_order_acquire);
+        if (segment->frame_sequence.load(std::memory_order_relaxed) == before)
+            return before != 0;
+    }
+}
+
+
+bool SharedChannel::readSnapshot(uint8_t *memory, uint32_t &size, uint64_t &frame) {
+    if (!segment)
+        return false;
+
+    while (true) {
+        uint32_t before = segment->snapshot_sequence.load(std::memory_order_acquire);
+        if (before & 1)
+            continue;
+
+        size = segment->snapshot_size;
+        frame = segment->snapshot_frame;
+        memcpy(memory, segment->snapshot, XO_MEMORY_SIZE);
+
+        std::atomic_thread_fence(std::memory_order_acquire);
+        if (segment->snapshot_sequence.load(std::memory_order_relaxed) == before)
+            return before != 0;
+    }
+}
+
+
+uint32_t SharedChannel::snapshotsTaken() {
+    if (!segment)
+        return 0;
+
+    return (segment->snapshot_sequence.load(std::memory_order_acquire) + 1) / 2;     // Counts a snapshot being written as taken, readSnapshot() waits for it
+}
+
+
+// A tool claims the slot at the head, fills it in, then marks it filled
+// If another tool claimed the slot first, the compare-and-swap fails and the next slot is tried
+bool SharedChannel::pushCommand(const SharedCommand &command) {
+    if (!segment)
+        return false;
+
+    uint32_t head = segment->command_head.load(std::memory_order_relaxed);
+    while (true) {
+        CommandSlot &slot = segment->commands[head & (COMMAND_RING_SIZE - 1)];
+        int32_t state = (int32_t)(slot.sequence.load(std::memory_order_acquire) - head);
+
+        if (state == 0) {
+            if (segment->command_head.compare_exchange_weak(head, head + 1, std::memory_order_relaxed)) {
+                slot.command = command;
+                slot.sequence.store(head + 1, std::memory_order_release);
+                return true;
+            }
+        } else if (state < 0) {
+            return false;                                   // The emulator has not taken the command a lap ago yet, the ring is full
+        } else {
+            head = segment->command_head.load(std::memory_order_relaxed);
+        }
+    }
+}
@@ -0,0 +1,96 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include "Chip8.hpp"
+
+// Shared-memory channel between a running emulator and external tools (recorders, dashboards, agents)
+// The emulator publishes the display, registers and keypad into a POSIX shared-memory segment once per frame,
+// and tools send key presses and control commands back through a ring in the same segment
+// Neither side ever waits on the other, so tools can attach and detach at any time without slowing the emulator down
+
+const uint32_t SHARED_MAGIC = 0x38504843;                   // "CHP8", written last so a tool never attaches to a half-made segment
+const uint32_t SHARED_VERSION = 1;
+const unsigned int COMMAND_RING_SIZE = 64;                  // Must be a power of two
+
+
+enum SharedCommandType : uint8_t {
+    COMMAND_KEY,                                            // Press or release key
+    COMMAND_PAUSE,                                          // Stop running frames, the frame keeps being published
+    COMMAND_RESUME,
+    COMMAND_STEP,                                           // Run count frames while paused
+    COMMAND_SNAPSHOT                                        // Copy the whole of guest memory into the snapshot area
+};
+
+struct SharedCommand {
+    SharedCommandType type;
+    uint8_t key;
+    bool pressed;
+    uint32_t count;
+};
+
+
+// Everything published once per frame
+struct SharedFrame {
+    uint64_t frame;                                         // Frames emulated since the ROM was loaded
+    bool paused;
+    uint32_t width;                                         // Resolution the display is in
+    uint32_t height;
+    Registers registers;
+    uint8_t keypad[KEY_COUNT];
+    VideoRow video[PLANE_COUNT][VIDEO_HEIGHT];
+};
+
+
+// Layout of the segment
+// The frame and the snapshot are each guarded by a seqlock: the sequence number is odd while the emulator is writing,
+// so a reader copies the data out and retries if the number changed (or was odd) in the meantime
+// Commands go through a bounded multi-producer queue, each slot's sequence number says whether it is free, filled or being filled
+struct CommandSlot {
+    std::atomic<uint32_t> sequence;
+    SharedCommand command;
+};
+
+struct SharedSegment {
+    std::atomic<uint32_t> magic;
+    uint32_t version;
+
+    std::atomic<uint32_t> frame_sequence;
+    SharedFrame frame;
+
+    std::atomic<uint32_t> snapshot_sequence;
+    uint64_t snapshot_frame;                                // Frame the snapshot was taken at
+    uint32_t snapshot_size;                                 // Bytes of memory in the snapshot
+    uint8_t snapshot[XO_MEMORY_SIZE];
+
+    std::atomic<uint32_t> command_head;                     // Next slot a tool will fill
+    std::atomic<uint32_t> command_tail;                     // Next slot the emulator will read, only changed by the emulator
+    CommandSlot commands[COMMAND_RING_SIZE];
+};
+
+
+class SharedChannel {
+    public:
+        SharedChannel();
+        ~SharedChannel();
+
+        // Emulator side
+        bool create(const char *name);                      // Creates the segment (e.g. "/chip8"), replacing any old one with the same name
+        void publish(Chip8 &chip8, uint64_t frame, bool paused);   // Once per frame
+        void publishSnapshot(Chip8 &chip8, uint64_t frame);
+        bool popCommand(SharedCommand &command);            // Takes the next command a tool sent, false if there are none
+
+        // Tool side
+        bool attach(const char *name);                      // Opens a segment made by a running emulator
+        bool readFrame(SharedFrame &frame);                 // Copies out the latest frame, false if nothing has been published yet
+        bool readSnapshot(uint8_t *memory, uint32_t &size, uint64_t &frame);   // memory must hold XO_MEMORY_SIZE bytes, false if no snapshot has been taken
+        uint32_t snapshotsTaken();                          // Goes up by one each time the emulator takes a snapshot
+        bool pushCommand(const SharedCommand &command);     // Safe to call from several tools at once, false if the ring is full
+
+        void close();                                       // Detaches, and removes the segment if this side created it
+
+    private:
+        SharedSegment *segment;                             // NULL when not open
+        char name[256];
+        bool owner;                                         // This side created the segment
+};
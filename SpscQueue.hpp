@@ -0,0 +1,40 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+
+// Lock-free bounded queue for passing values from exactly one producer thread to exactly one consumer thread
+// SIZE must be a power of two, the queue holds at most SIZE values
+template <typename T, size_t SIZE>
+class SpscQueue {
+    static_assert((SIZE & (SIZE - 1)) == 0, "SpscQueue size must be a power of two");
+
+    public:
+        SpscQueue() : head(0), tail(0) {}
+
+        bool push(const T &value) {                         // Producer side, returns false (and drops the value) if the queue is full
+            size_t t = tail.load(std::memory_order_relaxed);
+            if (t - head.load(std::memory_order_acquire) == SIZE)
+                return false;
+
+            items[t & (SIZE - 1)] = value;
+            tail.store(t + 1, std::memory_order_release);
+            return true;
+        }
+
+        bool pop(T &value) {                                // Consumer side, returns false if the queue is empty
+            size_t h = head.load(std::memory_order_relaxed);
+            if (h == tail.load(std::memory_order_acquire))
+                return false;
+
+            value = items[h & (SIZE - 1)];
+            head.store(h + 1, std::memory_order_release);
+            return true;
+        }
+
+    private:
+        T items[SIZE];
+
+        alignas(64) std::atomic<size_t> head;               // Next value to pop, written by the consumer
+        alignas(64) std::atomic<size_t> tail;               // Next free slot, written by the producer
+};
@@ -0,0 +1,39 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+
+// Lock-free triple buffer for handing the latest value from one producer thread to one consumer thread
+// The producer always has a buffer to write into and the consumer always has a buffer to read from, so neither ever waits on the other
+// If the producer publishes faster than the consumer reads, older values are simply skipped
+template <typename T>
+class TripleBuffer {
+    public:
+        TripleBuffer() : write_index(0), middle(1), read_index(2) {}
+
+        // Producer side
+        T &writeBuffer() { return buffers[write_index]; }  // Buffer the producer fills in
+        void publish() {                                    // Makes the write buffer the newest value and takes the spare buffer to write into next
+            write_index = middle.exchange(write_index | FRESH, std::memory_order_acq_rel) & INDEX_MASK;
+        }
+
+        // Consumer side
+        bool update() {                                     // Takes the newest value if there is one, returns false if nothing new was published
+            if (!(middle.load(std::memory_order_relaxed) & FRESH))
+                return false;
+
+            read_index = middle.exchange(read_index, std::memory_order_acq_rel) & INDEX_MASK;
+            return true;
+        }
+        const T &readBuffer() const { return buffers[read_index]; }    // Newest value taken by update()
+
+    private:
+        static const uint8_t INDEX_MASK = 0x3;
+        static const uint8_t FRESH = 0x4;                   // Set in middle when it holds a value the consumer has not taken yet
+
+        T buffers[3];
+
+        uint8_t write_index;                                // Only touched by the producer
+        std::atomic<uint8_t> middle;                        // Index of the spare buffer, swapped between the two threads
+        uint8_t read_index;                                 // Only touched by the consumer
+};
@@ -0,0 +1,280 @@
+#include "VecEnv.hpp"
+#include <iostream>
+#include <cstdio>
+#include <cstring>
+#include <algorithm>
+
+const unsigned int ENV_CHUNK = 16;                          // Environments taken by a thread at a time, big enough that threads rarely contend on next_env
+
+
+VecEnv::VecEnv(unsigned int count, const EnvConfig &config, unsigned int threads) : prefixes(config.max_frames ? config.max_frames - 1 : DEFAULT_PREFIX_FRAMES) {
+    this->config = config;
+
+    envs.resize(count);
+    for (unsigned int i = 0; i < count; i++) {
+        envs[i].setPlatform(config.platform);
+        envs[i].setSpeed(config.ips);
+        envs[i].seed(config.seed + i);
+    }
+
+    // Every buffer is allocated here, once, so stepping never allocates
+    observation_buffer.assign((size_t)count * OBSERVATION_BYTES, 0);
+    reward_buffer.assign(count, 0.0f);
+    done_buffer.assign(count, 0);
+    scores.assign(count, 0);
+    frames.assign(count, 0);
+    keys.assign(count, 0);
+
+    pending_actions = NULL;
+    pending_mask = NULL;
+
+    round = 0;
+    stopping = false;
+    task = NULL;
+    next_env = 0;
+    busy = 0;
+
+    if (!threads)
+        threads = std::thread::hardware_concurrency();
+    for (unsigned int t = 1; t < threads; t++) {            // The thread calling step() is the first thread
+        workers.emplace_back(&VecEnv::worker, this);
+    }
+}
+
+
+VecEnv::~VecEnv() {
+    {
+        std::lock_guard<std::mutex> guard(lock);
+        stopping = true;
+    }
+    start.notify_all();
+
+    for (std::thread &t : workers)
+        t.join();
+}
+
+
+bool VecEnv::loadROM(const char *filename) {
+    FILE *fp = fopen(filename, "rb");
+    if (fp == NULL) {
+        std::cout << "ERROR: Could not open file" << std::endl << std::endl;
+        return false;
+    }
+
+    std::vector<uint8_t> data;
+    int c;
+    while ((c = fgetc(fp)) != EOF)
+        data.push_back(c);
+    fclose(fp);
+
+    return loadROM(data.data(), data.size());
+}
+
+
+// The ROM is loaded into a template once, so resets do not touch the file or rebuild memory again
+bool VecEnv::loadROM(const uint8_t *data, uint32_t size) {
+    if (config.skip_prefix) {
+        const ROMTemplate *prepared = prefixes.find(data, size, config.platform, Chip8::platformQuirks(config.platform), config.ips);
+        if (!prepared)
+            return false;
+        rom = *prepared;
+    } else if (!rom.load(data, size, config.platform)) {
+        return false;
+    }
+
+    reset(NULL);
+    return true;
+}
+
+
+void VecEnv::step(const uint16_t *actions) {
+    pending_actions = actions;
+    runAll(&VecEnv::stepEnv);
+    pending_actions = NULL;
+}
+
+
+void VecEnv::reset(const uint8_t *mask) {
+    pending_mask = mask;
+    runAll(&VecEnv::resetEnv);
+    pending_mask = NULL;
+}
+
+
+unsigned int VecEnv::size() {
+    return envs.size();
+}
+
+
+const uint8_t *VecEnv::observations() {
+    return observation_buffer.data();
+}
+
+
+const float *VecEnv::rewards() {
+    return reward_buffer.data();
+}
+
+
+const uint8_t *VecEnv::dones() {
+    return done_buffer.data();
+}
+
+
+Chip8 &VecEnv::env(unsigned int i) {
+    return envs[i];
+}
+
+
+unsigned long VecEnv::skippedFrames() {
+    return rom.prefixFrames();
+}
+
+
+uint64_t VecEnv::skippedInstructions() {
+    return rom.prefixInstructions();
+}
+
+
+
+
+// Applies the action, runs a frame and scores it
+// An environment that is done is left as it is until it is reset
+void VecEnv::stepEnv(unsigned int i) {
+    Chip8 &chip8 = envs[i];
+
+    if (done_buffer[i]) {
+        reward_buffer[i] = 0.0f;
+        return;
+    }
+
+    uint16_t action = pending_actions[i];
+    uint16_t changed = action ^ keys[i];
+    for (int key = 0; changed; key++, changed >>= 1) {
+        if (changed & 1)
+            chip8.setKey(key, (action >> key) & 1);
+    }
+    keys[i] = action;
+
+    chip8.emulateFrame();
+    frames[i]++;
+
+    uint32_t score = readScore(i);
+    reward_buffer[i] = (float)((int64_t)score - (int64_t)scores[i]);
+    scores[i] = score;
+
+    done_buffer[i] = chip8.isHalted()
+                  || (config.done_address >= 0 && chip8.readMemory(config.done_address) == config.done_value)
+                  || (config.max_frames && frames[i] >= config.max_frames);
+
+    if (chip8.drawFlag) {
+        observe(i);
+        chip8.drawFlag = false;
+    }
+}
+
+
+void VecEnv::resetEnv(unsigned int i) {
+    if (pending_mask && !pending_mask[i])
+        return;
+
+    // Only the first reset after loadROM() copies pages, after that each environment keeps its own and reset() refills them
+    Chip8 &chip8 = envs[i];
+    chip8.reset(rom);
+    chip8.unshareMemory();
+    for (int key = 0; key < KEY_COUNT; key++) {
+        chip8.setKey(key, false);
+    }
+
+    keys[i] = 0;
+    frames[i] = rom.prefixFrames();
+    scores[i] = readScore(i);
+    reward_buffer[i] = 0.0f;
+    done_buffer[i] = 0;
+
+    observe(i);
+    chip8.drawFlag = false;
+}
+
+
+// Copies plane 0 into the observation buffer, each packed row becomes 16 big-endian bytes
+void VecEnv::observe(unsigned int i) {
+    uint8_t *out = &observation_buffer[(size_t)i * OBSERVATION_BYTES];
+
+    for (unsigned int y = 0; y < VIDEO_HEIGHT; y++) {
+        VideoRow row = envs[i].video[0][y];
+        uint64_t high = __builtin_bswap64((uint64_t)(row >> 64));
+        uint64_t low = __builtin_bswap64((uint64_t)row);
+
+        memcpy(out + y * 16, &high, 8);
+        memcpy(out + y * 16 + 8, &low, 8);
+    }
+}
+
+
+uint32_t VecEnv::readScore(unsigned int i) {
+    if (config.score_address < 0)
+        return 0;
+
+    uint32_t score = 0;
+    for (unsigned int b = 0; b < config.score_bytes; b++) {
+        uint8_t value = envs[i].readMemory(config.score_address + b);
+        score = config.score_bcd ? score * 10 + value % 10 : (score << 8) | value;
+    }
+    return score;
+}
+
+
+
+
+void VecEnv::runAll(void (VecEnv::*task)(unsigned int)) {
+    this->task = task;
+    next_env = 0;
+    busy = workers.size();
+
+    {
+        std::lock_guard<std::mutex> guard(lock);
+        round++;
+    }
+    start.notify_all();
+
+    runTasks();
+
+    // The other threads finish within a chunk of this one, so waiting for them by spinning is cheaper than sleeping
+    while (busy.load(std::memory_order_acquire))
+        std::this_thread::yield();
+}
+
+
+void VecEnv::worker() {
+    uint64_t seen = 0;
+
+    while (true) {
+        {
+            std::unique_lock<std::mutex> guard(lock);
+            start.wait(guard, [&]() { return round != seen || stopping; });
+            if (stopping)
+                return;
+            seen = round;
+        }
+
+        runTasks();
+        busy.fetch_sub(1, std::memory_order_release);
+    }
+}
+
+
+void VecEnv::runTasks() {
+    unsigned int count = envs.size();
+
+    while (true) {
+        unsigned int first = next_env.fetch_add(ENV_CHUNK, std::memory_order_relaxed);
+        if (first >= count)
+            return;
+
+        unsigned int last = std::min(first + ENV_CHUNK, count);
+        for (unsigned int i = first; i < last; i++) {
+            (this->*task)(i);
+        }
+    }
+}
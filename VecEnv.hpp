@@ -0,0 +1,96 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include "Chip8.hpp"
+#include "PrefixCache.hpp"
+
+const unsigned int OBSERVATION_BYTES = VIDEO_WIDTH * VIDEO_HEIGHT / 8;     // One bit per pixel of plane 0, 16 bytes per row, leftmost pixel in the highest bit of the first byte
+                                                                           // Low resolution games only use the top-left 64x32 pixels
+
+
+// How every environment is run and scored
+struct EnvConfig {
+    Platform platform = PLATFORM_CHIP8;
+    unsigned int ips = 700;
+    uint32_t seed = 1;                                      // Environment i is seeded with seed + i
+
+    // The reward for a step is how much the score went up during it
+    int score_address = -1;                                 // Where the game keeps its score, -1 for no reward
+    unsigned int score_bytes = 1;                           // 1 - 4 bytes, big-endian
+    bool score_bcd = false;                                 // The score bytes are one decimal digit each (as written by Fx33) instead of binary
+
+    // An episode is done when the program halts, when the byte at done_address equals done_value, or after max_frames frames
+    int done_address = -1;                                  // -1 to not check memory
+    uint8_t done_value = 0;
+    unsigned long max_frames = 0;                           // 0 for no limit
+
+    // Start every episode after the frames the ROM runs the same whatever the input, e.g. its title screen (see ROMTemplate::skipPrefix())
+    // The skipped frames count towards max_frames, and the prefix always leaves at least one frame of the episode to step
+    bool skip_prefix = false;
+};
+
+
+// N Chip8 environments for reinforcement learning, stepped together one frame at a time
+// step() and reset() do not allocate once loadROM() has given every environment its own memory, and the work is spread over a fixed pool of threads
+// Observations, rewards and done flags are written to contiguous buffers that can be handed on without copying
+class VecEnv {
+    public:
+        VecEnv(unsigned int count, const EnvConfig &config, unsigned int threads = 0);     // threads = 0 uses every hardware thread
+        ~VecEnv();
+
+        bool loadROM(const char *filename);                 // Loads the ROM every environment runs, then resets them all
+        bool loadROM(const uint8_t *data, uint32_t size);
+
+        void step(const uint16_t *actions);                 // Runs one frame in every environment, actions[i] is the keypad of environment i (bit n = key n held)
+        void reset(const uint8_t *mask);                    // Restarts the environments with a non-zero mask entry, NULL restarts all of them
+
+        unsigned int size();
+        const uint8_t *observations();                      // size() * OBSERVATION_BYTES, environment i starts at i * OBSERVATION_BYTES
+        const float *rewards();                             // Reward of each environment for the last step
+        const uint8_t *dones();                             // 1 for each environment whose episode has ended -- it stays ended until it is reset
+
+        Chip8 &env(unsigned int i);                         // Direct access, e.g. for rendering one environment
+        unsigned long skippedFrames();                      // Frames every reset skips with EnvConfig::skip_prefix, 0 without it
+        uint64_t skippedInstructions();                     // Instructions those frames run, saved by every reset
+
+    private:
+        void stepEnv(unsigned int i);
+        void resetEnv(unsigned int i);
+        void observe(unsigned int i);
+        uint32_t readScore(unsigned int i);
+
+        void runAll(void (VecEnv::*task)(unsigned int));    // Runs task for every environment on the thread pool and waits for it to finish
+        void worker();
+        void runTasks();
+
+        EnvConfig config;
+        ROMTemplate rom;                                    // Every reset copies the machine prepared from the ROM
+        PrefixCache prefixes;                               // Templates past the prefix of each ROM loaded with skip_prefix, so loading one again does not run it again
+        std::vector<Chip8> envs;
+
+        std::vector<uint8_t> observation_buffer;
+        std::vector<float> reward_buffer;
+        std::vector<uint8_t> done_buffer;
+        std::vector<uint32_t> scores;                       // Score of each environment at the end of the last step
+        std::vector<unsigned long> frames;                  // Frames run since each environment was reset
+        std::vector<uint16_t> keys;                         // Keypad of each environment, so only keys that change are passed to setKey()
+
+        const uint16_t *pending_actions;                    // Set for the duration of step()
+        const uint8_t *pending_mask;                        // Set for the duration of reset()
+
+        // Thread pool
+        // Each round, every thread (including the caller) takes chunks of environments from next_env until there are none left
+        std::vector<std::thread> workers;
+        std::mutex lock;
+        std::condition_variable start;
+        uint64_t round;                                     // Bumped to start a round, protected by lock
+        bool stopping;
+        void (VecEnv::*task)(unsigned int);
+        std::atomic<unsigned int> next_env;
+        std::atomic<unsigned int> busy;                     // Threads still working on this round
+};
@@ -0,0 +1,88 @@
+#include <cstdio>
+#include <cstdint>
+#include <chrono>
+#include <vector>
+#include "Chip8.hpp"
+#include "Chip8.cpp"
+
+// Micro-benchmarks for the interpreter core
+// Build: g++ -O2 bench.cpp -o bench
+// Usage: ./bench [ITERATIONS]
+
+// A benchmark runs a small loop that executes the measured instruction once per pass
+// The same loop with the measured instruction replaced by 8000 (LD V0, V0) is timed as well, and subtracted, so only the cost of the instruction itself is reported
+struct OpBenchmark {
+    const char *name;
+    Platform platform;
+    bool hires;                                             // Switch to high resolution (00FF) before the loop
+    uint16_t opcode;                                        // Instruction being measured
+};
+
+const OpBenchmark OP_BENCHMARKS[] = {
+    {"Dxyn 8x15 sprite, low resolution", PLATFORM_CHIP8, false, 0xD01F},
+    {"Dxyn 8x15 sprite, high resolution", PLATFORM_SCHIP, true, 0xD01F},
+    {"Dxy0 16x16 sprite, high resolution", PLATFORM_SCHIP, true, 0xD010},
+    {"00Cn scroll down 4, low resolution", PLATFORM_SCHIP, false, 0x00C4},
+    {"00Cn scroll down 4, high resolution", PLATFORM_SCHIP, true, 0x00C4},
+    {"00FB scroll right, high resolution", PLATFORM_SCHIP, true, 0x00FB},
+    {"00FC scroll left, high resolution", PLATFORM_SCHIP, true, 0x00FC},
+    {"00E0 clear screen", PLATFORM_CHIP8, false, 0x00E0},
+};
+
+
+// Builds the benchmark loop:
+//   200: 00FF or 8000      high resolution (or filler)
+//   202: A300              I = sprite data
+//   204: <opcode>          the instruction being measured
+//   206: 7003              move the sprite around so it does not always land in the same place
+//   208: 7105
+//   20A: 1204              loop
+//   300: 32 bytes of sprite data
+std::vector<uint8_t> buildLoop(bool hires, uint16_t opcode) {
+    std::vector<uint8_t> rom(0x120, 0);
+    uint16_t program[] = {(uint16_t)(hires ? 0x00FF : 0x8000), 0xA300, opcode, 0x7003, 0x7105, 0x1204};
+
+    for (int i = 0; i < 6; i++) {
+        rom[2 * i] = program[i] >> 8;
+        rom[2 * i + 1] = program[i] & 0xFF;
+    }
+    for (int i = 0; i < 32; i++) {
+        rom[0x100 + i] = 0x5A ^ (i * 0x11);
+    }
+    return rom;
+}
+
+
+// Runs the loop for the given number of passes and returns the time taken in nanoseconds
+double timeLoop(Chip8 &chip8, const std::vector<uint8_t> &rom, uint64_t passes) {
+    chip8.loadROM(rom.data(), rom.size());
+    chip8.emulateCycle();                                   // 00FF
+    chip8.emulateCycle();                                   // A300
+
+    auto start = std::chrono::steady_clock::now();
+    for (uint64_t i = 0; i < passes * 4; i++) {
+        chip8.emulateCycle();
+    }
+    auto end = std::chrono::steady_clock::now();
+
+    return std::chrono::duration<double, std::nano>(end - start).count();
+}
+
+
+int main(int argc, char **argv) {
+    uint64_t passes = argc > 1 ? std::stoull(argv[1]) : 2000000;
+    Chip8 chip8;
+    chip8.seed(1);
+
+    printf("%-40s %10s\n", "Instruction", "ns/op");
+    for (const OpBenchmark &bench : OP_BENCHMARKS) {
+        chip8.setPlatform(bench.platform);
+
+        double measured = timeLoop(chip8, buildLoop(bench.hires, bench.opcode), passes);
+        double baseline = timeLoop(chip8, buildLoop(bench.hires, 0x8000), passes);
+
+        printf("%-40s %10.2f\n", bench.name, (measured - baseline) / passes);
+    }
+
+    return 0;
+}
@@ -0,0 +1,412 @@
+#include <cstdio>
+#include <cstdint>
+#include <cstring>
+#include <chrono>
+#include <string>
+#include <vector>
+#include <thread>
+#include <atomic>
+#include <algorithm>
+#include "Chip8.hpp"
+#include "Chip8.cpp"
+#include "Disassembler.hpp"
+#include "Disassembler.cpp"
+#include "Sha1.hpp"
+#include "Sha1.cpp"
+#include "ROMLibrary.hpp"
+#include "ROMLibrary.cpp"
+#include "ROMDatabase.hpp"
+#include "ROMDatabase.cpp"
+
+// Guesses the platform each ROM was written for and the quirks it depends on
+// Build: g++ -O2 -std=c++17 -pthread classify.cpp -o classify
+// Usage: ./classify <ROM, DIRECTORY or ARCHIVE>... [--frames N] [--ips N] [--threads N] [--romdb OUT.txt]
+//
+// Each ROM is disassembled (see findCode()) and run headless for a few seconds with generated key events, and the instructions found and run are counted by the first platform that has them
+// The platform guessed is the newest one any of those instructions needs, or XO-CHIP for a ROM too large for 4KB of memory
+//
+// Instructions whose result depends on a quirk are flagged where the code around them shows it matters:
+//   shift     8xy6 or 8xyE with x != y, so shifting Vx or Vy gives different results (shift_vy)
+//   memory    Fx55 or Fx65 followed by an instruction that reads I before I is set again (memory_increment)
+//   jump      Bxnn with x != 0, so adding V0 or Vx jumps to different places (jump_vx)
+//   logic     8xy1, 8xy2 or 8xy3 followed by an instruction that reads VF before it is written again (vf_reset)
+//   big       Dxy0, a 16x16 sprite on SUPER-CHIP and later but nothing on CHIP-8
+// Then the run is repeated with each quirk flipped in turn, and a quirk the display, registers or memory depend on during the run is listed as sensitive
+// The guess uses the quirks of the guessed platform, the sensitive ones are the ones worth checking by hand
+//
+// --romdb writes the guesses as ROM database source lines (see romdb/romdb.txt), to be checked and merged into the database
+
+const unsigned long DEFAULT_FRAMES = 300;                   // Five emulated seconds, enough to get past most title screens
+const unsigned int DEFAULT_IPS = 700;
+const unsigned int INPUT_INTERVAL = 6;                      // Frames between generated key events
+const unsigned int LOOKAHEAD = 16;                          // Instructions followed after a quirk-sensitive instruction
+
+
+enum Pattern {
+    PATTERN_SHIFT,
+    PATTERN_MEMORY,
+    PATTERN_JUMP,
+    PATTERN_LOGIC,
+    PATTERN_BIG_SPRITE,
+    PATTERN_COUNT
+};
+
+const char *const PATTERN_NAMES[PATTERN_COUNT] = {"shift", "memory", "jump", "logic", "big"};
+
+
+struct Options {
+    unsigned long frames = DEFAULT_FRAMES;
+    unsigned int ips = DEFAULT_IPS;
+};
+
+
+struct Classification {
+    bool loaded = false;
+    unsigned int found = 0;                                 // Instructions the disassembler found
+    unsigned int run = 0;                                   // Addresses an instruction was run from
+    unsigned int found_by_platform[PLATFORM_XOCHIP + 1] = {};   // Found instructions by the first platform that has them
+    unsigned int run_by_platform[PLATFORM_XOCHIP + 1] = {};
+    unsigned int patterns[PATTERN_COUNT] = {};
+    bool too_large = false;                                 // Only fits in XO-CHIP memory
+    Platform platform = PLATFORM_CHIP8;
+    uint8_t sensitive = 0;                                  // QUIRK_ bits of the quirks the run depends on
+};
+
+
+// Registers an instruction reads, without decoding it for a particular platform
+bool readsVF(uint16_t op) {
+    unsigned int x = (op & 0x0F00) >> 8;
+    unsigned int y = (op & 0x00F0) >> 4;
+    unsigned int n = op & 0x000F;
+    unsigned int kk = op & 0x00FF;
+
+    switch (op >> 12) {
+        case 0x3 : case 0x4 : case 0x7 : case 0xE :
+            return x == 0xF;
+        case 0x5 :
+            return n == 0x2 ? std::max(x, y) == 0xF : (x == 0xF || y == 0xF);
+        case 0x8 :
+            return n == 0x0 ? y == 0xF : (x == 0xF || y == 0xF);
+        case 0x9 : case 0xD :
+            return x == 0xF || y == 0xF;
+        case 0xF :
+            return x == 0xF && kk != 0x07 && kk != 0x0A && kk != 0x65 && kk != 0x85;
+        default :
+            return false;
+    }
+}
+
+
+bool writesVF(uint16_t op) {
+    unsigned int x = (op & 0x0F00) >> 8;
+    unsigned int n = op & 0x000F;
+    unsigned int kk = op & 0x00FF;
+
+    switch (op >> 12) {
+        case 0x6 : case 0xC :
+            return x == 0xF;
+        case 0x8 :
+            return n >= 0x4 || x == 0xF;                    // 8xy4 - 8xyE set VF as a flag
+        case 0xD :
+            return true;
+        case 0xF :
+            return x == 0xF && (kk == 0x07 || kk == 0x0A || kk == 0x65 || kk == 0x85);
+        default :
+            return false;
+    }
+}
+
+
+bool readsI(uint16_t op) {
+    unsigned int n = op & 0x000F;
+    unsigned int kk = op & 0x00FF;
+
+    switch (op >> 12) {
+        case 0x5 : return n == 0x2 || n == 0x3;
+        case 0xD : return true;
+        case 0xF : return kk == 0x1E || kk == 0x33 || kk == 0x55 || kk == 0x65 || kk == 0x02;
+        default : return false;
+    }
+}
+
+
+bool setsI(uint16_t op) {
+    unsigned int kk = op & 0x00FF;
+    return (op >> 12) == 0xA || op == 0xF000 || ((op >> 12) == 0xF && (kk == 0x29 || kk == 0x30));
+}
+
+
+// Straight-line code stops at jumps, calls and returns, a skip may still fall through so it does not stop it
+bool endsStraightLine(uint16_t op) {
+    unsigned int family = op >> 12;
+    return family == 0x1 || family == 0x2 || family == 0xB || op == 0x00EE || op == 0x00FD;
+}
+
+
+// Follows the code after the instruction at offset, until an instruction answers found or stop, or the straight line ends
+template <typename Found, typename Stop>
+bool followedBy(const uint8_t *rom, uint32_t size, const std::vector<bool> &code, uint32_t offset, Found found, Stop stop) {
+    auto word = [&](uint32_t at) -> uint16_t {
+        return at + 1 < size ? (rom[at] << 8) | rom[at + 1] : 0;
+    };
+
+    offset += instructionLength(word(offset), PLATFORM_XOCHIP);
+    for (unsigned int i = 0; i < LOOKAHEAD && offset < size && code[offset]; i++) {
+        uint16_t op = word(offset);
+        if (found(op))
+            return true;
+        if (stop(op) || endsStraightLine(op))
+            return false;
+        offset += instructionLength(op, PLATFORM_XOCHIP);
+    }
+    return false;
+}
+
+
+// Decoded as XO-CHIP, which has every instruction of the other platforms
+void classifyStatic(const ROMEntry &rom, Classification &result) {
+    std::vector<bool> code = findCode(rom.data, rom.size, PLATFORM_XOCHIP);
+
+    for (uint32_t offset = 0; offset + 1 < rom.size; offset++) {
+        if (!code[offset])
+            continue;
+
+        uint16_t op = (rom.data[offset] << 8) | rom.data[offset + 1];
+        unsigned int x = (op & 0x0F00) >> 8;
+        unsigned int y = (op & 0x00F0) >> 4;
+        unsigned int n = op & 0x000F;
+        unsigned int kk = op & 0x00FF;
+
+        result.found++;
+        int platform = firstPlatformWith(op);
+        if (platform >= 0)
+            result.found_by_platform[platform]++;
+
+        switch (op >> 12) {
+            case 0x8 :
+                if ((n == 0x6 || n == 0xE) && x != y)
+                    result.patterns[PATTERN_SHIFT]++;
+                if ((n == 0x1 || n == 0x2 || n == 0x3) && followedBy(rom.data, rom.size, code, offset, readsVF, writesVF))
+                    result.patterns[PATTERN_LOGIC]++;
+                break;
+            case 0xB :
+                if (x != 0)
+                    result.patterns[PATTERN_JUMP]++;
+                break;
+            case 0xD :
+                if (n == 0)
+                    result.patterns[PATTERN_BIG_SPRITE]++;
+                break;
+            case 0xF :
+                if ((kk == 0x55 || kk == 0x65) && followedBy(rom.data, rom.size, code, offset, readsI, setsI))
+                    result.patterns[PATTERN_MEMORY]++;
+                break;
+            default :
+                break;
+        }
+    }
+}
+
+
+// Runs the ROM from the template with the same generated key events every time, recording the state hash after every frame
+void runROM(Chip8 &chip8, const ROMTemplate &rom, const Quirks &quirks, const Options &options, std::vector<uint64_t> &hashes) {
+    chip8.reset(rom);
+    chip8.setQuirks(quirks);
+    hashes.clear();
+
+    uint32_t input = 1;
+    for (unsigned long frame = 0; frame < options.frames && !chip8.isHalted(); frame++) {
+        if (frame % INPUT_INTERVAL == 0) {
+            input ^= input << 13;
+            input ^= input >> 17;
+            input ^= input << 5;
+            chip8.setKey(input & 0xF, (input >> 4) & 1);
+        }
+        chip8.emulateFrame();
+        hashes.push_back(chip8.stateHash());
+    }
+}
+
+
+void classifyROM(const ROMEntry &rom, const Options &options, Classification &result) {
+    classifyStatic(rom, result);
+
+    result.too_large = rom.size > MEMORY_SIZE - PROGRAM_START_ADDRES;
+    result.platform = PLATFORM_CHIP8;
+    for (int p = PLATFORM_XOCHIP; p > PLATFORM_CHIP8; p--) {
+        if (result.found_by_platform[p]) {
+            result.platform = (Platform)p;
+            break;
+        }
+    }
+    if (result.too_large)
+        result.platform = PLATFORM_XOCHIP;
+
+    ROMTemplate image;
+    if (!image.load(rom.data, rom.size, result.platform))
+        return;
+    result.loaded = true;
+
+    // The run shows what code the ROM really goes through, including code it jumps to through Bnnn or writes itself
+    Chip8 chip8;
+    chip8.seed(1);
+    chip8.setSpeed(options.ips);
+    chip8.setCoverage(true);
+    Quirks quirks = Chip8::platformQuirks(result.platform);
+    std::vector<uint64_t> baseline, flipped;
+    runROM(chip8, image, quirks, options, baseline);
+
+    Platform needed = result.platform;
+    for (uint32_t address = 0; address < chip8.memorySize(); address++) {
+        if (!chip8.isCovered(address))
+            continue;
+
+        result.run++;
+        int platform = firstPlatformWith((chip8.readMemory(address) << 8) | chip8.readMemory(address + 1));
+        if (platform >= 0) {
+            result.run_by_platform[platform]++;
+            needed = std::max(needed, (Platform)platform);
+        }
+    }
+    chip8.setCoverage(false);
+
+    // Run into instructions the guessed platform does not have, try again on the platform that does
+    if (needed != result.platform) {
+        result.platform = needed;
+        image.load(rom.data, rom.size, result.platform);
+        quirks = Chip8::platformQuirks(result.platform);
+        runROM(chip8, image, quirks, options, baseline);
+    }
+
+    for (unsigned int q = 0; q < QUIRK_COUNT; q++) {
+        Quirks changed = quirks;
+        changed.*QUIRK_FIELDS[q] = !(quirks.*QUIRK_FIELDS[q]);
+        runROM(chip8, image, changed, options, flipped);
+        if (flipped != baseline)
+            result.sensitive |= 1 << q;
+    }
+}
+
+
+std::string listPatterns(const Classification &result) {
+    std::string list;
+    for (unsigned int p = 0; p < PATTERN_COUNT; p++) {
+        if (result.patterns[p])
+            list += (list.empty() ? "" : ",") + std::string(PATTERN_NAMES[p]);
+    }
+    return list.empty() ? "-" : list;
+}
+
+
+std::string listSensitive(uint8_t sensitive) {
+    std::string list;
+    for (unsigned int q = 0; q < QUIRK_COUNT; q++) {
+        if (sensitive & (1 << q))
+            list += (list.empty() ? "" : ",") + std::string(QUIRK_NAMES[q]);
+    }
+    return list.empty() ? "-" : list;
+}
+
+
+int main(int argc, char **argv) {
+    Options options;
+    ROMLibrary library;
+    unsigned int threads = std::max(1u, std::thread::hardware_concurrency());
+    const char *databaseFile = NULL;
+
+    for (int i = 1; i < argc; i++) {
+        if (!strcmp(argv[i], "--frames") && i + 1 < argc) {
+            options.frames = std::stoul(argv[++i]);
+        } else if (!strcmp(argv[i], "--ips") && i + 1 < argc) {
+            options.ips = std::stoul(argv[++i]);
+        } else if (!strcmp(argv[i], "--threads") && i + 1 < argc) {
+            threads = std::max(1ul, std::stoul(argv[++i]));
+        } else if (!strcmp(argv[i], "--romdb") && i + 1 < argc) {
+            databaseFile = argv[++i];
+        } else if (!library.open(argv[i])) {
+            return 1;
+        }
+    }
+
+    if (!library.size()) {
+        printf("ERROR: PROPER USAGE IS: ./classify <ROM, DIRECTORY or ARCHIVE>... [--frames N] [--ips N] [--threads N] [--romdb OUT.txt]\n");
+        return 1;
+    }
+
+    // Each thread takes the next ROM until there are none left
+    auto start = std::chrono::steady_clock::now();
+    std::vector<Classification> results(library.size());
+    std::atomic<size_t> next(0);
+    std::vector<std::thread> workers;
+    for (unsigned int t = 0; t < std::min<size_t>(threads, library.size()); t++) {
+        workers.emplace_back([&]() {
+            for (size_t i = next++; i < library.size(); i = next++) {
+                classifyROM(library.entry(i), options, results[i]);
+            }
+        });
+    }
+    for (std::thread &worker : workers)
+        worker.join();
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    // The library is in hash order, the report is in name order
+    std::vector<size_t> order(library.size());
+    for (size_t i = 0; i < order.size(); i++)
+        order[i] = i;
+    std::sort(order.begin(), order.end(), [&](size_t a, size_t b) {
+        return library.entry(a).name < library.entry(b).name;
+    });
+
+    FILE *database = NULL;
+    if (databaseFile) {
+        database = fopen(databaseFile, "w");
+        if (database == NULL) {
+            printf("ERROR: Could not open file %s\n", databaseFile);
+            return 1;
+        }
+        fprintf(database, "# Guessed by classify, check before merging into romdb/romdb.txt\n");
+    }
+
+    printf("%-40s %-7s %7s %7s %13s %13s  %-24s %s\n", "ROM", "guess", "found", "run", "SCHIP found/run", "XO found/run", "patterns", "sensitive quirks");
+    unsigned int platforms[PLATFORM_XOCHIP + 1] = {};
+    unsigned int quirkCounts[QUIRK_COUNT] = {};
+    for (size_t i : order) {
+        const ROMEntry &rom = library.entry(i);
+        const Classification &result = results[i];
+        if (!result.loaded) {
+            printf("%-40s could not be loaded\n", rom.name.c_str());
+            continue;
+        }
+
+        printf("%-40s %-7s %7u %7u %6u/%-6u %6u/%-6u  %-24s %s%s\n", rom.name.c_str(), Chip8::platformName(result.platform), result.found, result.run,
+               result.found_by_platform[PLATFORM_SCHIP], result.run_by_platform[PLATFORM_SCHIP],
+               result.found_by_platform[PLATFORM_XOCHIP], result.run_by_platform[PLATFORM_XOCHIP],
+               listPatterns(result).c_str(), listSensitive(result.sensitive).c_str(), result.too_large ? " (larger than 4KB)" : "");
+
+        platforms[result.platform]++;
+        for (unsigned int q = 0; q < QUIRK_COUNT; q++)
+            quirkCounts[q] += (result.sensitive >> q) & 1;
+
+        // A ROM that is in the library more than once only gets one line, the database rejects a hash listed twice
+        bool repeated = i > 0 && !memcmp(library.entry(i - 1).sha1, rom.sha1, SHA1_SIZE);
+        if (database && !repeated) {
+            fprintf(database, "%s platform=%s title=%s", sha1Hex(rom.sha1).c_str(), Chip8::platformName(result.platform), rom.name.c_str());
+            if (result.sensitive)
+                fprintf(database, "  # check quirks: %s", listSensitive(result.sensitive).c_str());
+            fprintf(database, "\n");
+        }
+    }
+
+    if (database && fclose(database) != 0) {
+        printf("ERROR: Could not write file %s\n", databaseFile);
+        return 1;
+    }
+
+    printf("\n%zu ROMs in %.2f s on %u threads: %u CHIP-8, %u SUPER-CHIP, %u XO-CHIP\n", library.size(), seconds, threads,
+           platforms[PLATFORM_CHIP8], platforms[PLATFORM_SCHIP], platforms[PLATFORM_XOCHIP]);
+    printf("Sensitive to:");
+    for (unsigned int q = 0; q < QUIRK_COUNT; q++)
+        printf(" %s %u", QUIRK_NAMES[q], quirkCounts[q]);
+    printf("\n");
+    return 0;
+}
@@ -0,0 +1,143 @@
+#include <cstdio>
+#include <cstdint>
+#include <cstring>
+#include <chrono>
+#include <vector>
+#include <unistd.h>
+#include "Chip8.hpp"
+#include "Chip8.cpp"
+
+// Benchmark for cloning machines, as a tree search or speculative executor would, and for restarting them from a ROMTemplate
+// Build: g++ -O2 clonebench.cpp -o clonebench
+// Usage: ./clonebench <ROM> [CLONES] [--platform chip8|schip|xochip]
+//
+// The ROM is run for a few seconds of emulated time first so the clones start from a machine that has done something
+// Memory per live clone is measured from the resident set size, after every clone has run a frame of its own with its own input
+
+const unsigned int WARMUP_FRAMES = 300;
+const unsigned int CLONE_ROUNDS = 20;                       // Times the whole pool is cloned into for the timings
+
+
+double secondsSince(std::chrono::steady_clock::time_point start) {
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+
+// Resident set size in bytes, 0 where /proc is not available
+long residentBytes() {
+    FILE *fp = fopen("/proc/self/statm", "r");
+    if (fp == NULL)
+        return 0;
+
+    long size = 0, resident = 0;
+    if (fscanf(fp, "%ld %ld", &size, &resident) != 2)
+        resident = 0;
+    fclose(fp);
+    return resident * sysconf(_SC_PAGESIZE);
+}
+
+
+int main(int argc, char **argv) {
+    if (argc < 2) {
+        printf("ERROR: PROPER USAGE IS: ./clonebench <ROM> [CLONES] [--platform chip8|schip|xochip]\n");
+        return 1;
+    }
+
+    unsigned int count = 10000;
+    Platform platform = PLATFORM_CHIP8;
+    for (int i = 2; i < argc; i++) {
+        if (!strcmp(argv[i], "--platform") && i + 1 < argc) {
+            if (!Chip8::parsePlatform(argv[++i], platform)) {
+                printf("ERROR: Unknown platform %s\n", argv[i]);
+                return 1;
+            }
+        } else {
+            count = std::stoul(argv[i]);
+        }
+    }
+
+    Chip8 root;
+    root.setPlatform(platform);
+    root.seed(1);
+    if (!root.loadROM(argv[1]))
+        return 1;
+    for (unsigned int f = 0; f < WARMUP_FRAMES; f++) {
+        root.emulateFrame();
+    }
+
+
+    // Fresh copies, each allocated and freed
+    auto start = std::chrono::steady_clock::now();
+    for (unsigned int i = 0; i < count * CLONE_ROUNDS; i++) {
+        Chip8 copy = root.clone();
+        asm volatile("" : : "r"(&copy) : "memory");         // Keep the copy from being optimised away
+    }
+    double cloneRate = count * CLONE_ROUNDS / secondsSince(start);
+
+    // Copies into a pool of machines that already exist
+    std::vector<Chip8> pool(count);
+    for (Chip8 &chip8 : pool) {
+        chip8.setPlatform(platform);
+    }
+    start = std::chrono::steady_clock::now();
+    for (unsigned int round = 0; round < CLONE_ROUNDS; round++) {
+        for (Chip8 &chip8 : pool) {
+            root.cloneInto(chip8);
+        }
+    }
+    double cloneIntoRate = count * CLONE_ROUNDS / secondsSince(start);
+
+    // Restarting the ROM, from the file and from a template
+    ROMTemplate rom;
+    if (!rom.load(argv[1], platform))
+        return 1;
+    start = std::chrono::steady_clock::now();
+    for (unsigned int i = 0; i < count; i++) {
+        pool[i].loadROM(argv[1]);
+    }
+    double loadRate = count / secondsSince(start);
+    start = std::chrono::steady_clock::now();
+    for (unsigned int round = 0; round < CLONE_ROUNDS; round++) {
+        for (Chip8 &chip8 : pool) {
+            chip8.reset(rom);
+        }
+    }
+    double resetRate = count * CLONE_ROUNDS / secondsSince(start);
+
+    // A search step: branch off a copy, give it its own input and run a frame
+    start = std::chrono::steady_clock::now();
+    for (unsigned int round = 0; round < CLONE_ROUNDS; round++) {
+        for (unsigned int i = 0; i < count; i++) {
+            root.cloneInto(pool[i]);
+            pool[i].setKey(i % KEY_COUNT, true);
+            pool[i].emulateFrame();
+        }
+    }
+    double branchRate = count * CLONE_ROUNDS / secondsSince(start);
+    pool.clear();
+    pool.shrink_to_fit();
+
+
+    // Memory per live clone, each one having run a frame so it has made whatever pages it writes its own
+    long before = residentBytes();
+    std::vector<Chip8> live;
+    live.reserve(count);
+    for (unsigned int i = 0; i < count; i++) {
+        live.push_back(root.clone());
+        live.back().setKey(i % KEY_COUNT, true);
+        live.back().emulateFrame();
+    }
+    long after = residentBytes();
+
+    printf("%u clones of %s after %u frames\n", count, argv[1], WARMUP_FRAMES);
+    printf("clone():      %12.0f clones/sec\n", cloneRate);
+    printf("cloneInto():  %12.0f clones/sec\n", cloneIntoRate);
+    printf("clone + frame:%12.0f branches/sec\n", branchRate);
+    printf("loadROM():    %12.0f resets/sec\n", loadRate);
+    printf("reset():      %12.0f resets/sec\n", resetRate);
+    if (before && after) {
+        printf("memory:       %12.0f bytes per live clone (a full copy would be %zu bytes)\n",
+               (double)(after - before) / count, sizeof(Chip8) + root.memorySize());
+    }
+    return 0;
+}
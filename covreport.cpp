@@ -0,0 +1,150 @@
+#include <cstdio>
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <vector>
+#include <fstream>
+#include <filesystem>
+#include "Chip8.hpp"
+#include "Chip8.cpp"
+#include "Disassembler.hpp"
+#include "Disassembler.cpp"
+#include "Coverage.hpp"
+#include "Coverage.cpp"
+
+// Lays the coverage recorded with Chip8 --coverage over a disassembly of the ROM
+// Build: g++ -O2 -std=c++17 covreport.cpp -o covreport
+// Usage: ./covreport <ROM> <INFO>... [--platform chip8|schip|xochip] [--merge OUT.info]
+//
+// Every tracefile given is added up, so the hit count of an instruction is how many runs ran it, and ##### marks code no run got to
+// Bytes that are neither found by the disassembler nor run are listed as data
+// --merge writes everything that was read, for every ROM, to one tracefile -- batch runs can be merged without a ROM by giving it as "-"
+// Without --platform, the platform is picked from the file extension: .sc8 is SUPER-CHIP, .xo8 is XO-CHIP and anything else is CHIP-8
+
+
+// Runs record the ROM path they were given, so a record for the same file under another path is matched by name
+const CoverageRecord *findRecord(const std::vector<CoverageRecord> &records, const std::string &rom) {
+    for (const CoverageRecord &record : records) {
+        if (record.rom == rom)
+            return &record;
+    }
+    std::string name = std::filesystem::path(rom).filename().string();
+    for (const CoverageRecord &record : records) {
+        if (std::filesystem::path(record.rom).filename().string() == name)
+            return &record;
+    }
+    return NULL;
+}
+
+
+void printReport(const std::string &rom, const std::vector<uint8_t> &data, Platform platform, const CoverageRecord *record, unsigned int runs) {
+    const uint32_t START = 0x200;
+    std::vector<bool> code = findCode(data.data(), data.size(), platform);
+    std::map<uint32_t, uint64_t> hits;
+    if (record)
+        hits = record->hits;
+
+    auto byte = [&](uint32_t address) -> uint8_t {
+        return address - START < data.size() ? data[address - START] : 0;
+    };
+    auto isCode = [&](uint32_t address) {
+        return (address - START < code.size() && code[address - START]) || hits.count(address);
+    };
+
+    unsigned int instructions = 0, run = 0;
+    uint32_t end = START + data.size();
+    uint32_t address = START;
+    while (address < end) {
+        if (!isCode(address)) {
+            uint32_t first = address;
+            while (address < end && !isCode(address))
+                address++;
+            printf("%8s  0x%03X  %u bytes of data\n", "", first, address - first);
+            continue;
+        }
+
+        uint16_t opcode = (byte(address) << 8) | byte(address + 1);
+        uint16_t next = (byte(address + 2) << 8) | byte(address + 3);
+        auto hit = hits.find(address);
+        uint64_t count = hit == hits.end() ? 0 : hit->second;
+        instructions++;
+        run += count > 0;
+
+        if (count)
+            printf("%8llu  0x%03X  %04X  %s\n", (unsigned long long)count, address, opcode, disassemble(opcode, next, platform).c_str());
+        else
+            printf("%8s  0x%03X  %04X  %s\n", "#####", address, opcode, disassemble(opcode, next, platform).c_str());
+
+        // Code that jumps into the middle of an instruction overlaps it, both are listed
+        unsigned int length = instructionLength(opcode, platform);
+        address++;
+        for (unsigned int i = 1; i < length && !isCode(address); i++)
+            address++;
+    }
+
+    // Code run from outside the ROM, like the font area or memory the program wrote code to
+    for (const auto &hit : hits) {
+        if (hit.first < START || hit.first >= end) {
+            printf("%8llu  0x%03X  outside the ROM\n", (unsigned long long)hit.second, hit.first);
+            instructions++;
+            run += hit.second > 0;
+        }
+    }
+
+    printf("\n%s: %u of %u instructions run (%.1f%%) over %u tracefile(s)\n", rom.c_str(), run, instructions,
+           instructions ? 100.0 * run / instructions : 0.0, runs);
+}
+
+
+int main(int argc, char **argv) {
+    std::vector<std::string> infos;
+    const char *mergeFile = NULL;
+    int platform = -1;
+
+    for (int i = 2; i < argc; i++) {
+        if (!strcmp(argv[i], "--merge") && i + 1 < argc) {
+            mergeFile = argv[++i];
+        } else if (!strcmp(argv[i], "--platform") && i + 1 < argc) {
+            Platform parsed;
+            if (!Chip8::parsePlatform(argv[++i], parsed)) {
+                printf("ERROR: Unknown platform %s\n", argv[i]);
+                return 1;
+            }
+            platform = parsed;
+        } else {
+            infos.push_back(argv[i]);
+        }
+    }
+
+    if (argc < 3 || infos.empty()) {
+        printf("ERROR: PROPER USAGE IS: ./covreport <ROM> <INFO>... [--platform chip8|schip|xochip] [--merge OUT.info]\n");
+        return 1;
+    }
+
+    std::vector<CoverageRecord> records;
+    for (const std::string &info : infos) {
+        if (!readCoverage(info.c_str(), records))
+            return 1;
+    }
+
+    if (mergeFile && !writeCoverage(mergeFile, records))
+        return 1;
+
+    std::string rom = argv[1];
+    if (rom == "-")
+        return 0;
+
+    std::ifstream file(rom, std::ios::binary);
+    if (!file) {
+        printf("ERROR: Could not open file %s\n", rom.c_str());
+        return 1;
+    }
+    std::vector<uint8_t> data((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+
+    const CoverageRecord *record = findRecord(records, rom);
+    if (!record)
+        printf("No coverage recorded for %s, every instruction is shown as not run\n\n", rom.c_str());
+
+    printReport(rom, data, platform >= 0 ? (Platform)platform : Chip8::platformFor(rom), record, infos.size());
+    return 0;
+}
@@ -12,8 +12,8 @@ void drawGraphics(SDL_Renderer *renderer);
 Chip8 chip8;
 
 const int PIXEL_SCALE = 10;
-const int SCREEN_WIDTH = VIDEO_WIDTH * PIXEL_SCALE;
-const int SCREEN_HEIGHT = VIDEO_HEIGHT * PIXEL_SCALE;
+const int SCREEN_WIDTH = LORES_WIDTH * PIXEL_SCALE;
+const int SCREEN_HEIGHT = LORES_HEIGHT * PIXEL_SCALE;
 const int TIMER_SPEED = 60;
 
 
@@ -118,28 +118,28 @@ int main (int argc, char **argv) {
 void setKeys(const Uint8 *keystate) {
     keystate = SDL_GetKeyboardState(NULL);
 
-    chip8.keypad[0x0] = keystate[SDL_SCANCODE_0];
-    chip8.keypad[0x1] = keystate[SDL_SCANCODE_1];
-    chip8.keypad[0x2] = keystate[SDL_SCANCODE_2];
-    chip8.keypad[0x3] = keystate[SDL_SCANCODE_3];
-    chip8.keypad[0x4] = keystate[SDL_SCANCODE_4];
-    chip8.keypad[0x5] = keystate[SDL_SCANCODE_5];
-    chip8.keypad[0x6] = keystate[SDL_SCANCODE_6];
-    chip8.keypad[0x7] = keystate[SDL_SCANCODE_7];
-    chip8.keypad[0x8] = keystate[SDL_SCANCODE_8];
-    chip8.keypad[0x9] = keystate[SDL_SCANCODE_9];
-    chip8.keypad[0xA] = keystate[SDL_SCANCODE_A];
-    chip8.keypad[0xB] = keystate[SDL_SCANCODE_B];
-    chip8.keypad[0xC] = keystate[SDL_SCANCODE_C];
-    chip8.keypad[0xD] = keystate[SDL_SCANCODE_D];
-    chip8.keypad[0xE] = keystate[SDL_SCANCODE_E];
-    chip8.keypad[0xF] = keystate[SDL_SCANCODE_F];
+    chip8.setKey(0x0, keystate[SDL_SCANCODE_0]);
+    chip8.setKey(0x1, keystate[SDL_SCANCODE_1]);
+    chip8.setKey(0x2, keystate[SDL_SCANCODE_2]);
+    chip8.setKey(0x3, keystate[SDL_SCANCODE_3]);
+    chip8.setKey(0x4, keystate[SDL_SCANCODE_4]);
+    chip8.setKey(0x5, keystate[SDL_SCANCODE_5]);
+    chip8.setKey(0x6, keystate[SDL_SCANCODE_6]);
+    chip8.setKey(0x7, keystate[SDL_SCANCODE_7]);
+    chip8.setKey(0x8, keystate[SDL_SCANCODE_8]);
+    chip8.setKey(0x9, keystate[SDL_SCANCODE_9]);
+    chip8.setKey(0xA, keystate[SDL_SCANCODE_A]);
+    chip8.setKey(0xB, keystate[SDL_SCANCODE_B]);
+    chip8.setKey(0xC, keystate[SDL_SCANCODE_C]);
+    chip8.setKey(0xD, keystate[SDL_SCANCODE_D]);
+    chip8.setKey(0xE, keystate[SDL_SCANCODE_E]);
+    chip8.setKey(0xF, keystate[SDL_SCANCODE_F]);
         
 }
 
 
 // Draw each pixel to the screen
-// Pixels are 10x10 in size
+// Pixels are 10x10 in size (5x5 in high resolution)
 // Total screen resolution is 640x320
 void drawGraphics(SDL_Renderer *renderer) {
     // Black background
@@ -147,15 +147,15 @@ void drawGraphics(SDL_Renderer *renderer) {
     SDL_RenderClear(renderer);
 
     // Draw each white pixel
+    int scale = SCREEN_WIDTH / chip8.screenWidth();
     SDL_SetRenderDrawColor(renderer, 255, 255, 255, 255);
-    for (int i = 0; i < VIDEO_WIDTH * VIDEO_HEIGHT; i++) {
-        if (chip8.video[i]) {
-            int x = (i % VIDEO_WIDTH) * PIXEL_SCALE;
-            int y = (i / VIDEO_WIDTH) * PIXEL_SCALE;
-
-            SDL_Rect rect = {x, y, 10, 10};
-            SDL_RenderDrawRect(renderer, &rect);
-            SDL_RenderFillRect(renderer, &rect);
+    for (unsigned int y = 0; y < chip8.screenHeight(); y++) {
+        for (unsigned int x = 0; x < chip8.screenWidth(); x++) {
+            if (chip8.getPixel(x, y)) {
+                SDL_Rect rect = {(int)x * scale, (int)y * scale, scale, scale};
+                SDL_RenderDrawRect(renderer, &rect);
+                SDL_RenderFillRect(renderer, &rect);
+            }
         }
     }
 
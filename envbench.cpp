@@ -0,0 +1,115 @@
+#include <cstdio>
+#include <cstdint>
+#include <chrono>
+#include <vector>
+#include <string>
+#include <cstring>
+#include <cstdlib>
+#include <new>
+#include <atomic>
+#include "Chip8.hpp"
+#include "Chip8.cpp"
+#include "Sha1.hpp"
+#include "Sha1.cpp"
+#include "PrefixCache.hpp"
+#include "PrefixCache.cpp"
+#include "VecEnv.hpp"
+#include "VecEnv.cpp"
+
+// Throughput benchmark for VecEnv
+// Build: g++ -O2 -pthread envbench.cpp -o envbench
+// Usage: ./envbench <ROM> [ENVS] [STEPS] [THREADS] [--skip-prefix]
+//
+// Every environment gets random key presses, and is reset as soon as it is done
+// --skip-prefix starts every episode after the ROM's deterministic prefix (see EnvConfig::skip_prefix), and reports the instructions that saves
+// Every allocation is counted, and the benchmark fails if stepping or resetting made any, as VecEnv promises they do not
+
+std::atomic<uint64_t> allocations(0);
+
+void *operator new(size_t size) {
+    allocations++;
+    void *p = malloc(size ? size : 1);
+    if (!p)
+        throw std::bad_alloc();
+    return p;
+}
+
+// free() is kept out of sight of the callers, GCC warns about it on memory from operator new when it can see both
+__attribute__((noinline)) void release(void *p) {
+    free(p);
+}
+
+void operator delete(void *p) noexcept {
+    release(p);
+}
+
+void operator delete(void *p, size_t) noexcept {
+    release(p);
+}
+
+
+uint32_t benchState = 1;
+
+uint32_t benchRandom() {
+    benchState ^= benchState << 13;
+    benchState ^= benchState >> 17;
+    benchState ^= benchState << 5;
+    return benchState;
+}
+
+
+int main(int argc, char **argv) {
+    EnvConfig config;
+    config.max_frames = 3600;
+
+    std::vector<std::string> args;
+    for (int i = 1; i < argc; i++) {
+        if (!strcmp(argv[i], "--skip-prefix"))
+            config.skip_prefix = true;
+        else
+            args.push_back(argv[i]);
+    }
+
+    if (args.empty()) {
+        printf("ERROR: PROPER USAGE IS: ./envbench <ROM> [ENVS] [STEPS] [THREADS] [--skip-prefix]\n");
+        return 1;
+    }
+
+    unsigned int count = args.size() > 1 ? std::stoul(args[1]) : 1024;
+    unsigned long steps = args.size() > 2 ? std::stoul(args[2]) : 1000;
+    unsigned int threads = args.size() > 3 ? std::stoul(args[3]) : 0;
+
+    VecEnv envs(count, config, threads);
+    if (!envs.loadROM(args[0].c_str()))
+        return 1;
+
+    // Actions are made up front so only the environments are timed
+    std::vector<uint16_t> actions((size_t)count * 64);
+    for (uint16_t &action : actions)
+        action = 1 << (benchRandom() & 0xF);
+
+    uint64_t resets = count;                                // loadROM() reset every environment
+    uint64_t allocated = allocations;
+    auto start = std::chrono::steady_clock::now();
+    for (unsigned long s = 0; s < steps; s++) {
+        envs.step(&actions[(s % 64) * count]);
+        for (unsigned int i = 0; i < count; i++)
+            resets += envs.dones()[i];
+        envs.reset(envs.dones());
+    }
+    auto end = std::chrono::steady_clock::now();
+    allocated = allocations - allocated;
+
+    double seconds = std::chrono::duration<double>(end - start).count();
+    printf("%u envs, %lu steps: %.0f env-frames/sec\n", count, steps, count * steps / seconds);
+    if (config.skip_prefix) {
+        printf("Prefix: %lu frames, %llu instructions saved per reset, %llu saved over %llu resets\n", envs.skippedFrames(),
+               (unsigned long long)envs.skippedInstructions(), (unsigned long long)(envs.skippedInstructions() * resets), (unsigned long long)resets);
+    }
+
+    if (allocated) {
+        printf("ERROR: Stepping and resetting made %llu allocations\n", (unsigned long long)allocated);
+        return 1;
+    }
+    return 0;
+}
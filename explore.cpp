@@ -0,0 +1,503 @@
+#include <cstdio>
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <vector>
+#include <memory>
+#include <algorithm>
+#include <chrono>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include "Chip8.hpp"
+#include "Chip8.cpp"
+
+// Coverage-guided state-space explorer
+// Explores the states a ROM can reach by branching on keypad input at frame boundaries, looking for crashes and soft-locks
+// Build: g++ -O2 -pthread explore.cpp -o explore
+// Usage: ./explore <ROM> [--seconds N] [--threads N] [--step FRAMES] [--ips N] [--seed N] [--max-states N] [--max-frontier N] [--out DIR]
+//                        [--platform chip8|schip|xochip]
+//
+// From each state, every keypad input (no key, or one of the 16 keys held) is tried for --step frames on a clone of the machine
+// States that have been reached before (by stateHash()) are dropped, new ones join the frontier
+// The frontier is worked through best first: states whose step ran code addresses nothing had run before, or drew a display nothing had drawn before,
+// are expanded before the rest, which are expanded shallowest first
+//
+// Reported:
+//   crash       the program faulted (stack overflow or underflow)
+//   soft-lock   no input changes the machine state any more, e.g. a jump to itself
+// Each report comes with an input script that reproduces it: ./Chip8 <ROM> <IPS> --seed <SEED> --headless <FRAMES> --script <FILE>
+// The scripts are written to --out, or printed if there is no --out
+// Coverage of code addresses is printed every second, and the addresses that were never run are listed at the end
+
+const unsigned int ACTION_COUNT = KEY_COUNT + 1;            // Each key held on its own, and no key
+const uint8_t NO_KEY = KEY_COUNT;
+const uint32_t NO_PARENT = UINT32_MAX;
+const unsigned int MAX_REPORTS = 32;                        // Reports kept, further ones are only counted
+
+
+struct Options {
+    double seconds = 10;
+    unsigned int threads = std::max(1u, std::thread::hardware_concurrency());
+    unsigned int step = 6;                                  // Frames each input is held for, 0.1 emulated seconds
+    unsigned int ips = 700;
+    uint32_t seed = 1;
+    size_t maxStates = 1000000;
+    size_t maxFrontier = 20000;                             // Each frontier state holds a Chip8, a few KB with its pages shared
+    const char *out = NULL;
+    Platform platform = PLATFORM_CHIP8;
+};
+
+
+// Fixed-size open-addressing set of 64-bit hashes, inserting is one compare-and-swap so threads never wait on each other
+class HashSet {
+    public:
+        HashSet(size_t capacity) {
+            size_t size = 1024;
+            while (size < capacity * 2)                     // Kept at most half full so probes stay short
+                size *= 2;
+
+            slots = std::unique_ptr<std::atomic<uint64_t>[]>(new std::atomic<uint64_t>[size]);
+            for (size_t i = 0; i < size; i++)
+                slots[i].store(0, std::memory_order_relaxed);
+            mask = size - 1;
+            limit = capacity;
+            count = 0;
+        }
+
+        // True if the hash was not in the set, false if it was (or the set is full)
+        bool insert(uint64_t hash) {
+            if (!hash)
+                hash = 1;                                   // 0 marks an empty slot
+
+            for (size_t i = hash & mask; ; i = (i + 1) & mask) {
+                uint64_t current = slots[i].load(std::memory_order_relaxed);
+                if (current == hash)
+                    return false;
+
+                if (current == 0) {
+                    if (count.load(std::memory_order_relaxed) >= limit)
+                        return false;
+                    if (slots[i].compare_exchange_strong(current, hash, std::memory_order_relaxed)) {
+                        count++;
+                        return true;
+                    }
+                    if (current == hash)                    // Another thread got there first with the same hash
+                        return false;
+                }
+            }
+        }
+
+        size_t size() {
+            return count.load(std::memory_order_relaxed);
+        }
+
+        bool full() {
+            return size() >= limit;
+        }
+
+    private:
+        std::unique_ptr<std::atomic<uint64_t>[]> slots;
+        size_t mask;
+        size_t limit;
+        std::atomic<size_t> count;
+};
+
+
+// Every state that was reached keeps a trail entry, so the inputs that lead to it can be written out as a script
+struct Trail {
+    uint32_t parent;
+    uint8_t action;                                         // Key held during the step into this state, NO_KEY for none
+};
+
+struct Node {
+    Chip8 machine;
+    uint32_t trail;
+    uint32_t depth;                                         // Steps from the start
+    uint8_t action;                                         // Input of the step that reached this state
+    unsigned int score;                                     // How much new coverage reaching it found, higher is expanded first
+    bool novel;                                             // The step into it ran new code or drew a new display
+};
+
+struct Report {
+    std::string kind;
+    std::string detail;
+    uint32_t trail;
+};
+
+
+struct Explorer {
+    Options options;
+    Chip8 root;
+
+    HashSet states;
+    HashSet displays;
+    std::vector<std::atomic<uint64_t>> coverage;            // One bit per address that has been run as part of an instruction
+
+    // Protected by lock
+    std::mutex lock;
+    std::condition_variable wake;
+    std::vector<std::unique_ptr<Node>> frontier;            // Heap, best node at the front
+    std::vector<Trail> trails;
+    std::vector<Report> reports;
+    std::vector<uint32_t> reported;                         // Each kind of problem is reported once per PC
+    unsigned int crashes = 0;
+    unsigned int softlocks = 0;
+    unsigned int busy = 0;                                  // Threads expanding a node
+    bool stopping = false;
+    bool exhausted = false;                                 // Every reachable state was explored
+
+    std::atomic<uint64_t> expanded{0};
+    std::atomic<uint64_t> frames{0};
+
+    Explorer(const Options &options) : options(options), states(options.maxStates), displays(options.maxStates), coverage(XO_MEMORY_SIZE / 64) {
+        for (std::atomic<uint64_t> &word : coverage)
+            word.store(0, std::memory_order_relaxed);
+    }
+};
+
+
+// Best first: the most new coverage, then the fewest steps from the start
+bool worseNode(const std::unique_ptr<Node> &a, const std::unique_ptr<Node> &b) {
+    if (a->score != b->score)
+        return a->score < b->score;
+    return a->depth > b->depth;
+}
+
+
+uint64_t hashDisplay(Chip8 &chip8) {
+    uint64_t hash = 0x2545F4914F6CDD1Dull;
+    for (unsigned int p = 0; p < PLANE_COUNT; p++) {
+        for (unsigned int y = 0; y < VIDEO_HEIGHT; y++) {
+            hash = (hash ^ (uint64_t)chip8.video[p][y]) * 0x9E3779B97F4A7C15ull;
+            hash = (hash ^ (uint64_t)(chip8.video[p][y] >> 64)) * 0x9E3779B97F4A7C15ull;
+            hash ^= hash >> 29;
+        }
+    }
+    return hash;
+}
+
+
+// Marks an address as run, returns true if nothing had run it before
+bool cover(Explorer &explorer, uint16_t pc) {
+    std::atomic<uint64_t> &word = explorer.coverage[pc / 64];
+    uint64_t bit = 1ull << (pc % 64);
+    if (word.load(std::memory_order_relaxed) & bit)
+        return false;
+    return !(word.fetch_or(bit, std::memory_order_relaxed) & bit);
+}
+
+
+unsigned int coveredAddresses(Explorer &explorer) {
+    unsigned int count = 0;
+    for (std::atomic<uint64_t> &word : explorer.coverage)
+        count += __builtin_popcountll(word.load(std::memory_order_relaxed));
+    return count;
+}
+
+
+// Holds action's key (releasing the last one) and runs a step, an instruction at a time so every address run is seen
+// Both bytes of an instruction count as run, so the addresses never run are the gaps between code
+// Returns how many instructions were run from an address for the first time
+unsigned int runStep(Explorer &explorer, Chip8 &chip8, uint8_t previous, uint8_t action) {
+    if (previous != action && previous != NO_KEY)
+        chip8.setKey(previous, false);
+    if (previous != action && action != NO_KEY)
+        chip8.setKey(action, true);
+
+    unsigned int found = 0;
+    for (unsigned int f = 0; f < explorer.options.step && !chip8.isHalted(); f++) {
+        unsigned int cycles = chip8.beginFrame();
+        for (unsigned int i = 0; i < cycles; i++) {
+            uint16_t pc = chip8.getRegisters().pc;
+            found += cover(explorer, pc);
+            cover(explorer, pc + 1);
+            chip8.emulateCycle();
+        }
+        chip8.endFrame();
+    }
+
+    explorer.frames += explorer.options.step;
+    return found;
+}
+
+
+// Takes the next node off the frontier, waiting while other threads may still add to it
+// Returns NULL once there is nothing left to explore
+std::unique_ptr<Node> takeNode(Explorer &explorer) {
+    std::unique_lock<std::mutex> guard(explorer.lock);
+
+    while (true) {
+        if (explorer.stopping)
+            return NULL;
+
+        if (!explorer.frontier.empty()) {
+            std::pop_heap(explorer.frontier.begin(), explorer.frontier.end(), worseNode);
+            std::unique_ptr<Node> node = std::move(explorer.frontier.back());
+            explorer.frontier.pop_back();
+            explorer.busy++;
+            return node;
+        }
+
+        if (!explorer.busy) {
+            explorer.stopping = true;                       // Nothing left and nobody is going to add anything
+            explorer.exhausted = true;
+            explorer.wake.notify_all();
+            return NULL;
+        }
+        explorer.wake.wait(guard);
+    }
+}
+
+
+void report(Explorer &explorer, const char *kind, const std::string &detail, uint32_t trail, uint16_t pc) {
+    uint32_t key = (kind[0] << 16) | pc;
+    if (std::find(explorer.reported.begin(), explorer.reported.end(), key) != explorer.reported.end())
+        return;
+    explorer.reported.push_back(key);
+
+    if (explorer.reports.size() < MAX_REPORTS)
+        explorer.reports.push_back({kind, detail, trail});
+}
+
+
+// Tries every input from node, keeps the new states and reports anything that went wrong
+void expand(Explorer &explorer, Node &node) {
+    std::vector<std::unique_ptr<Node>> children;
+    uint64_t before = node.machine.stateHash();
+    bool stuck = !node.machine.isHalted();
+
+    for (uint8_t action = 0; action < ACTION_COUNT; action++) {
+        std::unique_ptr<Node> child(new Node{node.machine.clone(), 0, node.depth + 1, action, 0, false});
+        unsigned int found = runStep(explorer, child->machine, node.action, action);
+
+        uint64_t hash = child->machine.stateHash();
+        if (hash != before)
+            stuck = false;
+        if (!explorer.states.insert(hash))
+            continue;
+
+        bool newDisplay = explorer.displays.insert(hashDisplay(child->machine));
+        child->score = 8 * found + (newDisplay ? 2 : 0) + node.score / 2;
+        child->novel = found || newDisplay;
+        children.push_back(std::move(child));
+    }
+
+    std::lock_guard<std::mutex> guard(explorer.lock);
+    for (std::unique_ptr<Node> &child : children) {
+        child->trail = explorer.trails.size();
+        explorer.trails.push_back({node.trail, child->action});
+
+        if (child->machine.getFault()) {
+            explorer.crashes++;
+            report(explorer, "crash", child->machine.getFault(), child->trail, child->machine.getRegisters().pc);
+            continue;
+        }
+        if (child->machine.isHalted())
+            continue;                                       // The program exited on purpose (00FD)
+
+        // A full frontier still takes states that found something new, the rest are only remembered as seen
+        if (explorer.frontier.size() >= explorer.options.maxFrontier && !child->novel)
+            continue;
+
+        explorer.frontier.push_back(std::move(child));
+        std::push_heap(explorer.frontier.begin(), explorer.frontier.end(), worseNode);
+    }
+
+    if (stuck) {
+        explorer.softlocks++;
+        report(explorer, "soft-lock", "no input changes the state", node.trail, node.machine.getRegisters().pc);
+    }
+
+    explorer.busy--;
+    explorer.expanded++;
+    explorer.wake.notify_all();
+}
+
+
+void worker(Explorer &explorer) {
+    while (std::unique_ptr<Node> node = takeNode(explorer)) {
+        expand(explorer, *node);
+    }
+}
+
+
+// Inputs from the start to a state, as an input script for --script
+// frames is set to how many frames it takes to get there
+std::string scriptFor(Explorer &explorer, uint32_t trail, uint64_t &frames) {
+    std::vector<uint8_t> actions;
+    for (uint32_t t = trail; explorer.trails[t].parent != NO_PARENT; t = explorer.trails[t].parent)
+        actions.push_back(explorer.trails[t].action);
+    std::reverse(actions.begin(), actions.end());
+
+    std::string script;
+    char line[64];
+    uint8_t held = NO_KEY;
+    uint64_t frame = 0;
+    for (uint8_t action : actions) {
+        if (action != held && held != NO_KEY) {
+            snprintf(line, sizeof(line), "%llu %X up\n", (unsigned long long)frame, held);
+            script += line;
+        }
+        if (action != held && action != NO_KEY) {
+            snprintf(line, sizeof(line), "%llu %X down\n", (unsigned long long)frame, action);
+            script += line;
+        }
+        held = action;
+        frame += explorer.options.step;
+    }
+    snprintf(line, sizeof(line), "%llu quit\n", (unsigned long long)frame);
+    script += line;
+
+    frames = frame;
+    return script;
+}
+
+
+void printReports(Explorer &explorer, const char *rom) {
+    const char *PLATFORM_OPTIONS[] = {"", " --platform schip", " --platform xochip"};
+    const char *platform = PLATFORM_OPTIONS[explorer.options.platform];
+
+    unsigned int number = 0;
+    for (const Report &r : explorer.reports) {
+        number++;
+        uint64_t frames;
+        std::string script = scriptFor(explorer, r.trail, frames);
+
+        printf("\n%s #%u: %s\n", r.kind.c_str(), number, r.detail.c_str());
+        if (explorer.options.out) {
+            std::string filename = std::string(explorer.options.out) + "/" + r.kind + "-" + std::to_string(number) + ".txt";
+            FILE *fp = fopen(filename.c_str(), "w");
+            if (fp == NULL) {
+                printf("ERROR: Could not open file %s\n", filename.c_str());
+                continue;
+            }
+            fputs(script.c_str(), fp);
+            fclose(fp);
+            printf("Replay: ./Chip8 %s %u --seed %u%s --headless %llu --script %s\n", rom, explorer.options.ips, explorer.options.seed, platform,
+                   (unsigned long long)frames, filename.c_str());
+        } else {
+            printf("Replay: ./Chip8 %s %u --seed %u%s --headless %llu --script <FILE> with FILE holding:\n%s", rom, explorer.options.ips, explorer.options.seed, platform,
+                   (unsigned long long)frames, script.c_str());
+        }
+    }
+}
+
+
+// Runs of code addresses that were never reached, within the ROM
+void printUncovered(Explorer &explorer, uint32_t romSize) {
+    printf("\nNever run:");
+    unsigned int shown = 0;
+    for (uint32_t a = 0x200; a < 0x200 + romSize && shown < 32; a++) {
+        if (explorer.coverage[a / 64].load() & (1ull << (a % 64)))
+            continue;
+
+        uint32_t end = a;
+        while (end + 1 < 0x200 + romSize && !(explorer.coverage[(end + 1) / 64].load() & (1ull << ((end + 1) % 64))))
+            end++;
+        printf(end > a ? " 0x%03X-0x%03X" : " 0x%03X", a, end);
+        a = end;
+        shown++;
+    }
+    printf(shown ? "\n(data, or code that no input reached)\n" : " nothing\n");
+}
+
+
+int main(int argc, char **argv) {
+    Options options;
+    const char *rom = NULL;
+
+    for (int i = 1; i < argc; i++) {
+        if (!strcmp(argv[i], "--seconds") && i + 1 < argc) {
+            options.seconds = std::stod(argv[++i]);
+        } else if (!strcmp(argv[i], "--threads") && i + 1 < argc) {
+            options.threads = std::max(1ul, std::stoul(argv[++i]));
+        } else if (!strcmp(argv[i], "--step") && i + 1 < argc) {
+            options.step = std::max(1ul, std::stoul(argv[++i]));
+        } else if (!strcmp(argv[i], "--ips") && i + 1 < argc) {
+            options.ips = std::stoul(argv[++i]);
+        } else if (!strcmp(argv[i], "--seed") && i + 1 < argc) {
+            options.seed = std::stoul(argv[++i]);
+        } else if (!strcmp(argv[i], "--max-states") && i + 1 < argc) {
+            options.maxStates = std::stoull(argv[++i]);
+        } else if (!strcmp(argv[i], "--max-frontier") && i + 1 < argc) {
+            options.maxFrontier = std::stoull(argv[++i]);
+        } else if (!strcmp(argv[i], "--out") && i + 1 < argc) {
+            options.out = argv[++i];
+        } else if (!strcmp(argv[i], "--platform") && i + 1 < argc) {
+            if (!Chip8::parsePlatform(argv[++i], options.platform)) {
+                printf("ERROR: Unknown platform %s\n", argv[i]);
+                return 1;
+            }
+        } else if (!rom) {
+            rom = argv[i];
+        } else {
+            printf("ERROR: Unknown argument %s\n", argv[i]);
+            return 1;
+        }
+    }
+
+    if (!rom) {
+        printf("ERROR: PROPER USAGE IS: ./explore <ROM> [--seconds N] [--threads N] [--step FRAMES] [--ips N] [--seed N] [--max-states N] [--max-frontier N] [--out DIR] [--platform chip8|schip|xochip]\n");
+        return 1;
+    }
+
+    Explorer explorer(options);
+    explorer.root.setPlatform(options.platform);
+    explorer.root.setSpeed(options.ips);
+    explorer.root.seed(options.seed);
+    if (!explorer.root.loadROM(rom))
+        return 1;
+
+    FILE *fp = fopen(rom, "rb");
+    if (fp == NULL) {
+        printf("ERROR: Could not open file %s\n", rom);
+        return 1;
+    }
+    fseek(fp, 0, SEEK_END);
+    uint32_t romSize = ftell(fp);
+    fclose(fp);
+
+    explorer.states.insert(explorer.root.stateHash());
+    explorer.trails.push_back({NO_PARENT, NO_KEY});
+    explorer.frontier.push_back(std::unique_ptr<Node>(new Node{explorer.root.clone(), 0, 0, NO_KEY, 0, false}));
+
+    std::vector<std::thread> workers;
+    for (unsigned int t = 0; t < options.threads; t++)
+        workers.emplace_back(worker, std::ref(explorer));
+
+    // Report progress once a second until time runs out, the state limit is reached or there is nothing left to explore
+    auto start = std::chrono::steady_clock::now();
+    printf("%8s %10s %10s %10s %10s %8s %8s %10s\n", "seconds", "states", "frontier", "expanded", "code", "displays", "crashes", "soft-locks");
+    while (true) {
+        bool finished;
+        {
+            std::unique_lock<std::mutex> guard(explorer.lock);
+            explorer.wake.wait_for(guard, std::chrono::seconds(1), [&]() { return explorer.stopping; });
+
+            double elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+            finished = explorer.stopping || elapsed >= options.seconds || explorer.states.full();
+            printf("%8.1f %10zu %10zu %10llu %10u %8zu %8u %10u\n", elapsed, explorer.states.size(), explorer.frontier.size(),
+                   (unsigned long long)explorer.expanded.load(), coveredAddresses(explorer), explorer.displays.size(), explorer.crashes, explorer.softlocks);
+            fflush(stdout);
+
+            if (finished) {
+                explorer.stopping = true;
+                explorer.wake.notify_all();
+            }
+        }
+        if (finished)
+            break;
+    }
+    for (std::thread &t : workers)
+        t.join();
+
+    double elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    printf("\n%s: %zu states, %u code addresses, %zu displays, %.0f emulated frames/sec\n", explorer.exhausted ? "Explored every reachable state" : "Stopped",
+           explorer.states.size(), coveredAddresses(explorer), explorer.displays.size(), explorer.frames.load() / elapsed);
+
+    printReports(explorer, rom);
+    printUncovered(explorer, romSize);
+    return explorer.crashes ? 1 : 0;
+}
@@ -0,0 +1,183 @@
+#include <cstdio>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+#include "Chip8.hpp"
+#include "Chip8.cpp"
+
+// Fuzz target for the interpreter core
+// libFuzzer build: clang++ -O1 -g -fsanitize=fuzzer,address -DCHIP8_LIBFUZZER fuzz.cpp -o fuzz
+// Standalone build: g++ -O1 -g -fsanitize=address -D_GLIBCXX_ASSERTIONS fuzz.cpp -o fuzz
+// Usage (standalone): ./fuzz [ROMS] [SEED]
+//                     ./fuzz --replay <FILE>...        Runs saved inputs, e.g. crashes found by libFuzzer
+//
+// An input is a platform byte, FUZZ_KEY_EVENTS keypad events and then the ROM:
+//   byte 0                     platform (modulo the number of platforms)
+//   bytes 1 - FUZZ_KEY_EVENTS  one key event each, spread evenly over the run: low nibble is the key, bit 4 presses it, otherwise it is released
+//   the rest                   ROM, loaded at 0x200
+// After every instruction the machine has to be in a valid state (see Chip8::isStateValid()), and at the end stateHash() has to match computeStateHash(),
+// any access outside of guest memory is caught by AddressSanitizer or the std::vector assertions
+//
+// Each platform gets one Chip8 that is kept for the whole run, so an input only costs a loadROM() reset and not a rebuild of the opcode tables
+
+const unsigned int FUZZ_CYCLES = 10000;                    // Most instructions run per input
+const unsigned int FUZZ_KEY_EVENTS = 8;
+const unsigned int FUZZ_HEADER_SIZE = 1 + FUZZ_KEY_EVENTS;
+const unsigned int FUZZ_TIMER_CYCLES = 12;                 // Instructions per timer tick, 720 instructions per second
+const Platform FUZZ_PLATFORMS[] = {PLATFORM_CHIP8, PLATFORM_SCHIP, PLATFORM_XOCHIP};
+const unsigned int FUZZ_PLATFORM_COUNT = sizeof(FUZZ_PLATFORMS) / sizeof(FUZZ_PLATFORMS[0]);
+
+
+extern "C" int LLVMFuzzerTestOneInput(const uint8_t *data, size_t size) {
+    static Chip8 *cores[FUZZ_PLATFORM_COUNT];
+
+    if (size < FUZZ_HEADER_SIZE)
+        return 0;
+
+    unsigned int p = data[0] % FUZZ_PLATFORM_COUNT;
+    if (!cores[p]) {
+        cores[p] = new Chip8();
+        cores[p]->setPlatform(FUZZ_PLATFORMS[p]);
+        cores[p]->seed(1);
+    }
+    Chip8 &chip8 = *cores[p];
+
+    // Anything past the end of memory is dropped rather than rejected, so the fuzzer does not waste time on inputs that never run
+    size_t romSize = size - FUZZ_HEADER_SIZE;
+    size_t maxSize = (FUZZ_PLATFORMS[p] == PLATFORM_XOCHIP ? XO_MEMORY_SIZE : MEMORY_SIZE) - 0x200;
+    if (romSize > maxSize)
+        romSize = maxSize;
+
+    chip8.loadROM(data + FUZZ_HEADER_SIZE, romSize);
+    for (unsigned int i = 0; i < KEY_COUNT; i++) {
+        chip8.setKey(i, false);
+    }
+
+    for (unsigned int i = 0; i < FUZZ_CYCLES && !chip8.isHalted(); i++) {
+        if (!(i % (FUZZ_CYCLES / FUZZ_KEY_EVENTS))) {
+            uint8_t event = data[1 + i / (FUZZ_CYCLES / FUZZ_KEY_EVENTS)];
+            chip8.setKey(event & 0xF, event & 0x10);
+        }
+        if (!(i % FUZZ_TIMER_CYCLES))
+            chip8.updateTimers();
+
+        chip8.emulateCycle();
+
+        if (!chip8.isStateValid()) {
+            printf("ERROR: Invalid state after instruction %u\n", i);
+            chip8.debug(D_OP | D_PC | D_SP | D_I);
+            abort();
+        }
+    }
+
+    // A missed update to the incremental hash stays wrong until it is recomputed, so checking once at the end catches it
+    if (chip8.stateHash() != chip8.computeStateHash()) {
+        printf("ERROR: Incremental state hash does not match the recomputed hash\n");
+        chip8.debug(D_OP | D_PC | D_SP | D_I);
+        abort();
+    }
+
+    return 0;
+}
+
+
+#ifndef CHIP8_LIBFUZZER
+
+// The standalone build makes its own inputs
+// Plain random bytes rarely point I anywhere interesting, so the ROMs are mostly built from memory-touching instructions aimed at the end of memory
+
+const unsigned int FUZZ_MAX_ROM_SIZE = MEMORY_SIZE - 0x200;
+
+uint32_t fuzzState;
+
+uint32_t fuzzRandom() {
+    fuzzState ^= fuzzState << 13;
+    fuzzState ^= fuzzState >> 17;
+    fuzzState ^= fuzzState << 5;
+    return fuzzState;
+}
+
+
+// Appends one instruction, picked so that most of them read or write memory near the top of it
+void appendInstruction(std::vector<uint8_t> &input) {
+    uint16_t op;
+    uint8_t x = fuzzRandom() & 0xF;
+    uint8_t y = fuzzRandom() & 0xF;
+
+    switch (fuzzRandom() % 10) {
+        case 0 :    op = 0xAFF0 | (fuzzRandom() & 0xF);                 break;  // I = near the end of 4KB
+        case 1 :    op = 0xD000 | (x << 8) | (y << 4) | (fuzzRandom() & 0xF);  break;  // Draw
+        case 2 :    op = 0xF055 | (x << 8);                             break;  // Store registers
+        case 3 :    op = 0xF065 | (x << 8);                             break;  // Load registers
+        case 4 :    op = 0xF033 | (x << 8);                             break;  // BCD
+        case 5 :    op = 0xF01E | (x << 8);                             break;  // I += Vx
+        case 6 :    op = 0x5002 | (x << 8) | (y << 4) | (fuzzRandom() & 1);    break;  // XO-CHIP register range
+        case 7 :                                                                        // XO-CHIP I = nnnn, near the end of 64KB
+            input.push_back(0xF0);
+            input.push_back(0x00);
+            op = 0xFFF0 | (fuzzRandom() & 0xF);
+            break;
+        default :   op = fuzzRandom() & 0xFFFF;                         break;  // Anything at all
+    }
+
+    input.push_back(op >> 8);
+    input.push_back(op & 0xFF);
+}
+
+
+// Runs each input file once
+int replay(int count, char **files) {
+    for (int i = 0; i < count; i++) {
+        FILE *fp = fopen(files[i], "rb");
+        if (fp == NULL) {
+            printf("ERROR: Could not open %s\n", files[i]);
+            return 1;
+        }
+
+        std::vector<uint8_t> input;
+        int c;
+        while ((c = fgetc(fp)) != EOF)
+            input.push_back(c);
+        fclose(fp);
+
+        LLVMFuzzerTestOneInput(input.data(), input.size());
+        printf("%s: OK\n", files[i]);
+    }
+    return 0;
+}
+
+
+int main(int argc, char **argv) {
+    if (argc > 1 && !strcmp(argv[1], "--replay"))
+        return replay(argc - 2, argv + 2);
+
+    unsigned long roms = argc > 1 ? std::stoul(argv[1]) : 1000;
+    fuzzState = argc > 2 ? std::stoul(argv[2]) : 1;
+    if (!fuzzState)
+        fuzzState = 1;
+
+    std::vector<uint8_t> input;
+    for (unsigned long r = 0; r < roms; r++) {
+        input.clear();
+        for (unsigned int i = 0; i < FUZZ_HEADER_SIZE; i++) {
+            input.push_back(fuzzRandom() & 0xFF);
+        }
+
+        unsigned int size = FUZZ_HEADER_SIZE + 1 + fuzzRandom() % FUZZ_MAX_ROM_SIZE;
+        while (input.size() < size)
+            appendInstruction(input);
+        input.resize(size);
+
+        // Every ROM is run on each platform
+        for (unsigned int p = 0; p < FUZZ_PLATFORM_COUNT; p++) {
+            input[0] = p;
+            LLVMFuzzerTestOneInput(input.data(), input.size());
+        }
+    }
+
+    printf("%lu ROMs, no out-of-bounds access or invalid state\n", roms);
+    return 0;
+}
+
+#endif
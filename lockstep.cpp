@@ -0,0 +1,287 @@
+#include <cstdio>
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <vector>
+#include <thread>
+#include <mutex>
+#include <atomic>
+#include <algorithm>
+#include <filesystem>
+#include "Chip8.hpp"
+#include "Chip8.cpp"
+
+// Lockstep differential runner
+// Runs every ROM on a reference core and a candidate core side by side, feeding both the same input, and checks that they never disagree
+// Build: g++ -O2 -std=c++17 -pthread lockstep.cpp -o lockstep
+// Usage: ./lockstep <ROM or DIRECTORY>... [--candidate NAME] [--frames N] [--check N] [--ips N] [--threads N] [--platform chip8|schip|xochip]
+//
+// The machine states are compared by hash every --check instructions
+// When the hashes differ, both cores are rewound to the last matching check and run again one instruction further each time to find the first instruction that differs,
+// then both states are printed
+// The candidate runs each stretch between checks with a single emulateCycles() call, so a core with tiers runs whole blocks through them
+// Without --platform, the platform is picked from the file extension: .sc8 is SUPER-CHIP, .xo8 is XO-CHIP and anything else is CHIP-8
+
+const unsigned long DEFAULT_FRAMES = 3600;                  // One emulated minute
+const unsigned long DEFAULT_CHECK_INTERVAL = 1000;
+const unsigned int DEFAULT_IPS = 700;
+const unsigned int INPUT_INTERVAL = 6;                      // Frames between generated key events
+
+
+// Cores a ROM can be checked against
+// The reference core is plain Chip8, a candidate is a Chip8 with a different execution strategy switched on
+const char *CANDIDATES[] = {
+    "reference",                                            // The reference core against itself, checks that runs are deterministic
+    "tiered",                                               // Blocks predecoded after their second entry, so promotion and demotion happen all the time
+};
+
+bool configureCandidate(Chip8 &chip8, const std::string &name) {
+    if (name == "reference")
+        return true;
+
+    if (name == "tiered") {
+        chip8.setTiering(2);
+        return true;
+    }
+
+    return false;
+}
+
+
+struct Options {
+    std::string candidate = "reference";
+    unsigned long frames = DEFAULT_FRAMES;
+    unsigned long checkInterval = DEFAULT_CHECK_INTERVAL;
+    unsigned int ips = DEFAULT_IPS;
+    int platform = -1;                                      // -1 picks the platform from the file extension
+};
+
+
+// Both cores, and where they are in the run
+// Copying a Lockstep is a checkpoint that the run can be rewound to
+struct Lockstep {
+    Chip8 reference;
+    Chip8 candidate;
+
+    unsigned long frame = 0;
+    unsigned int cycle = 0;                                 // Instructions run so far in this frame
+    unsigned int cycles = 0;                                // Instructions in this frame, 0 before the frame has started
+    bool inFrame = false;
+    unsigned long long instructions = 0;
+    uint32_t input = 1;                                     // xorshift state for the generated key events
+};
+
+
+// Key events come from a fixed generator whose state is part of the checkpoint, so every run of a ROM (and a rewound run) sees the same input
+void applyInput(Lockstep &run) {
+    if (run.frame % INPUT_INTERVAL)
+        return;
+
+    run.input ^= run.input << 13;
+    run.input ^= run.input >> 17;
+    run.input ^= run.input << 5;
+
+    uint8_t key = run.input & 0xF;
+    bool pressed = (run.input >> 4) & 1;
+    run.reference.setKey(key, pressed);
+    run.candidate.setKey(key, pressed);
+}
+
+
+// Runs up to limit instructions on both cores, starting and finishing frames around them exactly as emulateFrame() would
+// Stops at the end of a frame, returns false once every frame has been run
+bool advance(Lockstep &run, unsigned long frames, unsigned long limit) {
+    while (true) {
+        if (run.frame >= frames)
+            return false;
+
+        if (!run.inFrame) {
+            applyInput(run);
+            run.cycles = run.reference.beginFrame();
+            run.candidate.beginFrame();
+            run.cycle = 0;
+            run.inFrame = true;
+        }
+
+        if (run.cycle < run.cycles) {
+            unsigned int count = std::min<unsigned long>(run.cycles - run.cycle, limit);
+            for (unsigned int i = 0; i < count; i++) {
+                run.reference.emulateCycle();
+            }
+            run.candidate.emulateCycles(count);
+            run.cycle += count;
+            run.instructions += count;
+        }
+
+        if (run.cycle == run.cycles) {
+            run.reference.endFrame();
+            run.candidate.endFrame();
+            run.frame++;
+            run.inFrame = false;
+        }
+
+        if (run.cycles)
+            return true;
+    }
+}
+
+
+bool statesMatch(Lockstep &run) {
+    return run.reference.stateHash() == run.candidate.stateHash();
+}
+
+
+std::mutex outputLock;                                      // Keeps the reports of different ROMs from being interleaved
+
+// Prints both states at the first instruction where they differ
+void reportDivergence(const std::string &rom, Lockstep &run) {
+    std::lock_guard<std::mutex> lock(outputLock);
+
+    printf("DIVERGED %s at instruction %llu (frame %lu)\n", rom.c_str(), run.instructions, run.frame);
+    fflush(stdout);
+
+    std::cout << "---- reference ----" << std::endl;
+    run.reference.debug(D_OP | D_PC | D_I | D_SP | D_STACK | D_V | D_DT | D_ST);
+    std::cout << "---- candidate ----" << std::endl;
+    run.candidate.debug(D_OP | D_PC | D_I | D_SP | D_STACK | D_V | D_DT | D_ST);
+
+    // The debug output does not show the whole of memory or the display, so list where those differ
+    int shown = 0;
+    for (uint32_t a = 0; a < XO_MEMORY_SIZE && shown < 16; a++) {
+        if (run.reference.readMemory(a) != run.candidate.readMemory(a)) {
+            printf("memory[0x%04X]: reference 0x%02X, candidate 0x%02X\n", a, run.reference.readMemory(a), run.candidate.readMemory(a));
+            shown++;
+        }
+    }
+    for (unsigned int p = 0; p < PLANE_COUNT; p++) {
+        for (unsigned int y = 0; y < VIDEO_HEIGHT; y++) {
+            if (run.reference.video[p][y] != run.candidate.video[p][y]) {
+                printf("video plane %u row %u differs\n", p, y);
+                shown++;
+            }
+        }
+    }
+    if (!shown)
+        printf("Memory and display match, so the difference is in the registers above or in internal state (RNG, Fx0A key wait, XO-CHIP audio)\n");
+    printf("\n");
+    fflush(stdout);
+}
+
+
+Platform platformFor(const std::string &rom, const Options &options) {
+    if (options.platform >= 0)
+        return (Platform)options.platform;
+    return Chip8::platformFor(rom);
+}
+
+
+// Runs one ROM on both cores, returns false if they diverged (or the ROM could not be loaded)
+bool checkROM(const std::string &rom, const Options &options) {
+    Lockstep run;
+    Platform platform = platformFor(rom, options);
+
+    for (Chip8 *chip8 : {&run.reference, &run.candidate}) {
+        chip8->setPlatform(platform);
+        chip8->seed(1);
+        chip8->setSpeed(options.ips);
+    }
+    configureCandidate(run.candidate, options.candidate);
+
+    if (!run.reference.loadROM(rom.c_str()) || !run.candidate.loadROM(rom.c_str()))
+        return false;
+
+    Lockstep checkpoint = run;
+    while (true) {
+        bool running = advance(run, options.frames, options.checkInterval - run.instructions % options.checkInterval);
+        if (running && run.instructions % options.checkInterval)
+            continue;
+
+        if (!statesMatch(run)) {
+            // Go back to the last state that matched and find the exact instruction
+            // Stepping one instruction at a time could take the candidate down a different tier, so each try runs from the checkpoint the way the check did
+            for (unsigned long long count = 1; ; count++) {
+                run = checkpoint;
+                bool more = true;
+                while (more && run.instructions < checkpoint.instructions + count)
+                    more = advance(run, options.frames, checkpoint.instructions + count - run.instructions);
+                if (!more || !statesMatch(run))
+                    break;
+            }
+            reportDivergence(rom, run);
+            return false;
+        }
+
+        if (!running)
+            break;
+        checkpoint = run;
+    }
+
+    std::lock_guard<std::mutex> lock(outputLock);
+    printf("OK %s (%llu instructions)\n", rom.c_str(), run.instructions);
+    fflush(stdout);
+    return true;
+}
+
+
+int main(int argc, char **argv) {
+    Options options;
+    std::vector<std::string> roms;
+    unsigned int threads = std::max(1u, std::thread::hardware_concurrency());
+
+    for (int i = 1; i < argc; i++) {
+        if (!strcmp(argv[i], "--candidate") && i + 1 < argc) {
+            options.candidate = argv[++i];
+        } else if (!strcmp(argv[i], "--frames") && i + 1 < argc) {
+            options.frames = std::stoul(argv[++i]);
+        } else if (!strcmp(argv[i], "--check") && i + 1 < argc) {
+            options.checkInterval = std::max(1ul, std::stoul(argv[++i]));
+        } else if (!strcmp(argv[i], "--ips") && i + 1 < argc) {
+            options.ips = std::stoul(argv[++i]);
+        } else if (!strcmp(argv[i], "--threads") && i + 1 < argc) {
+            threads = std::max(1ul, std::stoul(argv[++i]));
+        } else if (!strcmp(argv[i], "--platform") && i + 1 < argc) {
+            Platform parsed;
+            if (!Chip8::parsePlatform(argv[++i], parsed)) {
+                std::cout << "ERROR: Unknown platform " << argv[i] << std::endl;
+                return 1;
+            }
+            options.platform = parsed;
+        } else if (std::filesystem::is_directory(argv[i])) {
+            for (const auto &entry : std::filesystem::recursive_directory_iterator(argv[i])) {
+                if (entry.is_regular_file())
+                    roms.push_back(entry.path().string());
+            }
+        } else {
+            roms.push_back(argv[i]);
+        }
+    }
+
+    Chip8 test;
+    if (roms.empty() || !configureCandidate(test, options.candidate)) {
+        std::cout << "ERROR: PROPER USAGE IS: ./lockstep <ROM or DIRECTORY>... [--candidate NAME] [--frames N] [--check N] [--ips N] [--threads N] [--platform chip8|schip|xochip]" << std::endl;
+        std::cout << "Candidates:";
+        for (const char *name : CANDIDATES)
+            std::cout << " " << name;
+        std::cout << std::endl;
+        return 1;
+    }
+    std::sort(roms.begin(), roms.end());
+
+    // Each thread takes the next unchecked ROM until there are none left
+    std::atomic<size_t> next(0);
+    std::atomic<unsigned int> failed(0);
+    std::vector<std::thread> workers;
+    for (unsigned int t = 0; t < std::min<size_t>(threads, roms.size()); t++) {
+        workers.emplace_back([&]() {
+            for (size_t i = next++; i < roms.size(); i = next++) {
+                if (!checkROM(roms[i], options))
+                    failed++;
+            }
+        });
+    }
+    for (std::thread &worker : workers)
+        worker.join();
+
+    printf("%zu ROMs checked, %u failed\n", roms.size(), failed.load());
+    return failed ? 1 : 0;
+}
@@ -1,38 +1,251 @@
 #include <SDL2/SDL.h>
 #include <cstdio> 
 #include <cstdint>
+#include <cstring>
 #include <chrono>
+#include <fstream>
+#include <vector>
+#include <thread>
+#include <atomic>
 #include "Chip8.hpp"
 #include "Chip8.cpp"
+#include "Audio.hpp"
+#include "Audio.cpp"
+#include "KeyMap.hpp"
+#include "KeyMap.cpp"
+#include "TripleBuffer.hpp"
+#include "SpscQueue.hpp"
+#include "InputScript.hpp"
+#include "InputScript.cpp"
+#include "Latency.hpp"
+#include "Latency.cpp"
+#include "Palette.hpp"
+#include "Palette.cpp"
+#include "SharedMemory.hpp"
+#include "SharedMemory.cpp"
+#include "Disassembler.hpp"
+#include "Disassembler.cpp"
+#include "Coverage.hpp"
+#include "Coverage.cpp"
+#include "Sha1.hpp"
+#include "Sha1.cpp"
+#include "ROMDatabase.hpp"
+#include "ROMDatabase.cpp"
 //https://github.com/Timendus/chip8-test-suite
 
-void setKeys(const Uint8 *keystate);
-void drawGraphics(SDL_Renderer *renderer);
-
-Chip8 chip8;
+// A finished frame, handed from the emulation thread to the SDL thread
+struct Frame {
+    VideoRow video[PLANE_COUNT][VIDEO_HEIGHT];
+    unsigned int width;                         // Resolution the frame was drawn in
+    unsigned int height;
+    LatencySample latency;                      // Most recent latency measurement, only used with --latency
+};
+
+// A key going down or up, handed from the SDL thread to the emulation thread
+struct KeyEvent {
+    uint8_t key;
+    bool pressed;
+};
+
+bool lookupROM(const char *databaseFile, const char *rom, ROMSettings &settings);
+void emulationLoop();
+int applyInput(uint64_t frame);
+bool applyCommands(uint64_t frame);
+LatencySample checkLatency(uint64_t frame);
+void updateSound();
+void drawGraphics(SDL_Renderer *renderer, SDL_Texture *texture, const Frame &frame);
+
+Chip8 chip8;                                    // Only touched by the emulation thread once it has started
+Beeper beeper;
+KeyMap keymap;
+InputScript script;
+LatencyProbe latency;
+SharedChannel shared;
+
+bool useScript = false;                         // Keys are also pressed by an input script (--script)
+bool measureLatency = false;                    // Measure input-to-photon latency (--latency)
+bool useShared = false;                         // Publish frames to and take commands from external tools (--shm)
+bool paused = false;                            // Paused by a tool, only touched by the emulation thread
+uint32_t stepFrames = 0;                        // Frames a tool asked to run while paused
+
+TripleBuffer<Frame> frames;                     // Emulation thread -> SDL thread
+SpscQueue<KeyEvent, 256> keyEvents;             // SDL thread -> emulation thread
+std::atomic<bool> running;
+
+Palette palette = DEFAULT_PALETTE;
+uint32_t pixels[VIDEO_WIDTH * VIDEO_HEIGHT];    // The display expanded to colours, only touched by the SDL thread
 
 const int PIXEL_SCALE = 10;
-const int SCREEN_WIDTH = VIDEO_WIDTH * PIXEL_SCALE;
-const int SCREEN_HEIGHT = VIDEO_HEIGHT * PIXEL_SCALE;
-const int TIMER_SPEED = 60;
+const int DEFAULT_INSTRUCTIONS_PER_SECOND = 700;    // Used when neither the command line nor the ROM database gives a speed
+const char *const DEFAULT_DATABASE = "romdb/romdb.bin";
+const int SCREEN_WIDTH = LORES_WIDTH * PIXEL_SCALE;
+const int SCREEN_HEIGHT = LORES_HEIGHT * PIXEL_SCALE;
 
 
 int main (int argc, char **argv) {
-    if (argc != 3) {
-        std::cout << "ERROR: PROPER USAGE IS: ./Chip8 <ROM_NAME> <INSTRUCTIONS_PER_SECOND> ";
+    if (argc < 2) {
+        std::cout << "ERROR: PROPER USAGE IS: ./Chip8 <ROM_NAME> [INSTRUCTIONS_PER_SECOND] [--headless <FRAMES>] [--seed <SEED>] [--wav <FILE>] [--keymap <FILE>] [--script <FILE>] [--latency] [--platform chip8|schip|xochip] [--quirks <LIST>] [--shm <NAME>] [--tier <THRESHOLD>] [--coverage <FILE>] [--romdb <FILE>|none]";
+        return 1;
+    }
+
+    // Anything not given on the command line is taken from the ROM database, if the ROM is in it
+    int instructionsPerSecond = 0;
+    int firstOption = 2;
+    if (argc > 2 && strncmp(argv[2], "--", 2)) {
+        instructionsPerSecond = std::stoi(argv[2]);
+        firstOption = 3;
+    }
+
+    // Optional arguments
+    long headlessFrames = -1;                   // Run without a window for this many frames, then print the display
+    const char *wavFile = NULL;                 // In headless mode, write the generated sound to this .wav file
+    bool tiered = false;                        // Predecode blocks entered THRESHOLD times, headless mode prints the tier counts at the end
+    const char *coverageFile = NULL;            // Write the addresses code ran from to this lcov tracefile when the run ends
+    Platform platform = PLATFORM_CHIP8;
+    bool platformGiven = false;
+    Quirks quirks;
+    bool quirksGiven = false;                   // --quirks replaces the platform's quirks
+    bool keymapGiven = false;
+    const char *databaseFile = DEFAULT_DATABASE;
+    for (int i = firstOption; i < argc; i++) {
+        if (!strcmp(argv[i], "--headless") && i + 1 < argc) {
+            headlessFrames = std::stol(argv[++i]);
+        } else if (!strcmp(argv[i], "--seed") && i + 1 < argc) {
+            chip8.seed(std::stoul(argv[++i]));
+        } else if (!strcmp(argv[i], "--wav") && i + 1 < argc) {
+            wavFile = argv[++i];
+        } else if (!strcmp(argv[i], "--keymap") && i + 1 < argc) {
+            if (!keymap.load(argv[++i]))
+                return 1;
+            keymapGiven = true;
+        } else if (!strcmp(argv[i], "--script") && i + 1 < argc) {
+            if (!script.load(argv[++i]))
+                return 1;
+            useScript = true;
+        } else if (!strcmp(argv[i], "--latency")) {
+            measureLatency = true;
+        } else if (!strcmp(argv[i], "--shm") && i + 1 < argc) {
+            if (!shared.create(argv[++i]))
+                return 1;
+            useShared = true;
+        } else if (!strcmp(argv[i], "--tier") && i + 1 < argc) {
+            chip8.setTiering(std::stoul(argv[++i]));
+            tiered = true;
+        } else if (!strcmp(argv[i], "--coverage") && i + 1 < argc) {
+            coverageFile = argv[++i];
+            chip8.setCoverage(true);
+        } else if (!strcmp(argv[i], "--platform") && i + 1 < argc) {
+            if (!Chip8::parsePlatform(argv[++i], platform)) {
+                std::cout << "ERROR: Unknown platform " << argv[i] << std::endl;
+                return 1;
+            }
+            platformGiven = true;
+        } else if (!strcmp(argv[i], "--quirks") && i + 1 < argc) {
+            if (!parseQuirks(argv[++i], quirks)) {
+                std::cout << "ERROR: Unknown quirk in " << argv[i] << std::endl;
+                return 1;
+            }
+            quirksGiven = true;
+        } else if (!strcmp(argv[i], "--romdb") && i + 1 < argc) {
+            databaseFile = argv[++i];
+        } else {
+            std::cout << "ERROR: Unknown argument " << argv[i] << std::endl;
+            return 1;
+        }
+    }
+
+    // The command line wins over the database, and the database's quirks were picked for its platform so they are dropped along with it
+    // The key map is only needed for a window
+    ROMSettings settings;
+    if (!lookupROM(databaseFile, argv[1], settings))
         return 1;
+    if (!platformGiven && (settings.settings & SETTING_PLATFORM))
+        platform = settings.platform;
+    if (!quirksGiven && (settings.settings & SETTING_QUIRKS) && (!(settings.settings & SETTING_PLATFORM) || settings.platform == platform)) {
+        quirks = settings.quirks;
+        quirksGiven = true;
     }
+    if (!instructionsPerSecond && (settings.settings & SETTING_IPS))
+        instructionsPerSecond = settings.ips;
+    if (!keymapGiven && headlessFrames < 0 && (settings.settings & SETTING_KEYMAP) && !keymap.load(settings.keymap.c_str()))
+        return 1;
+    if (settings.settings & SETTING_PALETTE)
+        palette = settings.palette;
 
+    chip8.setPlatform(platform);
+    if (quirksGiven)
+        chip8.setQuirks(quirks);
     if (!chip8.loadROM(argv[1]))
         return 1;
 
-    const int INSTRUCTIONS_PER_SECOND = std::stoi(argv[2]);
+    chip8.setSpeed(instructionsPerSecond ? instructionsPerSecond : DEFAULT_INSTRUCTIONS_PER_SECOND);
 
     //chip8.debug(D_MEM_ROM);
 
+
+    // Headless mode runs as fast as possible, timers are counted in executed instructions so the result is the same on every machine
+    // The sound is generated exactly as the audio callback would, one frame's worth of samples per frame
+    // With --latency there is nothing to present, so a changed frame counts as presented as soon as it is finished
+    // With --shm a paused run waits for the tool to resume or step it, a paused frame does not count towards <FRAMES>
+    if (headlessFrames >= 0) {
+        std::vector<int16_t> samples;
+        for (long frame = 0; frame < headlessFrames && !script.quitRequested(); frame++) {
+            if (useShared && !applyCommands(frame)) {
+                shared.publish(chip8, frame, paused);
+                std::this_thread::sleep_for(std::chrono::milliseconds(1));
+                frame--;
+                continue;
+            }
+
+            applyInput(frame);
+            chip8.emulateFrame();
+
+            if (measureLatency && chip8.drawFlag) {
+                latency.framePresented(checkLatency(frame));
+                chip8.drawFlag = false;
+            }
+
+            if (wavFile) {
+                updateSound();
+                samples.resize(samples.size() + AUDIO_SAMPLES_PER_FRAME);
+                beeper.generate(&samples[samples.size() - AUDIO_SAMPLES_PER_FRAME], AUDIO_SAMPLES_PER_FRAME);
+            }
+
+            if (useShared)
+                shared.publish(chip8, frame + 1, paused);
+        }
+
+        chip8.debug(D_VID);
+
+        if (chip8.getFault())
+            std::cout << "ERROR: " << chip8.getFault() << std::endl;
+
+        if (measureLatency)
+            latency.report();
+
+        if (tiered) {
+            TierStats tiers = chip8.getTierStats();
+            printf("interpreted %llu  predecoded %llu  native %llu instructions\n", (unsigned long long)tiers.interpreted,
+                   (unsigned long long)tiers.predecoded, (unsigned long long)tiers.native);
+            printf("%llu blocks promoted, %llu demoted\n", (unsigned long long)tiers.promoted, (unsigned long long)tiers.demoted);
+            printf("%llu instructions skipped working out a dead VF\n", (unsigned long long)tiers.dead_flags);
+            for (unsigned int f = 0; f < FUSION_COUNT; f++) {
+                if (tiers.fused[f])
+                    printf("fused %-12s %llu instructions (%.1f%% of predecoded)\n", FUSION_NAMES[f], (unsigned long long)tiers.fused[f], 100.0 * tiers.fused[f] / tiers.predecoded);
+            }
+        }
+
+        shared.close();
+        if (wavFile && !writeWAV(wavFile, samples))
+            return 1;
+        if (coverageFile && !writeCoverage(coverageFile, {collectCoverage(argv[1], chip8, platform)}))
+            return 1;
+        return 0;
+    }
+
     // Initialize SDL
 
-    if (SDL_Init(SDL_INIT_VIDEO) < 0) {
+    if (SDL_Init(SDL_INIT_VIDEO | SDL_INIT_AUDIO) < 0) {
         std::cout << "ERROR: SDL failed to initialize\nSDL Error: " << SDL_GetError() << std::endl;
         return 1;
     }
@@ -43,113 +256,265 @@ int main (int argc, char **argv) {
         return 1;
     }
 
-    SDL_Renderer *renderer = SDL_CreateRenderer(window, -1, SDL_RENDERER_ACCELERATED);
+    SDL_Renderer *renderer = SDL_CreateRenderer(window, -1, SDL_RENDERER_ACCELERATED | SDL_RENDERER_PRESENTVSYNC);
     if(!renderer){
         std::cout << "ERROR: Failed to create renderer\nSDL Error: " << SDL_GetError() << std::endl;
         return 1;
     }
 
+    // The display is uploaded as one texture and scaled up by the renderer, only the part used by the current resolution is drawn
+    SDL_Texture *texture = SDL_CreateTexture(renderer, SDL_PIXELFORMAT_ARGB8888, SDL_TEXTUREACCESS_STREAMING, VIDEO_WIDTH, VIDEO_HEIGHT);
+    if (!texture) {
+        std::cout << "ERROR: Failed to create texture\nSDL Error: " << SDL_GetError() << std::endl;
+        return 1;
+    }
+
+    // Not being able to play sound is not fatal, the emulator just runs silently
+    beeper.open();
 
 
-    // Delay/sound timers and cpu run at different speeds, so two seperate timers will be used
-    auto timerStart = std::chrono::high_resolution_clock::now();        // Run at 60hz                
-    auto cpuStart = std::chrono::high_resolution_clock::now();          // Speed will depend on the ROM and is configurable                                   
-    
-    // Main emulator loop
-    const Uint8 *keystate;
-    bool running = true;
+
+    // The emulator runs on its own thread so a slow SDL_RenderPresent() (e.g. waiting on vsync or a stalled compositor) never delays emulation
+    // This thread only handles SDL events and presents whatever frame was finished most recently
+    running = true;
+    std::thread emulation(emulationLoop);
+
     while(running) {
 
-        // Handle events
+        // Handle events, waiting a little for one so the loop does not spin while there is nothing to draw
         SDL_Event event;
-        while (SDL_PollEvent(&event)) {
-            switch (event.type) {
-                case SDL_QUIT :
-                    running = false;
-                    break;
-
-                default :
-                    break;
-            }
+        if (SDL_WaitEventTimeout(&event, 1)) {
+            do {
+                switch (event.type) {
+                    case SDL_QUIT :
+                        running = false;
+                        break;
+
+                    // The keypad only changes when a key actually goes down or up
+                    case SDL_KEYDOWN :
+                    case SDL_KEYUP : {
+                        if (event.key.repeat)
+                            break;
+
+                        int key = keymap.lookup(event.key.keysym.scancode);
+                        if (key >= 0)
+                            keyEvents.push({(uint8_t)key, event.type == SDL_KEYDOWN});
+                        break;
+                    }
+
+                    default :
+                        break;
+                }
+            } while (SDL_PollEvent(&event));
         }
 
-        setKeys(keystate);
+        if (frames.update()) {
+            drawGraphics(renderer, texture, frames.readBuffer());
 
-        // CPU delay is configurable based on the ROM being used, every (1 / INSTRUCTIONS_PER_SECOND) of a second run emulateCycle()
-        auto cpuCurrent = std::chrono::high_resolution_clock::now();
-        float cpuDiff = std::chrono::duration<float, std::chrono::seconds::period>(cpuCurrent - cpuStart).count();
-        if (cpuDiff > 1.0 / INSTRUCTIONS_PER_SECOND) {
-            cpuStart = cpuCurrent;
-            chip8.emulateCycle();
+            if (measureLatency)
+                latency.framePresented(frames.readBuffer().latency);
         }
+    }
+
+    emulation.join();
+
+    if (chip8.getFault())
+        std::cout << "ERROR: " << chip8.getFault() << std::endl;
+
+    if (measureLatency)
+        latency.report();
+
+    shared.close();
+    beeper.close();
+    SDL_Quit();
+    if (coverageFile && !writeCoverage(coverageFile, {collectCoverage(argv[1], chip8, platform)}))
+        return 1;
+    return 0;
+}
+
+
+// Finds the ROM's record in the database, settings.settings is left 0 if it is not there
+// A missing default database is not an error, the emulator then runs with the command line settings alone
+bool lookupROM(const char *databaseFile, const char *rom, ROMSettings &settings) {
+    settings.settings = 0;
+    if (!strcmp(databaseFile, "none"))
+        return true;
+
+    ROMDatabase database;
+    if (databaseFile == DEFAULT_DATABASE) {
+        std::ifstream exists(databaseFile);
+        if (!exists)
+            return true;
+    }
+    if (!database.load(databaseFile))
+        return false;
+
+    std::ifstream file(rom, std::ios::binary);
+    std::vector<uint8_t> data((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+    if (file.bad() || !database.find(data.data(), data.size(), settings))
+        return true;                            // loadROM() reports a ROM that cannot be read
 
-        // Timers update at 60hz, every 1/60 of a second run updateTimers()
-        auto timerCurrent = std::chrono::high_resolution_clock::now();
-        float timerDiff = std::chrono::duration<float, std::chrono::seconds::period>(timerCurrent - timerStart).count();
-        if (timerDiff >= 1.0 / TIMER_SPEED) {
-            timerStart = timerCurrent;
-            chip8.updateTimers();
+    std::cout << "ROM database: " << (settings.title.empty() ? rom : settings.title.c_str()) << std::endl;
+    return true;
+}
+
+
+// Runs on the emulation thread
+// Every 1/60 of a second: apply key events, run one frame of instructions and publish the display if it changed
+// Frames are scheduled against a fixed timeline so the emulated speed stays steady even if one frame is late
+// While a tool has paused emulation the frame count stands still, but the state keeps being published so the tool sees the pause
+void emulationLoop() {
+    const std::chrono::nanoseconds FRAME_TIME(1000000000 / TIMER_FREQUENCY);
+    auto nextFrame = std::chrono::steady_clock::now();
+    LatencySample lastSample{};
+
+    for (uint64_t frame = 0; running; frame++) {
+        if (useShared && !applyCommands(frame)) {
+            beeper.setTone(false);
+            shared.publish(chip8, frame, paused);
+            frame--;
+
+            nextFrame += FRAME_TIME;
+            std::this_thread::sleep_until(nextFrame);
+            continue;
         }
 
+        applyInput(frame);
+        if (script.quitRequested())
+            running = false;
+
+        chip8.emulateFrame();
+        updateSound();
+
         if (chip8.drawFlag) {
-            drawGraphics(renderer);
+            // Every frame carries the latest sample in case the frame it was first sent with is never presented
+            if (measureLatency) {
+                LatencySample sample = checkLatency(frame);
+                if (sample.valid)
+                    lastSample = sample;
+            }
+
+            Frame &out = frames.writeBuffer();
+            memcpy(out.video, chip8.video, sizeof(chip8.video));
+            out.width = chip8.screenWidth();
+            out.height = chip8.screenHeight();
+            out.latency = lastSample;
+            frames.publish();
             chip8.drawFlag = false;
         }
 
+        if (useShared)
+            shared.publish(chip8, frame + 1, paused);
+
+        // If the thread fell behind by more than a few frames (e.g. the machine was suspended), start a new timeline instead of racing to catch up
+        nextFrame += FRAME_TIME;
+        auto now = std::chrono::steady_clock::now();
+        if (now - nextFrame > 4 * FRAME_TIME)
+            nextFrame = now;
+        std::this_thread::sleep_until(nextFrame);
     }
-    
-    SDL_Quit();
-    return 0;
 }
 
 
-// Set the keys that were pressed
-void setKeys(const Uint8 *keystate) {
-    keystate = SDL_GetKeyboardState(NULL);
-
-    chip8.keypad[0x0] = keystate[SDL_SCANCODE_0];
-    chip8.keypad[0x1] = keystate[SDL_SCANCODE_1];
-    chip8.keypad[0x2] = keystate[SDL_SCANCODE_2];
-    chip8.keypad[0x3] = keystate[SDL_SCANCODE_3];
-    chip8.keypad[0x4] = keystate[SDL_SCANCODE_4];
-    chip8.keypad[0x5] = keystate[SDL_SCANCODE_5];
-    chip8.keypad[0x6] = keystate[SDL_SCANCODE_6];
-    chip8.keypad[0x7] = keystate[SDL_SCANCODE_7];
-    chip8.keypad[0x8] = keystate[SDL_SCANCODE_8];
-    chip8.keypad[0x9] = keystate[SDL_SCANCODE_9];
-    chip8.keypad[0xA] = keystate[SDL_SCANCODE_A];
-    chip8.keypad[0xB] = keystate[SDL_SCANCODE_B];
-    chip8.keypad[0xC] = keystate[SDL_SCANCODE_C];
-    chip8.keypad[0xD] = keystate[SDL_SCANCODE_D];
-    chip8.keypad[0xE] = keystate[SDL_SCANCODE_E];
-    chip8.keypad[0xF] = keystate[SDL_SCANCODE_F];
-        
-}
+// Applies queued key events from the SDL thread and any scripted key events for this frame
+// Returns how many keys changed, which starts a latency measurement when --latency is used
+int applyInput(uint64_t frame) {
+    int changed = 0;
 
+    KeyEvent keyEvent;
+    while (keyEvents.pop(keyEvent)) {
+        if (chip8.keypad[keyEvent.key] != keyEvent.pressed) {
+            chip8.setKey(keyEvent.key, keyEvent.pressed);
+            changed++;
+        }
+    }
 
-// Draw each pixel to the screen
-// Pixels are 10x10 in size
-// Total screen resolution is 640x320
-void drawGraphics(SDL_Renderer *renderer) {
-    // Black background
-    SDL_SetRenderDrawColor(renderer, 0, 0, 0, 255);
-    SDL_RenderClear(renderer);
+    if (useScript)
+        changed += script.apply(chip8, frame);
+
+    if (measureLatency && changed)
+        latency.keyApplied(frame);
+    return changed;
+}
 
-    // Draw each white pixel
-    SDL_SetRenderDrawColor(renderer, 255, 255, 255, 255);
-    for (int i = 0; i < VIDEO_WIDTH * VIDEO_HEIGHT; i++) {
-        if (chip8.video[i]) {
-            int x = (i % VIDEO_WIDTH) * PIXEL_SCALE;
-            int y = (i / VIDEO_WIDTH) * PIXEL_SCALE;
 
-            SDL_Rect rect = {x, y, 10, 10};
-            SDL_RenderDrawRect(renderer, &rect);
-            SDL_RenderFillRect(renderer, &rect);
+// Applies the commands tools sent over --shm
+// Returns whether a frame should be run, false while paused with no steps left
+bool applyCommands(uint64_t frame) {
+    SharedCommand command;
+    while (shared.popCommand(command)) {
+        switch (command.type) {
+            case COMMAND_KEY :
+                if (command.key < KEY_COUNT)
+                    chip8.setKey(command.key, command.pressed);
+                break;
+
+            case COMMAND_PAUSE :
+                paused = true;
+                stepFrames = 0;
+                break;
+
+            case COMMAND_RESUME :
+                paused = false;
+                break;
+
+            case COMMAND_STEP :
+                stepFrames += command.count;
+                break;
+
+            case COMMAND_SNAPSHOT :
+                shared.publishSnapshot(chip8, frame);
+                break;
+
+            default :
+                break;
         }
     }
 
-    // Render the current scene
-    SDL_RenderPresent(renderer);
+    if (!paused)
+        return true;
+    if (stepFrames) {
+        stepFrames--;
+        return true;
+    }
+    return false;
+}
+
+
+// Called when the display may have changed (the draw flag is set)
+// Returns a completed latency sample if the pixels really did change and a key change was waiting on it
+LatencySample checkLatency(uint64_t frame) {
+    static VideoRow lastVideo[PLANE_COUNT][VIDEO_HEIGHT];
+
+    if (!memcmp(lastVideo, chip8.video, sizeof(lastVideo)))
+        return LatencySample{};
+
+    memcpy(lastVideo, chip8.video, sizeof(lastVideo));
+    return latency.frameChanged(frame);
+}
+
+
+// Hands the sound state to the beeper: the sound timer, and the XO-CHIP audio pattern once one has been loaded
+void updateSound() {
+    beeper.setTone(chip8.isSoundPlaying());
+
+    if (chip8.hasAudioPattern())
+        beeper.setPattern(chip8.getAudioPattern(), chip8.getAudioPatternRate());
 }
 
 
+// Draw each pixel to the screen
+// Pixels are 10x10 in size (5x5 in high resolution)
+// Total screen resolution is 640x320
+// Both bitplanes are expanded to colours on the CPU, then the texture is scaled up to fill the window
+void drawGraphics(SDL_Renderer *renderer, SDL_Texture *texture, const Frame &frame) {
+    expandPalette(frame.video, frame.width, frame.height, palette, pixels, VIDEO_WIDTH);
+
+    SDL_Rect source = {0, 0, (int)frame.width, (int)frame.height};
+    SDL_UpdateTexture(texture, &source, pixels, VIDEO_WIDTH * sizeof(uint32_t));
+
+    // Render the current scene
+    SDL_RenderClear(renderer);
+    SDL_RenderCopy(renderer, texture, &source, NULL);
+    SDL_RenderPresent(renderer);
+}
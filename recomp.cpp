@@ -0,0 +1,906 @@
+#include <cstdio>
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <vector>
+#include <set>
+#include <algorithm>
+#include <filesystem>
+#include "Chip8.hpp"
+#include "Chip8.cpp"
+
+// chip8_recomp: ahead-of-time recompiler from a ROM to a C++ translation unit
+// Build: g++ -O2 -std=c++17 recomp.cpp -o chip8_recomp
+// Usage: ./chip8_recomp <ROM> [-o FILE] [--name NAME] [--platform chip8|schip|xochip]
+//
+// The code reachable from 0x200 is found by following jumps, calls, returns and skips, and split into basic blocks
+// Each block becomes one function that keeps the V registers it uses in locals, the instructions that touch the display,
+// memory, the stack or the random number generator call the interpreter's own opcode functions so they behave exactly the same
+// Blocks go on to the next one through a switch on PC in run(), and any address that is not the start of a block is interpreted
+// Writing over code marks its page in the machine (see Chip8::storeMemory()), a block on a marked page checks its bytes are still the ROM's before it runs
+// and leaves them to the interpreter if they are not, so self-modifying code only gives up the blocks it changed
+//
+// The output is used by including it after Chip8.cpp and calling chip8.setCompiledROM(&compiled_NAME), emulateFrame() then runs it
+// Building the output with -DCHIP8_RECOMP_MAIN gives a checker that runs the ROM interpreted and compiled side by side, comparing
+// the state hash after every frame, and then times both:
+//   g++ -O2 -I. -DCHIP8_RECOMP_MAIN pong.cpp -o pong_check && ./pong_check [FRAMES] [IPS]
+// Without --platform, the platform is picked from the file extension: .sc8 is SUPER-CHIP, .xo8 is XO-CHIP and anything else is CHIP-8
+
+const uint32_t PROGRAM_START = 0x200;
+
+
+// What the generated code does for an instruction
+enum Kind {
+    K_NOP,                                                  // Does nothing on this platform
+    K_LOAD,                                                 // 6xkk
+    K_ADD,                                                  // 7xkk
+    K_MOVE,                                                 // 8xy0
+    K_OR,                                                   // 8xy1
+    K_AND,                                                  // 8xy2
+    K_XOR,                                                  // 8xy3
+    K_ADDV,                                                 // 8xy4
+    K_SUB,                                                  // 8xy5
+    K_SHR,                                                  // 8xy6
+    K_SUBN,                                                 // 8xy7
+    K_SHL,                                                  // 8xyE
+    K_LOADI,                                                // Annn
+    K_LOADI_LONG,                                           // F000 nnnn (XO-CHIP)
+    K_GETDT,                                                // Fx07
+    K_SETDT,                                                // Fx15
+    K_SETST,                                                // Fx18
+    K_ADDI,                                                 // Fx1E
+
+    K_INTERPRET,                                            // Run by the interpreter, then the block carries on
+    K_INTERPRET_STORE,                                      // The same, but it writes memory so it may have written over code
+    K_INTERPRET_EXIT,                                       // Run by the interpreter, then the block ends wherever it left PC (2nnn, 00EE, 00FD, Bnnn, Fx0A)
+
+    K_JUMP,                                                 // 1nnn
+    K_SKIP_EQ_BYTE,                                         // 3xkk
+    K_SKIP_NE_BYTE,                                         // 4xkk
+    K_SKIP_EQ,                                              // 5xy0
+    K_SKIP_NE,                                              // 9xy0
+    K_SKIP_KEY,                                             // Ex9E
+    K_SKIP_NOT_KEY                                          // ExA1
+};
+
+
+struct Instruction {
+    uint32_t address;
+    uint16_t opcode;
+    uint16_t operand;                                       // Address loaded by F000 nnnn
+    uint32_t length;                                        // 2, or 4 for F000 nnnn
+    Kind kind;
+    uint32_t skip;                                          // Where a skip goes when it skips
+};
+
+
+struct Program {
+    std::string name;                                       // Identifier the generated symbols are named after
+    std::string file;
+    Platform platform;
+    std::vector<uint8_t> rom;
+    uint32_t memory_size;
+
+    std::vector<bool> decoded;                              // One per address, true if an instruction starting there was decoded
+    std::vector<Instruction> instructions;                  // Indexed by address
+    std::set<uint32_t> leaders;                             // Addresses a block starts at
+    std::vector<uint64_t> code;                             // One bit per ROM byte translated
+};
+
+
+
+
+// Mirrors Chip8::setupOpcodeTables(), so an opcode does here whatever it does in the interpreter on the same platform
+Kind classify(uint16_t opcode, Platform platform) {
+    bool schip = platform == PLATFORM_SCHIP || platform == PLATFORM_XOCHIP;
+    bool xochip = platform == PLATFORM_XOCHIP;
+    uint8_t low = opcode & 0xFF;
+    uint8_t nibble = opcode & 0xF;
+
+    switch (opcode >> 12) {
+        case 0x0 :
+            if (low == 0xE0)
+                return K_INTERPRET;
+            if (low == 0xEE)
+                return K_INTERPRET_EXIT;
+            if (schip && ((low & 0xF0) == 0xC0 || low == 0xFB || low == 0xFC || low == 0xFE || low == 0xFF))
+                return K_INTERPRET;
+            if (schip && low == 0xFD)
+                return K_INTERPRET_EXIT;
+            if (xochip && (low & 0xF0) == 0xD0)
+                return K_INTERPRET;
+            return K_NOP;
+
+        case 0x1 : return K_JUMP;
+        case 0x2 : return K_INTERPRET_EXIT;
+        case 0x3 : return K_SKIP_EQ_BYTE;
+        case 0x4 : return K_SKIP_NE_BYTE;
+
+        case 0x5 :
+            if (nibble == 0x0)
+                return K_SKIP_EQ;
+            if (xochip && nibble == 0x2)
+                return K_INTERPRET_STORE;
+            if (xochip && nibble == 0x3)
+                return K_INTERPRET;
+            return K_NOP;
+
+        case 0x6 : return K_LOAD;
+        case 0x7 : return K_ADD;
+
+        case 0x8 :
+            switch (nibble) {
+                case 0x0 : return K_MOVE;
+                case 0x1 : return K_OR;
+                case 0x2 : return K_AND;
+                case 0x3 : return K_XOR;
+                case 0x4 : return K_ADDV;
+                case 0x5 : return K_SUB;
+                case 0x6 : return K_SHR;
+                case 0x7 : return K_SUBN;
+                case 0xE : return K_SHL;
+                default : return K_NOP;
+            }
+
+        case 0x9 : return K_SKIP_NE;
+        case 0xA : return K_LOADI;
+        case 0xB : return K_INTERPRET_EXIT;
+        case 0xC : return K_INTERPRET;
+        case 0xD : return K_INTERPRET;
+
+        case 0xE :
+            if (nibble == 0xE)
+                return K_SKIP_KEY;
+            if (nibble == 0x1)
+                return K_SKIP_NOT_KEY;
+            return K_NOP;
+
+        default :
+            switch (low) {
+                case 0x07 : return K_GETDT;
+                case 0x0A : return K_INTERPRET_EXIT;
+                case 0x15 : return K_SETDT;
+                case 0x18 : return K_SETST;
+                case 0x1E : return K_ADDI;
+                case 0x29 : return K_INTERPRET;
+                case 0x33 : return K_INTERPRET_STORE;
+                case 0x55 : return K_INTERPRET_STORE;
+                case 0x65 : return K_INTERPRET;
+            }
+            if (schip && (low == 0x30 || low == 0x75 || low == 0x85))
+                return K_INTERPRET;
+            if (xochip && low == 0x00)
+                return (opcode & 0x0F00) ? K_NOP : K_LOADI_LONG;
+            if (xochip && (low == 0x01 || low == 0x02 || low == 0x3A))
+                return K_INTERPRET;
+            return K_NOP;
+    }
+}
+
+
+bool isSkip(Kind kind) {
+    return kind >= K_SKIP_EQ_BYTE;
+}
+
+
+bool endsBlock(Kind kind) {
+    return kind >= K_INTERPRET_EXIT;
+}
+
+
+bool inROM(const Program &program, uint32_t address, uint32_t length) {
+    return address >= PROGRAM_START && address + length <= PROGRAM_START + program.rom.size();
+}
+
+
+uint8_t romByte(const Program &program, uint32_t address) {
+    return program.rom[address - PROGRAM_START];
+}
+
+
+void markCode(Program &program, uint32_t address, uint32_t length) {
+    for (uint32_t a = address; a < address + length; a++) {
+        uint32_t offset = a - PROGRAM_START;
+        program.code[offset / 64] |= 1ull << (offset % 64);
+    }
+}
+
+
+
+
+// Decodes the instruction at address, false if it is not entirely inside the ROM
+// A skip's target depends on the instruction after it on XO-CHIP, so that has to be in the ROM too or the skip is left to the interpreter
+bool decode(Program &program, uint32_t address) {
+    if (!inROM(program, address, 2))
+        return false;
+
+    Instruction &in = program.instructions[address];
+    in.address = address;
+    in.opcode = (romByte(program, address) << 8) | romByte(program, address + 1);
+    in.kind = classify(in.opcode, program.platform);
+    in.length = 2;
+
+    if (in.kind == K_LOADI_LONG) {
+        if (!inROM(program, address, 4))
+            return false;
+        in.operand = (romByte(program, address + 2) << 8) | romByte(program, address + 3);
+        in.length = 4;
+    }
+
+    if (isSkip(in.kind)) {
+        uint32_t next = address + 2;
+        uint32_t skipped = 2;
+        if (program.platform == PLATFORM_XOCHIP) {
+            if (!inROM(program, next, 2)) {
+                in.kind = K_INTERPRET_EXIT;
+            } else if (romByte(program, next) == 0xF0 && romByte(program, next + 1) == 0x00) {
+                skipped = 4;
+            }
+        }
+        in.skip = (next + skipped) & (program.memory_size - 1);
+    }
+
+    program.decoded[address] = true;
+    return true;
+}
+
+
+bool isCode(const Program &program, uint32_t address) {
+    uint32_t offset = address - PROGRAM_START;
+    return (program.code[offset / 64] >> (offset % 64)) & 1;
+}
+
+
+// Adds a block starting at target and follows the code from there
+void branch(Program &program, std::vector<uint32_t> &work, uint32_t target) {
+    target &= program.memory_size - 1;
+    program.leaders.insert(target);
+    work.push_back(target);
+}
+
+
+void follow(Program &program, std::vector<uint32_t> &work) {
+    while (!work.empty()) {
+        uint32_t address = work.back();
+        work.pop_back();
+        if (program.decoded[address] || !decode(program, address))
+            continue;
+
+        const Instruction &in = program.instructions[address];
+        markCode(program, address, in.length);
+        uint32_t next = address + in.length;
+
+        if (in.kind == K_JUMP) {
+            branch(program, work, in.opcode & 0x0FFF);
+        } else if (isSkip(in.kind)) {
+            if (inROM(program, next, 2))
+                markCode(program, next, 2);                 // Whether the next instruction is F000 decides where the skip goes
+            branch(program, work, next);
+            branch(program, work, in.skip);
+        } else if (in.kind == K_INTERPRET_EXIT) {
+            if ((in.opcode & 0xF000) == 0x2000) {
+                branch(program, work, in.opcode & 0x0FFF);
+                branch(program, work, next);                // Where the subroutine returns to
+            } else if ((in.opcode & 0xF0FF) == 0xF00A) {
+                branch(program, work, next);
+            }
+        } else {
+            work.push_back(next & (program.memory_size - 1));
+        }
+    }
+}
+
+
+// Follows every path out of 0x200 that does not go through a computed jump
+// Code that is only reached through a computed jump or a jump the program writes into memory is not found that way,
+// so afterwards every even address that is still untranslated starts a block of its own and is followed in the same way
+// Some of those blocks are data, which only costs code size as PC never lands on them
+void findCode(Program &program) {
+    program.decoded.assign(program.memory_size, false);
+    program.instructions.assign(program.memory_size, Instruction());
+    program.code.assign((program.rom.size() + 63) / 64, 0);
+
+    std::vector<uint32_t> work;
+    branch(program, work, PROGRAM_START);
+    follow(program, work);
+
+    for (uint32_t address = PROGRAM_START; address + 2 <= PROGRAM_START + program.rom.size(); address += 2) {
+        if (!isCode(program, address)) {
+            branch(program, work, address);
+            follow(program, work);
+        }
+    }
+
+    // Leaders that fell outside the ROM are left to the interpreter
+    for (auto it = program.leaders.begin(); it != program.leaders.end();) {
+        if (program.decoded[*it])
+            it++;
+        else
+            it = program.leaders.erase(it);
+    }
+}
+
+
+
+
+// Writes one block's function
+// left is how many instructions the frame has left, at least 1, the block stops early when it runs out and returns how many are still left
+// A block returns left unchanged when it did not run at all, because its code was written over
+// A block never calls the next one, it leaves PC at it and returns to run(), which picks the block with a switch on PC
+// So the stack stays flat however many blocks a frame runs, and the code is correct at any optimisation level
+class BlockWriter {
+    public:
+        BlockWriter(FILE *out, const Program &program) : out(out), program(program) {}
+
+        // Returns the number of instructions in the block
+        unsigned int write(uint32_t start, unsigned int &interpreted) {
+            std::vector<const Instruction *> block;
+            for (uint32_t address = start;;) {
+                const Instruction &in = program.instructions[address];
+                block.push_back(&in);
+                address = (address + in.length) & (program.memory_size - 1);
+                if (endsBlock(in.kind) || !program.decoded[address] || program.leaders.count(address))
+                    break;
+            }
+
+            uint16_t used = 0;
+            for (const Instruction *in : block) {
+                used |= registersUsed(*in);
+            }
+
+            // The bytes the block was translated from, including the instruction after a skip as that decides where it goes on XO-CHIP
+            uint32_t end = start;
+            for (const Instruction *in : block) {
+                end = std::max(end, in->address + (isSkip(in->kind) ? 4 : in->length));
+            }
+            end = std::min(end, PROGRAM_START + (uint32_t)program.rom.size());
+            first_page = start / MEMORY_PAGE_SIZE;
+            last_page = (end - 1) / MEMORY_PAGE_SIZE;
+
+            const Instruction &last = *block.back();
+            fprintf(out, "    // 0x%04X - 0x%04X\n", start, last.address + last.length - 1);
+            fprintf(out, "    static unsigned int block_%04X(Chip8 &c, unsigned int left) {\n", start);
+
+            // A block that goes back to its own start loops in place, it is checked again each time round as it may have written over itself
+            bool idle = block.size() == 1 && last.kind == K_JUMP && (last.opcode & 0x0FFF) == start;
+            block_start = start;
+            if (goesTo(last, start) && !idle)
+                fprintf(out, "    loop:\n");
+            fprintf(out, "        if ((%s) && !unchanged(c, 0x%04X, %u))\n", pagesWritten().c_str(), start, end - start);
+            fprintf(out, "            return left;\n");
+
+            // A jump to itself is an idle loop, it would only run until the frame is over
+            if (idle) {
+                fprintf(out, "        c.opcode = 0x%04X;\n", last.opcode);
+                fprintf(out, "        return 0;\n");
+                fprintf(out, "    }\n\n");
+                return 1;
+            }
+
+            cached = used;
+            dirty = 0;
+            for (unsigned int r = 0; r < REGISTER_COUNT; r++) {
+                if (used & (1 << r))
+                    fprintf(out, "        uint8_t v%X = c.V[0x%X];\n", r, r);
+            }
+
+            uint16_t previous = 0;
+            for (unsigned int k = 0; k < block.size(); k++) {
+                const Instruction &in = *block[k];
+                if (k > 0) {
+                    fprintf(out, "        if (left == %u) {\n", k);
+                    flush("            ");
+                    fprintf(out, "            c.pc = 0x%04X; c.opcode = 0x%04X; return 0;\n", in.address, previous);
+                    fprintf(out, "        }\n");
+                }
+                fprintf(out, "        // 0x%04X  %04X\n", in.address, in.opcode);
+                if (in.kind >= K_INTERPRET && in.kind <= K_INTERPRET_EXIT)
+                    interpreted++;
+                writeInstruction(in, k + 1);
+                previous = in.opcode;
+            }
+
+            if (!endsBlock(last.kind)) {
+                flush("        ");
+                next(last, (last.address + last.length) & (program.memory_size - 1), block.size(), "        ");
+            }
+            fprintf(out, "    }\n\n");
+            return block.size();
+        }
+
+    private:
+        FILE *out;
+        const Program &program;
+        uint16_t cached;                                    // Registers held in locals
+        uint16_t dirty;                                     // Locals changed since they were last written back
+        uint32_t block_start;
+        uint32_t first_page;                                // Memory pages the block was translated from
+        uint32_t last_page;
+
+
+        std::string pagesWritten() {
+            std::string test;
+            for (uint32_t page = first_page; page <= last_page; page++) {
+                test += (test.empty() ? "" : " || ") + std::string("written(c, 0x") + hex(page) + ")";
+            }
+            return test;
+        }
+
+
+        static std::string hex(uint32_t value) {
+            char text[16];
+            snprintf(text, sizeof(text), "%02X", value);
+            return text;
+        }
+
+
+        // Registers an instruction reads or writes through a local
+        uint16_t registersUsed(const Instruction &in) {
+            uint16_t x = 1 << ((in.opcode >> 8) & 0xF);
+            uint16_t y = 1 << ((in.opcode >> 4) & 0xF);
+            uint16_t f = 1 << 0xF;
+
+            switch (in.kind) {
+                case K_LOAD : case K_ADD : case K_GETDT : case K_SETDT : case K_SETST : case K_ADDI :
+                case K_SKIP_EQ_BYTE : case K_SKIP_NE_BYTE : case K_SKIP_KEY : case K_SKIP_NOT_KEY :
+                    return x;
+                case K_MOVE :
+                    return x | y;
+                case K_SKIP_EQ : case K_SKIP_NE :
+                    return x == y ? 0 : x | y;              // 5xx0 and 9xx0 do not look at the register
+                case K_OR : case K_AND : case K_XOR :
+                    return x | y | (program.platform == PLATFORM_CHIP8 ? f : 0);
+                case K_ADDV : case K_SUB : case K_SUBN :
+                    return x | y | f;
+                case K_SHR : case K_SHL :
+                    return x | (program.platform == PLATFORM_XOCHIP ? y : 0) | f;     // Vy is only read with the shift_vy quirk
+                default :
+                    return 0;
+            }
+        }
+
+
+        void flush(const char *indent) {
+            for (unsigned int r = 0; r < REGISTER_COUNT; r++) {
+                if (dirty & (1 << r))
+                    fprintf(out, "%sc.V[0x%X] = v%X;\n", indent, r, r);
+            }
+        }
+
+
+        // The interpreter may read or change any register, so the locals are written back first and read again after
+        void interpret(const Instruction &in) {
+            flush("        ");
+            dirty = 0;
+            fprintf(out, "        interpret(c, 0x%04X, 0x%04X);\n", (in.address + 2) & (program.memory_size - 1), in.opcode);
+        }
+
+
+        void reload() {
+            for (unsigned int r = 0; r < REGISTER_COUNT; r++) {
+                if (cached & (1 << r))
+                    fprintf(out, "        v%X = c.V[0x%X];\n", r, r);
+            }
+        }
+
+
+        // True if the last instruction of a block may go on to target
+        bool goesTo(const Instruction &last, uint32_t target) {
+            if (last.kind == K_JUMP)
+                return (last.opcode & 0x0FFF) == target;
+            if (isSkip(last.kind))
+                return last.skip == target || ((last.address + 2) & (program.memory_size - 1)) == target;
+            return false;
+        }
+
+
+        // Goes on to target after count instructions of the block
+        void next(const Instruction &in, uint32_t target, unsigned int count, const char *indent) {
+            fprintf(out, "%sc.pc = 0x%04X;\n", indent, target);
+            fprintf(out, "%sc.opcode = 0x%04X;\n", indent, in.opcode);
+            if (target == block_start) {
+                fprintf(out, "%sleft -= %u;\n", indent, count);
+                fprintf(out, "%sif (!left) return 0;\n", indent);
+                fprintf(out, "%sgoto loop;\n", indent);
+            } else {
+                fprintf(out, "%sreturn left - %u;\n", indent, count);
+            }
+        }
+
+
+        void set(int r) {
+            dirty |= 1 << r;
+        }
+
+
+        void writeInstruction(const Instruction &in, unsigned int count) {
+            int x = (in.opcode >> 8) & 0xF;
+            int y = (in.opcode >> 4) & 0xF;
+            unsigned int kk = in.opcode & 0xFF;
+            unsigned int nnn = in.opcode & 0xFFF;
+            bool vfReset = program.platform == PLATFORM_CHIP8;       // The quirks Chip8::setPlatform() picks
+            bool shiftVy = program.platform == PLATFORM_XOCHIP;
+
+            switch (in.kind) {
+                case K_NOP :
+                    break;
+                case K_LOAD :
+                    fprintf(out, "        v%X = 0x%02X;\n", x, kk);
+                    set(x);
+                    break;
+                case K_ADD :
+                    fprintf(out, "        v%X += 0x%02X;\n", x, kk);
+                    set(x);
+                    break;
+                case K_MOVE :
+                    fprintf(out, "        v%X = v%X;\n", x, y);
+                    set(x);
+                    break;
+                case K_OR : case K_AND : case K_XOR :
+                    fprintf(out, "        v%X %s= v%X;\n", x, in.kind == K_OR ? "|" : in.kind == K_AND ? "&" : "^", y);
+                    set(x);
+                    if (vfReset) {
+                        fprintf(out, "        vF = 0;\n");
+                        set(0xF);
+                    }
+                    break;
+
+                // The same order of reads and writes as the interpreter, so the result is the same when x or y is F or x == y
+                case K_ADDV :
+                    fprintf(out, "        { unsigned int sum = v%X + v%X; v%X = sum; vF = sum > 255; }\n", x, y, x);
+                    set(x); set(0xF);
+                    break;
+                case K_SUB :
+                    fprintf(out, "        { uint8_t val = v%X; v%X = val - v%X; vF = val >= v%X; }\n", x, x, y, y);
+                    set(x); set(0xF);
+                    break;
+                case K_SUBN :
+                    fprintf(out, "        { uint8_t val = v%X; v%X = v%X - val; vF = v%X >= val; }\n", x, x, y, y);
+                    set(x); set(0xF);
+                    break;
+                case K_SHR :
+                    if (shiftVy)
+                        fprintf(out, "        v%X = v%X;\n", x, y);
+                    fprintf(out, "        { uint8_t lsb = v%X & 0x1; v%X >>= 1; vF = lsb; }\n", x, x);
+                    set(x); set(0xF);
+                    break;
+                case K_SHL :
+                    if (shiftVy)
+                        fprintf(out, "        v%X = v%X;\n", x, y);
+                    fprintf(out, "        { uint8_t msb = v%X >> 7; v%X <<= 1; vF = msb; }\n", x, x);
+                    set(x); set(0xF);
+                    break;
+
+                case K_LOADI :
+                    fprintf(out, "        c.I = 0x%03X;\n", nnn);
+                    break;
+                case K_LOADI_LONG :
+                    fprintf(out, "        c.I = 0x%04X;\n", in.operand);
+                    break;
+                case K_GETDT :
+                    fprintf(out, "        v%X = c.delay_timer;\n", x);
+                    set(x);
+                    break;
+                case K_SETDT :
+                    fprintf(out, "        c.delay_timer = v%X;\n", x);
+                    break;
+                case K_SETST :
+                    fprintf(out, "        c.sound_timer = v%X;\n", x);
+                    break;
+                case K_ADDI :
+                    fprintf(out, "        c.I += v%X;\n", x);
+                    break;
+
+                case K_INTERPRET :
+                    interpret(in);
+                    reload();
+                    break;
+                case K_INTERPRET_STORE :
+                    interpret(in);
+                    fprintf(out, "        if (%s) return left - %u;           // It may have written over the rest of the block\n", pagesWritten().c_str(), count);
+                    reload();
+                    break;
+                case K_INTERPRET_EXIT :
+                    interpret(in);
+                    fprintf(out, "        c.pc &= c.memory_mask;\n");
+                    if ((in.opcode & 0xF0FF) == 0xF00A) {
+                        // Keys only change between frames, so once Fx0A is waiting it waits out the rest of the frame
+                        fprintf(out, "        if (c.pc == 0x%04X) return 0;\n", in.address);
+                    }
+                    fprintf(out, "        return left - %u;\n", count);
+                    break;
+
+                case K_JUMP :
+                    flush("        ");
+                    next(in, nnn, count, "        ");
+                    break;
+                case K_SKIP_EQ_BYTE :
+                    skip(in, count, "v%X == 0x%02X", x, kk);
+                    break;
+                case K_SKIP_NE_BYTE :
+                    skip(in, count, "v%X != 0x%02X", x, kk);
+                    break;
+                // 5xx0 always skips and 9xx0 never does, written out so the generated code does not compare a register with itself
+                case K_SKIP_EQ :
+                    if (x == y) {
+                        flush("        ");
+                        next(in, in.skip, count, "        ");
+                    } else {
+                        skip(in, count, "v%X == v%X", x, y);
+                    }
+                    break;
+                case K_SKIP_NE :
+                    if (x == y) {
+                        flush("        ");
+                        next(in, (in.address + 2) & (program.memory_size - 1), count, "        ");
+                    } else {
+                        skip(in, count, "v%X != v%X", x, y);
+                    }
+                    break;
+                case K_SKIP_KEY :
+                    skip(in, count, "c.keypad[v%X & 0xF]", x, 0);
+                    break;
+                case K_SKIP_NOT_KEY :
+                    skip(in, count, "!c.keypad[v%X & 0xF]", x, 0);
+                    break;
+            }
+        }
+
+
+        void skip(const Instruction &in, unsigned int count, const char *condition, unsigned int a, unsigned int b) {
+            char test[64];
+            snprintf(test, sizeof(test), condition, a, b);
+            flush("        ");
+            fprintf(out, "        if (%s) {\n", test);
+            next(in, in.skip, count, "            ");
+            fprintf(out, "        }\n");
+            next(in, (in.address + 2) & (program.memory_size - 1), count, "        ");
+        }
+};
+
+
+
+
+bool readROM(const char *filename, std::vector<uint8_t> &rom) {
+    FILE *fp = fopen(filename, "rb");
+    if (fp == NULL) {
+        printf("ERROR: Could not open file %s\n", filename);
+        return false;
+    }
+
+    uint8_t buffer[4096];
+    size_t count;
+    while ((count = fread(buffer, 1, sizeof(buffer), fp)) > 0) {
+        rom.insert(rom.end(), buffer, buffer + count);
+    }
+    fclose(fp);
+    return true;
+}
+
+
+// The ROM's file name, made into an identifier
+std::string identifier(const std::string &file) {
+    std::string name = std::filesystem::path(file).stem().string();
+    for (char &c : name) {
+        if (!isalnum((unsigned char)c))
+            c = '_';
+    }
+    return name;
+}
+
+
+const char *platformName(Platform platform) {
+    switch (platform) {
+        case PLATFORM_SCHIP : return "PLATFORM_SCHIP";
+        case PLATFORM_XOCHIP : return "PLATFORM_XOCHIP";
+        default : return "PLATFORM_CHIP8";
+    }
+}
+
+
+// Runs the ROM interpreted and compiled side by side with the same generated input, then times each on its own
+const char *CHECKER = R"CHECKER(
+#ifdef CHIP8_RECOMP_MAIN
+#include <chrono>
+#include "Chip8.cpp"
+
+static void recompSetup(Chip8 &chip8, unsigned int ips, bool compiled) {
+    chip8.setPlatform(COMPILED.platform);
+    chip8.setSpeed(ips);
+    chip8.seed(1);
+    chip8.loadROM(COMPILED.rom, COMPILED.rom_size);
+    if (compiled)
+        chip8.setCompiledROM(&COMPILED);
+}
+
+static void recompInput(Chip8 &chip8, unsigned long frame, uint32_t &input) {
+    if (frame % 6)
+        return;
+    input ^= input << 13;
+    input ^= input >> 17;
+    input ^= input << 5;
+    chip8.setKey(input & 0xF, (input >> 4) & 1);
+}
+
+static double recompTime(unsigned long frames, unsigned int ips, bool compiled) {
+    Chip8 chip8;
+    recompSetup(chip8, ips, compiled);
+    uint32_t input = 1;
+    auto start = std::chrono::steady_clock::now();
+    for (unsigned long f = 0; f < frames; f++) {
+        recompInput(chip8, f, input);
+        chip8.emulateFrame();
+    }
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+int main(int argc, char **argv) {
+    unsigned long frames = argc > 1 ? std::stoul(argv[1]) : 3600;
+    unsigned int ips = argc > 2 ? std::stoul(argv[2]) : 700;
+
+    Chip8 interpreted, compiled;
+    recompSetup(interpreted, ips, false);
+    recompSetup(compiled, ips, true);
+    if (!compiled.isCompiled()) {
+        printf("ERROR: The generated code did not take on %s\n", COMPILED.name);
+        return 1;
+    }
+
+    uint32_t interpretedInput = 1, compiledInput = 1;
+    for (unsigned long f = 0; f < frames; f++) {
+        recompInput(interpreted, f, interpretedInput);
+        recompInput(compiled, f, compiledInput);
+        interpreted.emulateFrame();
+        compiled.emulateFrame();
+        if (interpreted.stateHash() != compiled.stateHash()) {
+            printf("FAIL %s: the states differ after frame %lu\n", COMPILED.name, f);
+            return 1;
+        }
+    }
+    printf("%s: %lu frames match%s\n", COMPILED.name, frames, compiled.isCompiled() ? "" : " (the generated code was switched off)");
+
+    double interpretedTime = recompTime(frames, ips, false);
+    double compiledTime = recompTime(frames, ips, true);
+    double instructions = (double)frames * ips / TIMER_FREQUENCY;
+    printf("interpreted: %8.1f M instructions/sec\n", instructions / interpretedTime / 1e6);
+    printf("compiled:    %8.1f M instructions/sec  (%.1fx)\n", instructions / compiledTime / 1e6, interpretedTime / compiledTime);
+    return 0;
+}
+#endif
+)CHECKER";
+
+
+bool generate(Program &program, const char *filename) {
+    FILE *out = fopen(filename, "w");
+    if (out == NULL) {
+        printf("ERROR: Could not open file %s\n", filename);
+        return false;
+    }
+
+    const std::string &name = program.name;
+    fprintf(out, "// Generated by chip8_recomp from %s for %s -- do not edit\n", program.file.c_str(), platformName(program.platform));
+    fprintf(out, "// Include after Chip8.cpp and call chip8.setCompiledROM(&compiled_%s), see recomp.cpp\n", name.c_str());
+    fprintf(out, "#include \"Chip8.hpp\"\n\n");
+
+    fprintf(out, "static const uint8_t recomp_%s_rom[] = {", name.c_str());
+    for (size_t i = 0; i < program.rom.size(); i++) {
+        fprintf(out, "%s0x%02X,", i % 16 ? " " : "\n    ", program.rom[i]);
+    }
+    fprintf(out, "\n};\n\n");
+    fprintf(out, "static const uint64_t recomp_%s_code[] = {", name.c_str());
+    for (size_t i = 0; i < program.code.size(); i++) {
+        fprintf(out, "%s0x%016llXull,", i % 4 ? " " : "\n    ", (unsigned long long)program.code[i]);
+    }
+    fprintf(out, "\n};\n\n");
+
+    fprintf(out, "struct Recomp_%s;\n\n", name.c_str());
+    fprintf(out, "template <>\nstruct CompiledCode<Recomp_%s> {\n", name.c_str());
+    fprintf(out, "    // Runs one instruction the same way Chip8::emulateCycle() does, with PC already past it\n");
+    fprintf(out, "    static void interpret(Chip8 &c, uint16_t next, uint16_t opcode) {\n");
+    fprintf(out, "        c.pc = next;\n");
+    fprintf(out, "        c.opcode = opcode;\n");
+    fprintf(out, "        (c.*(c.tables->OpcodeTable[opcode >> 12]))();\n");
+    fprintf(out, "    }\n\n");
+    fprintf(out, "    // True if the program has written over translated code on the page since the ROM was loaded\n");
+    fprintf(out, "    static bool written(Chip8 &c, uint32_t page) {\n");
+    fprintf(out, "        return (c.code_written[page / 64] >> (page %% 64)) & 1;\n");
+    fprintf(out, "    }\n\n");
+    fprintf(out, "    // True if memory still holds the ROM from address to address + length\n");
+    fprintf(out, "    static bool unchanged(Chip8 &c, uint32_t address, uint32_t length) {\n");
+    fprintf(out, "        for (uint32_t a = address; a < address + length; a++) {\n");
+    fprintf(out, "            if (c.pages[a / MEMORY_PAGE_SIZE]->bytes[a %% MEMORY_PAGE_SIZE] != recomp_%s_rom[a - 0x200])\n", name.c_str());
+    fprintf(out, "                return false;\n");
+    fprintf(out, "        }\n");
+    fprintf(out, "        return true;\n");
+    fprintf(out, "    }\n\n");
+    fprintf(out, "    // Each block returns how many of the left instructions are still left, left itself if its code was written over and it has to be interpreted\n\n");
+
+    BlockWriter writer(out, program);
+    unsigned int instructions = 0, interpreted = 0;
+    for (uint32_t start : program.leaders) {
+        instructions += writer.write(start, interpreted);
+    }
+
+    fprintf(out, "    static unsigned int run(Chip8 &c, unsigned int cycles) {\n");
+    fprintf(out, "        unsigned int left = cycles;\n");
+    fprintf(out, "        while (left && !c.halted) {\n");
+    fprintf(out, "            unsigned int remaining = left;\n");
+    fprintf(out, "            switch (c.pc) {\n");
+    for (uint32_t start : program.leaders) {
+        fprintf(out, "                case 0x%04X: remaining = block_%04X(c, left); break;\n", start, start);
+    }
+    fprintf(out, "            }\n");
+    fprintf(out, "            if (remaining == left) {\n");
+    fprintf(out, "                c.emulateCycle();                           // Not the start of a block, or the block was written over\n");
+    fprintf(out, "                remaining--;\n");
+    fprintf(out, "            }\n");
+    fprintf(out, "            left = remaining;\n");
+    fprintf(out, "        }\n");
+    fprintf(out, "        return cycles - left;\n");
+    fprintf(out, "    }\n");
+    fprintf(out, "};\n\n");
+    fprintf(out, "const CompiledROM compiled_%s = {\n", name.c_str());
+    fprintf(out, "    \"%s\", %s, recomp_%s_rom, %zu, recomp_%s_code, &CompiledCode<Recomp_%s>::run\n",
+            std::filesystem::path(program.file).filename().string().c_str(), platformName(program.platform), name.c_str(), program.rom.size(), name.c_str(), name.c_str());
+    fprintf(out, "};\n");
+
+    fprintf(out, "\n#define COMPILED compiled_%s", name.c_str());
+    fprintf(out, "%s", CHECKER);
+    fprintf(out, "#undef COMPILED\n");
+    fclose(out);
+
+    unsigned int translated = 0;
+    for (uint64_t word : program.code) {
+        translated += __builtin_popcountll(word);
+    }
+    printf("%s: %zu blocks, %u instructions (%u run by the interpreter), %u of %zu ROM bytes translated -> %s\n", program.file.c_str(),
+           program.leaders.size(), instructions, interpreted, translated, program.rom.size(), filename);
+    return true;
+}
+
+
+
+
+int main(int argc, char **argv) {
+    if (argc < 2) {
+        printf("ERROR: PROPER USAGE IS: ./chip8_recomp <ROM> [-o FILE] [--name NAME] [--platform chip8|schip|xochip]\n");
+        return 1;
+    }
+
+    Program program;
+    program.file = argv[1];
+    program.name = identifier(program.file);
+
+    program.platform = Chip8::platformFor(program.file);
+
+    std::string output;
+    for (int i = 2; i < argc; i++) {
+        if (!strcmp(argv[i], "-o") && i + 1 < argc) {
+            output = argv[++i];
+        } else if (!strcmp(argv[i], "--name") && i + 1 < argc) {
+            program.name = identifier(argv[++i]);
+        } else if (!strcmp(argv[i], "--platform") && i + 1 < argc) {
+            if (!Chip8::parsePlatform(argv[++i], program.platform)) {
+                printf("ERROR: Unknown platform %s\n", argv[i]);
+                return 1;
+            }
+        } else {
+            printf("ERROR: Unknown argument %s\n", argv[i]);
+            return 1;
+        }
+    }
+    if (output.empty())
+        output = program.name + ".cpp";
+
+    if (!readROM(argv[1], program.rom))
+        return 1;
+
+    program.memory_size = program.platform == PLATFORM_XOCHIP ? XO_MEMORY_SIZE : MEMORY_SIZE;
+    if (program.rom.size() > program.memory_size - PROGRAM_START) {
+        printf("ERROR: File is too large\nFile must be of size %u or smaller\n", program.memory_size - PROGRAM_START);
+        return 1;
+    }
+
+    findCode(program);
+    return generate(program, output.c_str()) ? 0 : 1;
+}
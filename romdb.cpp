@@ -0,0 +1,81 @@
+#include <cstdio>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <vector>
+#include "Chip8.hpp"
+#include "Chip8.cpp"
+#include "Sha1.hpp"
+#include "Sha1.cpp"
+#include "ROMDatabase.hpp"
+#include "ROMDatabase.cpp"
+
+// Compiles the ROM database and looks ROMs up in it (see ROMDatabase.hpp)
+// Build: g++ -O2 -std=c++17 romdb.cpp -o romdb
+// Usage: ./romdb compile <SOURCE> <DATABASE>
+//        ./romdb lookup <DATABASE> <ROM>...
+//
+// The database shipped with the emulator is compiled with: ./romdb compile romdb/romdb.txt romdb/romdb.bin
+
+
+void printSettings(const ROMSettings &settings) {
+    if (!settings.title.empty())
+        printf("  title    %s\n", settings.title.c_str());
+    if (settings.settings & SETTING_PLATFORM)
+        printf("  platform %s\n", Chip8::platformName(settings.platform));
+    if (settings.settings & SETTING_IPS)
+        printf("  ips      %u\n", settings.ips);
+    if (settings.settings & SETTING_QUIRKS)
+        printf("  quirks   %s\n", quirksName(settings.quirks).c_str());
+    if (settings.settings & SETTING_KEYMAP)
+        printf("  keymap   %s\n", settings.keymap.c_str());
+    if (settings.settings & SETTING_PALETTE) {
+        printf("  palette  %06X,%06X,%06X,%06X\n", settings.palette.colours[0] & 0xFFFFFF, settings.palette.colours[1] & 0xFFFFFF,
+               settings.palette.colours[2] & 0xFFFFFF, settings.palette.colours[3] & 0xFFFFFF);
+    }
+}
+
+
+int main(int argc, char **argv) {
+    if (argc == 4 && !strcmp(argv[1], "compile")) {
+        if (!ROMDatabase::compile(argv[2], argv[3]))
+            return 1;
+
+        ROMDatabase database;
+        if (!database.load(argv[3]))
+            return 1;
+        printf("%zu ROMs written to %s\n", database.size(), argv[3]);
+        return 0;
+    }
+
+    if (argc >= 4 && !strcmp(argv[1], "lookup")) {
+        ROMDatabase database;
+        if (!database.load(argv[2]))
+            return 1;
+
+        int missing = 0;
+        for (int i = 3; i < argc; i++) {
+            std::ifstream file(argv[i], std::ios::binary);
+            if (!file) {
+                printf("ERROR: Could not open file %s\n", argv[i]);
+                return 1;
+            }
+            std::vector<uint8_t> rom((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+
+            uint8_t digest[SHA1_SIZE];
+            sha1(rom.data(), rom.size(), digest);
+            ROMSettings settings;
+            if (database.find(digest, settings)) {
+                printf("%s %s\n", sha1Hex(digest).c_str(), argv[i]);
+                printSettings(settings);
+            } else {
+                printf("%s %s: not in the database\n", sha1Hex(digest).c_str(), argv[i]);
+                missing++;
+            }
+        }
+        return missing ? 2 : 0;
+    }
+
+    printf("ERROR: PROPER USAGE IS: ./romdb compile <SOURCE> <DATABASE> or ./romdb lookup <DATABASE> <ROM>...\n");
+    return 1;
+}
@@ -0,0 +1,76 @@
+#include <cstdio>
+#include <cstdint>
+#include <cstring>
+#include <chrono>
+#include "Chip8.hpp"
+#include "Chip8.cpp"
+#include "Sha1.hpp"
+#include "Sha1.cpp"
+#include "ROMLibrary.hpp"
+#include "ROMLibrary.cpp"
+
+// Lists, looks up and packs ROM libraries (see ROMLibrary.hpp)
+// Build: g++ -O2 -std=c++17 romlib.cpp -o romlib
+// Usage: ./romlib list <ROM, DIRECTORY or ARCHIVE>...
+//        ./romlib find <SHA1> <ROM, DIRECTORY or ARCHIVE>...
+//        ./romlib pack <OUT.clib> <ROM, DIRECTORY or ARCHIVE>...
+//
+// Each command prints how long the library took to open, and how long loading every ROM in it into a machine straight from the mapping takes
+
+
+double secondsSince(std::chrono::steady_clock::time_point start) {
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+
+void printEntry(const ROMEntry &entry) {
+    printf("%s %6u  %s\n", sha1Hex(entry.sha1).c_str(), entry.size, entry.name.c_str());
+}
+
+
+int main(int argc, char **argv) {
+    if (argc < 3 || (strcmp(argv[1], "list") && argc < 4) || (strcmp(argv[1], "list") && strcmp(argv[1], "find") && strcmp(argv[1], "pack"))) {
+        printf("ERROR: PROPER USAGE IS: ./romlib list|find <SHA1>|pack <OUT.clib> <ROM, DIRECTORY or ARCHIVE>...\n");
+        return 1;
+    }
+
+    const char *command = argv[1];
+    int first = strcmp(command, "list") ? 3 : 2;
+
+    ROMLibrary library;
+    auto start = std::chrono::steady_clock::now();
+    for (int i = first; i < argc; i++) {
+        if (!library.open(argv[i]))
+            return 1;
+    }
+    double openTime = secondsSince(start);
+
+    // Every ROM goes into the same machine, the way a batch runner would go through the library
+    Chip8 chip8;
+    chip8.setPlatform(PLATFORM_XOCHIP);
+    start = std::chrono::steady_clock::now();
+    for (size_t i = 0; i < library.size(); i++) {
+        chip8.loadROM(library.entry(i).data, library.entry(i).size);
+    }
+    double loadTime = secondsSince(start);
+
+    if (!strcmp(command, "list")) {
+        for (size_t i = 0; i < library.size(); i++) {
+            printEntry(library.entry(i));
+        }
+    } else if (!strcmp(command, "find")) {
+        const ROMEntry *entry = library.find(argv[2]);
+        if (!entry) {
+            printf("ERROR: No ROM with SHA-1 %s\n", argv[2]);
+            return 1;
+        }
+        for (size_t i = entry - &library.entry(0); i < library.size() && !memcmp(library.entry(i).sha1, entry->sha1, SHA1_SIZE); i++) {
+            printEntry(library.entry(i));
+        }
+    } else if (!library.pack(argv[2])) {
+        return 1;
+    }
+
+    printf("%zu ROMs opened and indexed in %.2f ms, all loaded into a machine in %.2f ms\n", library.size(), openTime * 1000, loadTime * 1000);
+    return 0;
+}
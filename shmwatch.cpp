@@ -0,0 +1,154 @@
+#include <cstdio>
+#include <cstdint>
+#include <cstring>
+#include <chrono>
+#include <thread>
+#include "Chip8.hpp"
+#include "Chip8.cpp"
+#include "SharedMemory.hpp"
+#include "SharedMemory.cpp"
+
+// Watches and controls an emulator started with --shm <NAME>
+// Build: g++ -O2 -pthread shmwatch.cpp -o shmwatch -lrt
+// Usage: ./shmwatch <NAME> [--key K down|up] [--pause] [--resume] [--step N] [--snapshot FILE] [--watch]
+//
+// The commands are sent in the order given, then the latest frame is printed
+// --snapshot waits for the emulator to copy out its memory and writes it to FILE
+// --watch keeps printing the frame rate and registers until interrupted
+
+
+void printFrame(const SharedFrame &frame) {
+    const Registers &r = frame.registers;
+    printf("frame %llu%s  %ux%u  PC 0x%04X  I 0x%04X  SP %u  DT %u  ST %u\n", (unsigned long long)frame.frame, frame.paused ? " (paused)" : "",
+           frame.width, frame.height, r.pc, r.I, r.sp, r.delay_timer, r.sound_timer);
+
+    printf("V ");
+    for (int i = 0; i < REGISTER_COUNT; i++)
+        printf(" %02X", r.V[i]);
+    printf("\nkeys ");
+    for (int i = 0; i < KEY_COUNT; i++)
+        printf("%c", frame.keypad[i] ? "0123456789ABCDEF"[i] : '.');
+    printf("\n");
+}
+
+
+// Both planes, two rows per line so the display fits in a terminal
+void printDisplay(const SharedFrame &frame) {
+    for (unsigned int y = 0; y < frame.height && y < VIDEO_HEIGHT; y += 2) {
+        for (unsigned int x = 0; x < frame.width && x < VIDEO_WIDTH; x++) {
+            VideoRow bit = (VideoRow)1 << (VIDEO_WIDTH - 1 - x);
+            bool top = (frame.video[0][y] | frame.video[1][y]) & bit;
+            bool bottom = y + 1 < frame.height && ((frame.video[0][y + 1] | frame.video[1][y + 1]) & bit);
+            printf("%s", top ? (bottom ? "█" : "▀") : (bottom ? "▄" : " "));
+        }
+        printf("\n");
+    }
+}
+
+
+bool send(SharedChannel &channel, SharedCommand command) {
+    // The emulator drains the ring every frame, so a full ring only has to wait a moment
+    for (int attempt = 0; attempt < 1000; attempt++) {
+        if (channel.pushCommand(command))
+            return true;
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+
+    printf("ERROR: The emulator is not taking commands\n");
+    return false;
+}
+
+
+bool saveSnapshot(SharedChannel &channel, const char *filename) {
+    static uint8_t memory[XO_MEMORY_SIZE];
+    uint32_t size;
+    uint64_t frame;
+
+    uint32_t before = channel.snapshotsTaken();
+    if (!send(channel, {COMMAND_SNAPSHOT, 0, false, 0}))
+        return false;
+
+    for (int attempt = 0; channel.snapshotsTaken() == before; attempt++) {
+        if (attempt == 5000) {
+            printf("ERROR: The emulator did not take a snapshot\n");
+            return false;
+        }
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    channel.readSnapshot(memory, size, frame);
+
+    FILE *fp = fopen(filename, "wb");
+    if (fp == NULL) {
+        printf("ERROR: Could not open file %s\n", filename);
+        return false;
+    }
+    fwrite(memory, 1, size, fp);
+    fclose(fp);
+
+    printf("Wrote %u bytes of memory from frame %llu to %s\n", size, (unsigned long long)frame, filename);
+    return true;
+}
+
+
+int main(int argc, char **argv) {
+    if (argc < 2) {
+        printf("ERROR: PROPER USAGE IS: ./shmwatch <NAME> [--key K down|up] [--pause] [--resume] [--step N] [--snapshot FILE] [--watch]\n");
+        return 1;
+    }
+
+    SharedChannel channel;
+    if (!channel.attach(argv[1]))
+        return 1;
+
+    bool watch = false;
+    for (int i = 2; i < argc; i++) {
+        if (!strcmp(argv[i], "--key") && i + 2 < argc) {
+            uint8_t key = std::stoul(argv[++i], NULL, 16) & 0xF;
+            bool pressed = !strcmp(argv[++i], "down");
+            if (!send(channel, {COMMAND_KEY, key, pressed, 0}))
+                return 1;
+        } else if (!strcmp(argv[i], "--pause")) {
+            if (!send(channel, {COMMAND_PAUSE, 0, false, 0}))
+                return 1;
+        } else if (!strcmp(argv[i], "--resume")) {
+            if (!send(channel, {COMMAND_RESUME, 0, false, 0}))
+                return 1;
+        } else if (!strcmp(argv[i], "--step") && i + 1 < argc) {
+            if (!send(channel, {COMMAND_STEP, 0, false, (uint32_t)std::stoul(argv[++i])}))
+                return 1;
+        } else if (!strcmp(argv[i], "--snapshot") && i + 1 < argc) {
+            if (!saveSnapshot(channel, argv[++i]))
+                return 1;
+        } else if (!strcmp(argv[i], "--watch")) {
+            watch = true;
+        } else {
+            printf("ERROR: Unknown argument %s\n", argv[i]);
+            return 1;
+        }
+    }
+
+    // Give the emulator a frame to act on the commands before looking
+    std::this_thread::sleep_for(std::chrono::milliseconds(50));
+
+    SharedFrame frame;
+    if (!channel.readFrame(frame)) {
+        printf("Nothing has been published yet\n");
+        return 0;
+    }
+
+    if (!watch) {
+        printDisplay(frame);
+        printFrame(frame);
+        return 0;
+    }
+
+    while (true) {
+        uint64_t first = frame.frame;
+        std::this_thread::sleep_for(std::chrono::seconds(1));
+        channel.readFrame(frame);
+
+        printf("%llu fps  ", (unsigned long long)(frame.frame - first));
+        printFrame(frame);
+        fflush(stdout);
+    }
+}
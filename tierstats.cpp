@@ -0,0 +1,151 @@
+#include <cstdio>
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <vector>
+#include <algorithm>
+#include <filesystem>
+#include "Chip8.hpp"
+#include "Chip8.cpp"
+
+// Reports how each ROM runs on the execution tiers (see Chip8::setTiering())
+// Build: g++ -O2 -std=c++17 tierstats.cpp -o tierstats
+// Usage: ./tierstats <ROM or DIRECTORY>... [--tier THRESHOLD] [--frames N] [--ips N] [--platform chip8|schip|xochip]
+//
+// Each ROM is run headless with the same generated key events as lockstep, then the share of instructions run by each tier,
+// the blocks promoted and demoted, the fusion hit rate (instructions run inside superinstructions) and the instructions that skipped working out a dead VF are printed
+// A threshold that demotes about as many blocks as it promotes, or leaves most instructions interpreted, does not suit the ROM
+// Without --platform, the platform is picked from the file extension: .sc8 is SUPER-CHIP, .xo8 is XO-CHIP and anything else is CHIP-8
+
+const unsigned int DEFAULT_THRESHOLD = 16;
+const unsigned long DEFAULT_FRAMES = 3600;                  // One emulated minute
+const unsigned int DEFAULT_IPS = 700;
+const unsigned int INPUT_INTERVAL = 6;                      // Frames between generated key events
+
+
+struct Options {
+    unsigned int threshold = DEFAULT_THRESHOLD;
+    unsigned long frames = DEFAULT_FRAMES;
+    unsigned int ips = DEFAULT_IPS;
+    int platform = -1;                                      // -1 picks the platform from the file extension
+};
+
+
+Platform platformFor(const std::string &rom, const Options &options) {
+    if (options.platform >= 0)
+        return (Platform)options.platform;
+    return Chip8::platformFor(rom);
+}
+
+
+double percent(uint64_t part, uint64_t whole) {
+    return whole ? 100.0 * part / whole : 0.0;
+}
+
+
+void addStats(TierStats &total, const TierStats &stats) {
+    total.interpreted += stats.interpreted;
+    total.predecoded += stats.predecoded;
+    total.native += stats.native;
+    total.promoted += stats.promoted;
+    total.demoted += stats.demoted;
+    total.dead_flags += stats.dead_flags;
+    for (unsigned int f = 0; f < FUSION_COUNT; f++)
+        total.fused[f] += stats.fused[f];
+}
+
+
+void printStats(const char *name, const TierStats &stats) {
+    uint64_t instructions = stats.interpreted + stats.predecoded + stats.native;
+    uint64_t fused = 0;
+    for (unsigned int f = 0; f < FUSION_COUNT; f++)
+        fused += stats.fused[f];
+
+    printf("%-40s %12llu %6.1f%% %6.1f%% %6.1f%% %6.1f%% %6.1f%% %8llu %8llu\n", name, (unsigned long long)instructions,
+           percent(stats.interpreted, instructions), percent(stats.predecoded, instructions), percent(stats.native, instructions),
+           percent(fused, instructions), percent(stats.dead_flags, instructions), (unsigned long long)stats.promoted, (unsigned long long)stats.demoted);
+
+    for (unsigned int f = 0; f < FUSION_COUNT; f++) {
+        if (stats.fused[f])
+            printf("    %-36s %12llu %6.1f%%\n", FUSION_NAMES[f], (unsigned long long)stats.fused[f], percent(stats.fused[f], instructions));
+    }
+}
+
+
+// Runs one ROM, returns false if it could not be loaded
+bool runROM(const std::string &rom, const Options &options, TierStats &stats) {
+    Chip8 chip8;
+    chip8.setPlatform(platformFor(rom, options));
+    chip8.seed(1);
+    chip8.setSpeed(options.ips);
+    chip8.setTiering(options.threshold);
+    if (!chip8.loadROM(rom.c_str()))
+        return false;
+
+    uint32_t input = 1;
+    for (unsigned long frame = 0; frame < options.frames && !chip8.isHalted(); frame++) {
+        if (frame % INPUT_INTERVAL == 0) {
+            input ^= input << 13;
+            input ^= input >> 17;
+            input ^= input << 5;
+            chip8.setKey(input & 0xF, (input >> 4) & 1);
+        }
+        chip8.emulateFrame();
+    }
+
+    stats = chip8.getTierStats();
+    return true;
+}
+
+
+int main(int argc, char **argv) {
+    Options options;
+    std::vector<std::string> roms;
+
+    for (int i = 1; i < argc; i++) {
+        if (!strcmp(argv[i], "--tier") && i + 1 < argc) {
+            options.threshold = std::max(1ul, std::stoul(argv[++i]));
+        } else if (!strcmp(argv[i], "--frames") && i + 1 < argc) {
+            options.frames = std::stoul(argv[++i]);
+        } else if (!strcmp(argv[i], "--ips") && i + 1 < argc) {
+            options.ips = std::stoul(argv[++i]);
+        } else if (!strcmp(argv[i], "--platform") && i + 1 < argc) {
+            Platform parsed;
+            if (!Chip8::parsePlatform(argv[++i], parsed)) {
+                printf("ERROR: Unknown platform %s\n", argv[i]);
+                return 1;
+            }
+            options.platform = parsed;
+        } else if (std::filesystem::is_directory(argv[i])) {
+            for (const auto &entry : std::filesystem::recursive_directory_iterator(argv[i])) {
+                if (entry.is_regular_file())
+                    roms.push_back(entry.path().string());
+            }
+        } else {
+            roms.push_back(argv[i]);
+        }
+    }
+
+    if (roms.empty()) {
+        printf("ERROR: PROPER USAGE IS: ./tierstats <ROM or DIRECTORY>... [--tier THRESHOLD] [--frames N] [--ips N] [--platform chip8|schip|xochip]\n");
+        return 1;
+    }
+    std::sort(roms.begin(), roms.end());
+
+    printf("Threshold %u, %lu frames at %u IPS\n", options.threshold, options.frames, options.ips);
+    printf("%-40s %12s %7s %7s %7s %7s %7s %8s %8s\n", "ROM", "instructions", "interp", "predec", "native", "fused", "dead VF", "promoted", "demoted");
+
+    TierStats total = {};
+    for (const std::string &rom : roms) {
+        TierStats stats;
+        if (!runROM(rom, options, stats))
+            continue;
+
+        printStats(rom.c_str(), stats);
+        addStats(total, stats);
+    }
+
+    if (roms.size() > 1)
+        printStats("TOTAL", total);
+    return 0;
+}